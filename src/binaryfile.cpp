@@ -17,10 +17,271 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cstring>
 #include "binaryfile.h"
+#include "wrapzlib.h"
 #include <wx/wfstream.h>
+#include <wx/filename.h>
 
-BinaryFile::BinaryFile ( const wxString &fname ) : m_data ( 0 ), m_dataLen ( 0 )
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// returned for empty files so that getData() still signals success
+static char emptyFile[] = "";
+
+// the most a gzip file is assumed to expand when reserving memory
+#define INFLATE_MAX_RATIO 64
+
+// Collects decompressed text in a malloc'd buffer
+class InflateSink : public IconvSink
+{
+	public:
+		InflateSink ( size_t sizeHint )
+			: data ( NULL )
+			, dataLen ( 0 )
+			, capacity ( 0 )
+		{
+			reserve ( sizeHint );
+		}
+		~InflateSink()
+		{
+			free ( data );
+		}
+		virtual bool write ( const char *buffer, size_t bufferLen )
+		{
+			if ( dataLen + bufferLen > capacity
+				&& !reserve ( ( dataLen + bufferLen ) * 2 ) )
+				return false;
+			memcpy ( data + dataLen, buffer, bufferLen );
+			dataLen += bufferLen;
+			return true;
+		}
+		// hands the buffer over to the caller
+		char *release ( size_t &len )
+		{
+			char *result = data;
+			len = dataLen;
+			data = NULL;
+			dataLen = capacity = 0;
+			return result;
+		}
+	private:
+		char *data;
+		size_t dataLen, capacity;
+
+		bool reserve ( size_t size )
+		{
+			if ( !size )
+				size = 1;
+			char *newData = ( char * ) realloc ( data, size );
+			if ( newData == NULL )
+				return false;
+			data = newData;
+			capacity = size;
+			return true;
+		}
+};
+
+BinaryFile::BinaryFile ( const wxString &fname )
+	: m_data ( 0 )
+	, m_dataLen ( 0 )
+	, m_mapped ( false )
+	, m_compressed ( false )
+{
+	if ( mapFile ( fname ) )
+	{
+		m_fileName = fname;
+		m_modified = wxFileName ( fname ).GetModificationTime();
+	}
+	else
+	{
+		readFile ( fname );
+	}
+
+	if ( m_data && WrapZlib::isCompressed ( m_data, m_dataLen ) && !inflate() )
+		release();
+}
+
+BinaryFile::~BinaryFile()
+{
+	release();
+}
+
+void BinaryFile::release()
+{
+	if ( m_mapped )
+	{
+#ifdef __WXMSW__
+		UnmapViewOfFile ( m_data );
+#else
+		munmap ( m_data, m_dataLen );
+#endif
+	}
+	else if ( m_data != emptyFile )
+	{
+		//delete[] m_data;
+		free ( m_data );
+	}
+	m_data = 0;
+	m_dataLen = 0;
+	m_mapped = false;
+}
+
+const char *BinaryFile::getData()
+{
+	return ( const char * ) m_data;
+}
+
+size_t BinaryFile::getDataLen()
+{
+	return m_dataLen;
+}
+
+bool BinaryFile::isMapped()
+{
+	return m_mapped;
+}
+
+bool BinaryFile::isCompressed()
+{
+	return m_compressed;
+}
+
+bool BinaryFile::isChanged()
+{
+	if ( !m_mapped )
+		return false;
+
+	wxFileName fn ( m_fileName );
+	if ( !fn.FileExists() )
+		return true;
+	return fn.GetSize() != wxULongLong ( ( wxULongLong_t ) m_dataLen ) ||
+	       !fn.GetModificationTime().IsEqualTo ( m_modified );
+}
+
+// Replaces the compressed contents with the decompressed text. The gzip
+// trailer records the original size (modulo 4 GB), which is used as a
+// first guess at the buffer size. The trailer is not checked until the
+// data has been inflated, so the guess is capped at a plausible
+// compression ratio and the buffer grows from there.
+bool BinaryFile::inflate()
+{
+	size_t sizeHint = m_dataLen * 4;
+	if ( m_dataLen >= 18 )
+	{
+		const unsigned char *trailer =
+		    ( const unsigned char * ) m_data + m_dataLen - 4;
+		size_t size = trailer[0] | ( trailer[1] << 8 ) |
+		              ( trailer[2] << 16 ) | ( ( size_t ) trailer[3] << 24 );
+		if ( size / INFLATE_MAX_RATIO > m_dataLen )
+			size = m_dataLen * INFLATE_MAX_RATIO;
+		if ( size > m_dataLen )
+			sizeHint = size;
+	}
+
+	InflateSink sink ( sizeHint );
+	WrapZlib zlib;
+	if ( !zlib.inflate ( m_data, m_dataLen, sink ) )
+		return false;
+
+	release();
+	m_data = sink.release ( m_dataLen );
+	if ( m_data == NULL )
+		m_data = emptyFile;
+	m_compressed = true;
+	return true;
+}
+
+bool BinaryFile::mapFile ( const wxString &fname )
+{
+#ifdef __WXMSW__
+	HANDLE file = CreateFile (
+		fname.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx ( file, &size )
+		|| ( unsigned long long ) size.QuadPart > ( size_t ) -1 )
+	{
+		CloseHandle ( file );
+		return false;
+	}
+
+	if ( size.QuadPart == 0 )
+	{
+		CloseHandle ( file );
+		m_data = emptyFile;
+		m_dataLen = 0;
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMapping ( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle ( file );
+	if ( mapping == NULL )
+		return false;
+
+	// the view keeps the mapping object alive
+	void *view = MapViewOfFile ( mapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle ( mapping );
+	if ( view == NULL )
+		return false;
+
+	m_dataLen = ( size_t ) size.QuadPart;
+#else
+	int fd = open ( fname.fn_str(), O_RDONLY );
+	if ( fd == -1 )
+		return false;
+
+	struct stat st;
+	if ( fstat ( fd, &st ) == -1
+		|| !S_ISREG ( st.st_mode )
+		|| ( unsigned long long ) st.st_size > ( size_t ) -1 )
+	{
+		close ( fd );
+		return false;
+	}
+
+	if ( st.st_size == 0 )
+	{
+		close ( fd );
+		m_data = emptyFile;
+		m_dataLen = 0;
+		return true;
+	}
+
+	void *view = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close ( fd ); // the mapping holds its own reference
+	if ( view == MAP_FAILED )
+		return false;
+
+#ifdef MADV_SEQUENTIAL
+	// every consumer walks the buffer from start to finish
+	madvise ( view, st.st_size, MADV_SEQUENTIAL );
+#endif
+
+	m_dataLen = st.st_size;
+#endif
+
+	m_data = ( char * ) view;
+	m_mapped = true;
+	return true;
+}
+
+bool BinaryFile::readFile ( const wxString &fname )
 {
 	wxFileInputStream stream ( fname );
 	size_t lSize;
@@ -28,7 +289,7 @@ BinaryFile::BinaryFile ( const wxString &fname ) : m_data ( 0 ), m_dataLen ( 0 )
 
 	if ( !stream.IsOk() )
 	{
-		return;
+		return false;
 	}
 
 	lSize = stream.GetSize();
@@ -39,7 +300,7 @@ BinaryFile::BinaryFile ( const wxString &fname ) : m_data ( 0 ), m_dataLen ( 0 )
 	buffer = ( char* ) malloc ( sizeof ( char ) *lSize );
 	if ( buffer == NULL )
 	{
-		return;
+		return false;
 	}
 
 	// copy the file into the buffer:
@@ -47,27 +308,15 @@ BinaryFile::BinaryFile ( const wxString &fname ) : m_data ( 0 ), m_dataLen ( 0 )
 	if ( stream.LastRead() != lSize )
 	{
 		if ( !stream.Eof() )
-			return;
+		{
+			free ( buffer );
+			return false;
+		}
 	}
 
 	/* the whole file is now loaded in the memory buffer. */
 
 	m_data = buffer;
 	m_dataLen = lSize;
-}
-
-BinaryFile::~BinaryFile()
-{
-	//delete[] m_data;
-	free ( m_data );
-}
-
-const char *BinaryFile::getData()
-{
-	return ( const char * ) m_data;
-}
-
-size_t BinaryFile::getDataLen()
-{
-	return m_dataLen;
+	return true;
 }
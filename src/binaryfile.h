@@ -24,6 +24,11 @@
 #include <cstdlib>
 #include <wx/wx.h>
 
+// Read-only view of a file's contents. Where the platform allows, the
+// file is memory-mapped rather than copied, so the buffer returned by
+// getData() must never be written to and is only valid for the lifetime
+// of the BinaryFile object. A gzip-compressed file is decompressed as it
+// is read, and getData() returns the plain contents.
 class BinaryFile
 {
 	public:
@@ -31,9 +36,22 @@ class BinaryFile
 		~BinaryFile();
 		const char *getData();
 		size_t getDataLen();
+		bool isMapped();
+		bool isCompressed();
+		// true if a mapped file has since been changed on disk; reading a
+		// mapping whose file has been truncated faults
+		bool isChanged();
 	private:
 		char *m_data;
 		size_t m_dataLen;
+		bool m_mapped, m_compressed;
+		wxString m_fileName;
+		wxDateTime m_modified;
+		bool mapFile ( const wxString &fname );
+		bool readFile ( const wxString &fname );
+		bool inflate();
+		void release();
+		DECLARE_NO_COPY_CLASS ( BinaryFile )
 };
 
 #endif
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include "completiondatabase.h"
+
+CompletionDatabase::CompletionDatabase()
+{
+}
+
+void CompletionDatabase::clear()
+{
+	names.clear();
+	nodes.clear();
+	childStart.clear();
+	children.clear();
+	attributeStart.clear();
+	attributes.clear();
+	valueStart.clear();
+	values.clear();
+	requiredStart.clear();
+	required.clear();
+	structures.clear();
+	childLists.clear();
+}
+
+void CompletionDatabase::build (
+    const AttributeMap &attributeMap,
+    const ElementMap &requiredAttributeMap,
+    const ElementMap &elementMap,
+    const StructureMap &elementStructureMap )
+{
+	clear();
+
+	// intern every name
+	AttributeMap::const_iterator element;
+	std::map<wxString, std::set<wxString> >::const_iterator attribute;
+	ElementMap::const_iterator set;
+	StructureMap::const_iterator structure;
+	for ( element = attributeMap.begin(); element != attributeMap.end(); ++element )
+	{
+		names.push_back ( element->first );
+		for ( attribute = element->second.begin();
+		        attribute != element->second.end();
+		        ++attribute )
+		{
+			names.push_back ( attribute->first );
+			names.insert ( names.end(), attribute->second.begin(), attribute->second.end() );
+		}
+	}
+	for ( set = requiredAttributeMap.begin(); set != requiredAttributeMap.end(); ++set )
+	{
+		names.push_back ( set->first );
+		names.insert ( names.end(), set->second.begin(), set->second.end() );
+	}
+	for ( set = elementMap.begin(); set != elementMap.end(); ++set )
+	{
+		names.push_back ( set->first );
+		names.insert ( names.end(), set->second.begin(), set->second.end() );
+	}
+	for ( structure = elementStructureMap.begin();
+	        structure != elementStructureMap.end();
+	        ++structure )
+		names.push_back ( structure->first );
+
+	std::sort ( names.begin(), names.end() );
+	names.erase ( std::unique ( names.begin(), names.end() ), names.end() );
+	if ( names.empty() )
+		return;
+
+	nodes.resize ( 1 );
+	buildNode ( 0, 0, names.size(), 0 );
+
+	// the maps are keyed in the same order as the ids, so each is read
+	// through once while the runs are laid out id by id
+	static const std::set<wxString> none;
+	element = attributeMap.begin();
+	ElementMap::const_iterator requiredSet = requiredAttributeMap.begin();
+	ElementMap::const_iterator childSet = elementMap.begin();
+	for ( size_t id = 0; id < names.size(); ++id )
+	{
+		const wxString &name = names[id];
+
+		if ( childSet != elementMap.end() && childSet->first == name )
+			addRun ( ( childSet++ )->second, childStart, children );
+		else
+			addRun ( none, childStart, children );
+
+		if ( requiredSet != requiredAttributeMap.end() && requiredSet->first == name )
+			addRun ( ( requiredSet++ )->second, requiredStart, required );
+		else
+			addRun ( none, requiredStart, required );
+
+		attributeStart.push_back ( attributes.size() );
+		if ( element != attributeMap.end() && element->first == name )
+		{
+			for ( attribute = element->second.begin();
+			        attribute != element->second.end();
+			        ++attribute )
+			{
+				attributes.push_back ( find ( attribute->first ) );
+				addRun ( attribute->second, valueStart, values );
+			}
+			++element;
+		}
+	}
+	childStart.push_back ( children.size() );
+	requiredStart.push_back ( required.size() );
+	attributeStart.push_back ( attributes.size() );
+	valueStart.push_back ( values.size() );
+
+	for ( structure = elementStructureMap.begin();
+	        structure != elementStructureMap.end();
+	        ++structure )
+		structures.push_back ( std::make_pair ( find ( structure->first ), structure->second ) );
+}
+
+void CompletionDatabase::buildNode ( size_t slot, int first, int last, size_t depth )
+{
+	// the range shares whatever its first and last names share
+	const wxString &low = names[first], &high = names[last - 1];
+	size_t length = depth;
+	while ( length < low.length() && length < high.length() && low[length] == high[length] )
+		++length;
+
+	int i = first;
+	if ( low.length() == length )
+		++i;
+	std::vector<std::pair<int, int> > groups;
+	while ( i < last )
+	{
+		int j = i + 1;
+		while ( j < last && names[j][length] == names[i][length] )
+			++j;
+		groups.push_back ( std::make_pair ( i, j ) );
+		i = j;
+	}
+
+	Node &node = nodes[slot];
+	node.first = first;
+	node.last = last;
+	node.length = length;
+	node.firstChild = nodes.size();
+	node.childCount = groups.size();
+
+	// children are kept together so that they can be searched
+	size_t firstChild = nodes.size();
+	nodes.resize ( firstChild + groups.size() );
+	for ( size_t k = 0; k < groups.size(); ++k )
+		buildNode ( firstChild + k, groups[k].first, groups[k].second, length );
+}
+
+int CompletionDatabase::findChild ( const Node &node, wxChar c ) const
+{
+	int low = node.firstChild, high = node.firstChild + node.childCount;
+	while ( low < high )
+	{
+		int middle = ( low + high ) / 2;
+		wxChar found = names[nodes[middle].first][node.length];
+		if ( found == c )
+			return middle;
+		if ( found < c )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return -1;
+}
+
+int CompletionDatabase::find ( const wxString &name ) const
+{
+	if ( nodes.empty() )
+		return -1;
+
+	size_t depth = 0;
+	const Node *node = &nodes[0];
+	for ( ;; )
+	{
+		const wxString &prefix = names[node->first];
+		if ( name.length() < ( size_t ) node->length )
+			return -1;
+		for ( ; depth < ( size_t ) node->length; ++depth )
+			if ( name[depth] != prefix[depth] )
+				return -1;
+		if ( name.length() == depth )
+			return ( prefix.length() == depth ) ? node->first : -1;
+		int child = findChild ( *node, name[depth] );
+		if ( child == -1 )
+			return -1;
+		node = &nodes[child];
+	}
+}
+
+void CompletionDatabase::addRun (
+    const std::set<wxString> &set,
+    std::vector<int> &start,
+    std::vector<int> &list )
+{
+	start.push_back ( list.size() );
+	std::set<wxString>::const_iterator it;
+	for ( it = set.begin(); it != set.end(); ++it )
+		list.push_back ( find ( *it ) );
+}
+
+CompletionDatabase::Range CompletionDatabase::getRun (
+    const std::vector<int> &start,
+    const std::vector<int> &list,
+    int i ) const
+{
+	Range range;
+	range.begin = range.end = list.end();
+	if ( i >= 0 && ( size_t ) i + 1 < start.size() )
+	{
+		range.begin = list.begin() + start[i];
+		range.end = list.begin() + start[i + 1];
+	}
+	return range;
+}
+
+CompletionDatabase::Range CompletionDatabase::getChildren ( int element ) const
+{
+	return getRun ( childStart, children, element );
+}
+
+CompletionDatabase::Range CompletionDatabase::getAttributes ( int element ) const
+{
+	return getRun ( attributeStart, attributes, element );
+}
+
+CompletionDatabase::Range CompletionDatabase::getRequiredAttributes ( int element ) const
+{
+	return getRun ( requiredStart, required, element );
+}
+
+CompletionDatabase::Range CompletionDatabase::getAttributeValues ( int element, int attribute ) const
+{
+	Range range = getAttributes ( element );
+	std::vector<int>::const_iterator it =
+	    std::lower_bound ( range.begin, range.end, attribute );
+	if ( attribute < 0 || it == range.end || *it != attribute )
+		return getRun ( valueStart, values, -1 );
+	return getRun ( valueStart, values, it - attributes.begin() );
+}
+
+const wxString &CompletionDatabase::getStructure ( int element ) const
+{
+	static const wxString none;
+	std::vector<std::pair<int, wxString> >::const_iterator it =
+	    std::lower_bound ( structures.begin(), structures.end(),
+	                       std::make_pair ( element, wxString() ) );
+	if ( element < 0 || it == structures.end() || it->first != element )
+		return none;
+	return it->second;
+}
+
+const wxString &CompletionDatabase::getChildList ( int element ) const
+{
+	std::map<int, wxString>::iterator it = childLists.find ( element );
+	if ( it != childLists.end() )
+		return it->second;
+
+	wxString &list = childLists[element];
+	Range range = getChildren ( element );
+	for ( ; range.begin != range.end; ++range.begin )
+	{
+		if ( !list.empty() )
+			list.append ( _T ( "<" ) );
+		list.append ( names[*range.begin] );
+	}
+	return list;
+}
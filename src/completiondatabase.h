@@ -0,0 +1,108 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef COMPLETION_DATABASE_H
+#define COMPLETION_DATABASE_H
+
+#include <wx/wx.h>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+
+// The prompt maps of a document in compact form. Every element name,
+// attribute name and attribute value is interned once; the symbol ids
+// follow alphabetical order, so the children, attributes and values of an
+// element are kept as sorted runs of ids in flat arrays and come out ready
+// for a popup list. Names are looked up through a prefix trie over the
+// symbol table, which costs one comparison per character of the name.
+class CompletionDatabase
+{
+	public:
+		typedef std::map<wxString, std::map<wxString, std::set<wxString> > >
+		AttributeMap;
+		typedef std::map<wxString, std::set<wxString> > ElementMap;
+		typedef std::map<wxString, wxString> StructureMap;
+
+		// a run of symbol ids in alphabetical order
+		struct Range
+		{
+			std::vector<int>::const_iterator begin, end;
+			bool empty() const
+			{
+				return begin == end;
+			}
+		};
+
+		CompletionDatabase();
+		void build (
+		    const AttributeMap &attributeMap,
+		    const ElementMap &requiredAttributeMap,
+		    const ElementMap &elementMap,
+		    const StructureMap &elementStructureMap );
+		void clear();
+
+		// symbol id of name, or -1
+		int find ( const wxString &name ) const;
+		const wxString &getName ( int id ) const
+		{
+			return names[id];
+		}
+
+		// an id of -1 gives an empty range
+		Range getChildren ( int element ) const;
+		Range getAttributes ( int element ) const;
+		Range getRequiredAttributes ( int element ) const;
+		Range getAttributeValues ( int element, int attribute ) const;
+		const wxString &getStructure ( int element ) const;
+		// the children joined by '<' as UserListShow wants them; kept
+		// once asked for, which is only safe on the UI thread
+		const wxString &getChildList ( int element ) const;
+	private:
+		// A node stands for the symbols first to last - 1, which share
+		// their first length characters; its children split them on the
+		// next character. A symbol that is the shared prefix itself comes
+		// first in the range.
+		struct Node
+		{
+			int first, last, length, firstChild, childCount;
+		};
+		std::vector<wxString> names;
+		std::vector<Node> nodes;
+		// run i of a list is list[start[i]] to list[start[i + 1]]
+		std::vector<int> childStart, children;
+		std::vector<int> attributeStart, attributes;
+		std::vector<int> valueStart, values; // one run per entry of attributes
+		std::vector<int> requiredStart, required;
+		std::vector<std::pair<int, wxString> > structures;
+		mutable std::map<int, wxString> childLists;
+
+		void buildNode ( size_t slot, int first, int last, size_t depth );
+		int findChild ( const Node &node, wxChar c ) const;
+		void addRun (
+		    const std::set<wxString> &set,
+		    std::vector<int> &start,
+		    std::vector<int> &list );
+		Range getRun (
+		    const std::vector<int> &start,
+		    const std::vector<int> &list,
+		    int i ) const;
+};
+
+#endif
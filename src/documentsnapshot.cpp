@@ -0,0 +1,181 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <wx/stc/stc.h>
+#include "documentsnapshot.h"
+
+#define SNAPSHOT_SEGMENT_SIZE 16384
+
+DocumentSnapshot::DocumentSnapshot ( const std::vector<Segment> &segmentsParameter )
+	: segments ( segmentsParameter )
+{
+	index();
+}
+
+DocumentSnapshot::DocumentSnapshot ( const char *buffer, size_t bufferLen )
+{
+	for ( size_t pos = 0; pos < bufferLen; pos += SNAPSHOT_SEGMENT_SIZE )
+	{
+		size_t len = std::min ( bufferLen - pos, ( size_t ) SNAPSHOT_SEGMENT_SIZE );
+		segments.push_back ( Segment ( new std::string ( buffer + pos, len ) ) );
+	}
+	index();
+}
+
+void DocumentSnapshot::index()
+{
+	length = 0;
+	starts.reserve ( segments.size() );
+	std::vector<Segment>::iterator it;
+	for ( it = segments.begin(); it != segments.end(); ++it )
+	{
+		starts.push_back ( length );
+		length += ( *it )->size();
+	}
+}
+
+size_t DocumentSnapshot::read ( size_t pos, char *buffer, size_t len ) const
+{
+	if ( pos >= length )
+		return 0;
+
+	size_t i = std::upper_bound ( starts.begin(), starts.end(), pos ) - starts.begin() - 1;
+	size_t done = 0;
+	for ( ; i < segments.size() && done < len; ++i )
+	{
+		const std::string &segment = *segments[i];
+		size_t offset = pos + done - starts[i];
+		size_t n = std::min ( segment.size() - offset, len - done );
+		memcpy ( buffer + done, segment.data() + offset, n );
+		done += n;
+	}
+	return done;
+}
+
+DocumentSnapshotCache::DocumentSnapshotCache ( wxStyledTextCtrl *ctrlParameter )
+	: ctrl ( ctrlParameter )
+{
+	insert ( 0, ctrl->GetLength() );
+}
+
+void DocumentSnapshotCache::insert ( int pos, int len )
+{
+	if ( len <= 0 )
+		return;
+
+	// the piece the text went into goes stale; at a boundary, the one before
+	size_t start = 0;
+	std::vector<Piece>::iterator it;
+	for ( it = pieces.begin(); it != pieces.end(); ++it )
+	{
+		if ( start + it->len >= ( size_t ) pos )
+			break;
+		start += it->len;
+	}
+	if ( it == pieces.end() )
+	{
+		Piece piece;
+		piece.len = 0;
+		it = pieces.insert ( it, piece );
+	}
+	it->len += len;
+	it->text.reset();
+}
+
+void DocumentSnapshotCache::remove ( int pos, int len )
+{
+	if ( len <= 0 )
+		return;
+
+	size_t start = 0, end = pos + len;
+	std::vector<Piece>::iterator it = pieces.begin();
+	while ( it != pieces.end() && start < end )
+	{
+		size_t pieceEnd = start + it->len;
+		if ( pieceEnd <= ( size_t ) pos )
+		{
+			start = pieceEnd;
+			++it;
+			continue;
+		}
+		size_t overlap = std::min ( pieceEnd, end ) - std::max ( start, ( size_t ) pos );
+		it->len -= overlap;
+		it->text.reset();
+		start = pieceEnd;
+		if ( it->len )
+			++it;
+		else
+			it = pieces.erase ( it );
+	}
+}
+
+DocumentSnapshotPtr DocumentSnapshotCache::get()
+{
+	std::vector<Piece> fresh;
+	fresh.reserve ( pieces.size() );
+
+	// runs of stale pieces are read again as one
+	size_t pos = 0, staleStart = 0;
+	bool stale = false;
+	std::vector<Piece>::iterator it;
+	for ( it = pieces.begin(); it != pieces.end(); ++it )
+	{
+		if ( it->text.get() )
+		{
+			if ( stale )
+				read ( staleStart, pos - staleStart, fresh );
+			stale = false;
+			fresh.push_back ( *it );
+		}
+		else if ( !stale )
+		{
+			stale = true;
+			staleStart = pos;
+		}
+		pos += it->len;
+	}
+	if ( stale )
+		read ( staleStart, pos - staleStart, fresh );
+	pieces.swap ( fresh );
+
+	std::vector<DocumentSnapshot::Segment> segments;
+	segments.reserve ( pieces.size() );
+	for ( it = pieces.begin(); it != pieces.end(); ++it )
+		segments.push_back ( it->text );
+	return DocumentSnapshotPtr ( new DocumentSnapshot ( segments ) );
+}
+
+void DocumentSnapshotCache::read ( size_t pos, size_t len, std::vector<Piece> &result )
+{
+	// a long stretch is split, the last segment taking up any remainder
+	size_t count = std::max ( len / SNAPSHOT_SEGMENT_SIZE, ( size_t ) 1 );
+	for ( size_t i = 0; i < count && len; ++i )
+	{
+		size_t n = ( i + 1 == count ) ? len : SNAPSHOT_SEGMENT_SIZE;
+		wxCharBuffer buffer = ctrl->GetTextRangeRaw ( pos, pos + n );
+		Piece piece;
+		piece.len = n;
+		piece.text.reset ( new std::string ( buffer.data(), n ) );
+		result.push_back ( piece );
+		pos += n;
+		len -= n;
+	}
+}
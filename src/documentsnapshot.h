@@ -0,0 +1,94 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DOCUMENT_SNAPSHOT_H
+#define DOCUMENT_SNAPSHOT_H
+
+#include <wx/wx.h>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+class wxStyledTextCtrl;
+
+// The text of a document at one moment, held as a run of segments that
+// never change once made. Snapshots and their segments are refcounted, so
+// the UI and any number of worker threads can hold the same text, and a
+// later snapshot shares every segment that no edit has touched since.
+class DocumentSnapshot
+{
+	public:
+		typedef boost::shared_ptr<const std::string> Segment;
+
+		DocumentSnapshot ( const std::vector<Segment> &segments );
+		// copies the buffer
+		DocumentSnapshot ( const char *buffer, size_t bufferLen );
+		size_t size() const
+		{
+			return length;
+		}
+		size_t getSegmentCount() const
+		{
+			return segments.size();
+		}
+		const std::string &getSegment ( size_t i ) const
+		{
+			return *segments[i];
+		}
+		// copies up to len bytes from pos and returns how many were copied
+		size_t read ( size_t pos, char *buffer, size_t len ) const;
+	private:
+		std::vector<Segment> segments;
+		std::vector<size_t> starts;
+		size_t length;
+
+		void index();
+};
+
+typedef boost::shared_ptr<const DocumentSnapshot> DocumentSnapshotPtr;
+
+// Makes snapshots of a control. The segments of the last snapshot are
+// kept along with the stretches of text the edits since have made stale,
+// so that only those are read again: after a small edit a new snapshot
+// costs one segment's worth of copying, however large the document.
+class DocumentSnapshotCache
+{
+	public:
+		DocumentSnapshotCache ( wxStyledTextCtrl *ctrl );
+
+		// to be called after text has been inserted or deleted
+		void insert ( int pos, int len );
+		void remove ( int pos, int len );
+
+		DocumentSnapshotPtr get();
+	private:
+		struct Piece
+		{
+			size_t len;
+			DocumentSnapshot::Segment text; // NULL if stale
+		};
+		wxStyledTextCtrl *ctrl;
+		std::vector<Piece> pieces;
+
+		void read ( size_t pos, size_t len, std::vector<Piece> &result );
+
+		DECLARE_NO_COPY_CLASS ( DocumentSnapshotCache )
+};
+
+#endif
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include <cctype>
+#include "fileloader.h"
+#include "textscanner.h"
+#include "xmlctrl.h"
+#include "xmlencodingspy.h"
+#include "xmlencodinghandler.h"
+#include "wrapiconv.h"
+
+// documents are parsed in blocks of this size so that progress can be
+// reported and loading cancelled
+static const size_t PARSE_BLOCK_SIZE = 1024 * 1024;
+
+// Plain ASCII text reads the same in these, so it can be handed to the
+// parser as it is; with any other encoding declared, Expat would reject the
+// declaration and the text still has to go through iconv
+static bool isAsciiReadable ( const std::string &encoding )
+{
+	std::string name;
+	for ( size_t i = 0; i < encoding.size(); ++i )
+		name += ( char ) toupper ( ( unsigned char ) encoding[i] );
+	return name.empty() ||
+	       name == "UTF-8" ||
+	       name == "US-ASCII" ||
+	       name == "ISO-8859-1";
+}
+
+// Keeps the text produced by WrapIconv in blocks of PARSE_BLOCK_SIZE, which
+// the view can take over and free one at a time, and passes it on to the
+// parser
+class TranscodingSink : public IconvSink
+{
+	public:
+		TranscodingSink (
+		    std::deque<std::string> &outputParameter,
+		    WrapExpat *weParameter, // could be NULL
+		    FileLoadMonitor *monitorParameter ) // could be NULL
+			: output ( outputParameter )
+			, we ( weParameter )
+			, monitor ( monitorParameter )
+			, weOk ( true )
+			, declarationState ( DECLARATION_UNKNOWN )
+		{
+		}
+		virtual bool write ( const char *buffer, size_t bufferLen )
+		{
+			if ( output.empty() ||
+			        output.back().size() + bufferLen > output.back().capacity() )
+			{
+				output.push_back ( std::string() );
+				output.back().reserve (
+				    ( bufferLen > PARSE_BLOCK_SIZE ) ? bufferLen : PARSE_BLOCK_SIZE );
+			}
+			output.back().append ( buffer, bufferLen );
+			feed ( buffer, bufferLen );
+			return true;
+		}
+		virtual bool progress ( size_t done, size_t total )
+		{
+			if ( !monitor || !total )
+				return true;
+			return monitor->progress ( ( int ) ( ( double ) done * 100 / total ) );
+		}
+		// returns false if the document is not well-formed
+		bool finish()
+		{
+			if ( declarationState == DECLARATION_UNKNOWN )
+				parse ( head.c_str(), head.size(), false );
+			parse ( "", 0, true );
+			return weOk;
+		}
+	private:
+		enum
+		{
+			DECLARATION_UNKNOWN,
+			DECLARATION_SKIPPING,
+			DECLARATION_DONE
+		};
+		std::deque<std::string> &output;
+		WrapExpat *we;
+		FileLoadMonitor *monitor;
+		bool weOk;
+		int declarationState;
+		std::string head;
+
+		// The XML declaration still names the original encoding, so it is
+		// withheld from the parser
+		void feed ( const char *buffer, size_t bufferLen )
+		{
+			if ( declarationState == DECLARATION_UNKNOWN )
+			{
+				size_t needed = 5 - head.size();
+				if ( needed > bufferLen )
+					needed = bufferLen;
+				head.append ( buffer, needed );
+				buffer += needed;
+				bufferLen -= needed;
+				if ( head.size() < 5 )
+					return;
+
+				if ( head == "<?xml" )
+				{
+					declarationState = DECLARATION_SKIPPING;
+				}
+				else
+				{
+					declarationState = DECLARATION_DONE;
+					parse ( head.c_str(), head.size(), false );
+				}
+				head.clear();
+			}
+			if ( declarationState == DECLARATION_SKIPPING )
+			{
+				const char *end = ( const char * ) memchr ( buffer, '>', bufferLen );
+				if ( !end )
+					return;
+				bufferLen -= end + 1 - buffer;
+				buffer = end + 1;
+				declarationState = DECLARATION_DONE;
+			}
+			parse ( buffer, bufferLen, false );
+		}
+		void parse ( const char *buffer, size_t bufferLen, bool isFinal )
+		{
+			if ( we && weOk )
+				weOk = we->parse ( buffer, bufferLen, isFinal );
+		}
+};
+
+FileLoader::FileLoader (
+    const wxString &fileNameParameter,
+    const wxString &auxPathParameter,
+    int typeParameter,
+    bool largeFileParameter,
+    bool promptMaps )
+	: fileName ( fileNameParameter )
+	, auxPath ( auxPathParameter )
+	, type ( typeParameter )
+	, largeFile ( largeFileParameter )
+	, loaded ( false )
+	, cancelled ( false )
+	, transcoded ( false )
+	, parsed ( false )
+	, wellFormed ( false )
+	, compressed ( false )
+	, buffer ( NULL )
+	, bufferLen ( 0 )
+	, parser ( new XmlSaxDispatcher() )
+{
+	// one pass of the parser checks well-formedness and, through the
+	// listeners, collects everything else needed from the document
+	if ( promptMaps && type == FILE_TYPE_XML && !largeFile )
+	{
+		promptGenerator.reset ( new XmlPromptGenerator ( fileName, auxPath ) );
+		parser->addListener ( promptGenerator.get() );
+	}
+}
+
+FileLoader::~FileLoader()
+{}
+
+bool FileLoader::load ( FileLoadMonitor *monitor )
+{
+	binaryFile.reset ( new BinaryFile ( fileName ) ); // memory-mapped where possible
+	if ( !binaryFile->getData() )
+	{
+		lastError.Printf ( _ ( "Cannot open %s" ), fileName.c_str() );
+		return false;
+	}
+	compressed = binaryFile->isCompressed();
+
+	// a large document is read through the mapped file, so that changes
+	// made to it on disk are noticed; a compressed file is inflated onto
+	// the heap instead
+	if ( largeFile && compressed )
+	{
+		lastError.Printf ( _ ( "Cannot open %s as a large document: the file is compressed" ),
+		                   fileName.c_str() );
+		return false;
+	}
+
+	// read-only view: the stages below only advance the pointer
+	const char *docBuffer = binaryFile->getData();
+	size_t docBufferLen = binaryFile->getDataLen();
+
+	loadIndex();
+
+	// a large document is shown a window at a time (see LargeFile):
+	// it stays mapped and is neither converted nor parsed
+	if ( largeFile )
+	{
+		loaded = true;
+		return true;
+	}
+
+	// one pass finds any byte order mark and whether the text is plain
+	// ASCII, which reads the same in UTF-8 and needs no conversion
+	TextScanResult scan;
+	TextScanner::scan ( docBuffer, docBufferLen, scan );
+	docBuffer += scan.signatureLen;
+	docBufferLen -= scan.signatureLen;
+
+	std::string encoding = scan.signature;
+	if ( encoding.empty() )
+	{
+		XmlEncodingSpy es;
+		es.parse ( docBuffer, docBufferLen );
+		encoding = es.getEncoding();
+		if ( encoding.empty() )  // Expat couldn't parse file
+			encoding = getApproximateEncoding ( docBuffer, docBufferLen );
+		if ( scan.ascii && isAsciiReadable ( encoding ) )
+			encoding = "US-ASCII";
+		else if ( encoding.empty() && scan.utf8 )
+			encoding = "UTF-8";
+	}
+
+	// an unchanged document whose prompt maps are cached is known to be
+	// well-formed and need not be parsed again
+	bool parse = ( type == FILE_TYPE_XML );
+	if ( parse && index.get() && index->hasPromptMaps )
+	{
+		parse = false;
+		parsed = wellFormed = true;
+		promptGenerator.reset();
+	}
+
+	// convert buffer if not UTF-8
+	if ( encoding == "UTF-8" ||
+		encoding == "utf-8" ||
+		encoding == "US-ASCII" ||
+		encoding == "us-ascii" || // US-ASCII is a subset of UTF-8
+		docBufferLen == 0 )
+	{
+		buffer = docBuffer;
+		bufferLen = docBufferLen;
+		if ( parse && bufferLen && !parseUtf8 ( monitor ) )
+			return false;
+	}
+	else if ( !transcode ( docBuffer, docBufferLen, encoding, parse, monitor ) )
+	{
+		return false;
+	}
+
+	if ( parse )
+		saveIndex();
+
+	loaded = true;
+	return true;
+}
+
+void FileLoader::loadIndex()
+{
+	if ( !IndexCache::get().isEnabled()
+	        || binaryFile->getDataLen() < INDEX_CACHE_MIN_SIZE )
+		return;
+
+	index.reset ( new DocumentIndex() );
+	IndexCache::makeKey (
+	    fileName,
+	    binaryFile->getData(),
+	    binaryFile->getDataLen(),
+	    index->key );
+	IndexCache::get().load ( fileName, *index );
+}
+
+// Keeps the prompt maps of a well-formed document for next time
+void FileLoader::saveIndex()
+{
+	if ( !index.get() || !promptGenerator.get() || !wellFormed )
+		return;
+
+	promptGenerator->getAttributeMap ( index->attributeMap );
+	promptGenerator->getRequiredAttributeMap ( index->requiredAttributeMap );
+	promptGenerator->getElementMap ( index->elementMap );
+	promptGenerator->getElementStructureMap ( index->elementStructureMap );
+	promptGenerator->getEntitySet ( index->entitySet );
+	index->grammarFound = promptGenerator->getGrammarFound();
+	promptGenerator->getGrammarFiles ( index->grammarFiles );
+	index->hasPromptMaps = true;
+	IndexCache::get().save ( fileName, *index );
+}
+
+bool FileLoader::parseUtf8 ( FileLoadMonitor *monitor )
+{
+	const char *it = buffer;
+	size_t left = bufferLen;
+	parsed = true;
+	while ( left > PARSE_BLOCK_SIZE )
+	{
+		if ( !parser->parse ( it, PARSE_BLOCK_SIZE, false ) )
+			return true; // not well-formed
+		it += PARSE_BLOCK_SIZE;
+		left -= PARSE_BLOCK_SIZE;
+
+		if ( monitor && !monitor->progress (
+		            ( int ) ( ( double ) ( bufferLen - left ) * 100 / bufferLen ) ) )
+		{
+			cancelled = true;
+			return false;
+		}
+	}
+	wellFormed = parser->parse ( it, left, true );
+	return true;
+}
+
+// Converts the document to UTF-8 a block at a time, parsing each block
+// as it is produced
+bool FileLoader::transcode (
+    const char *docBuffer,
+    size_t docBufferLen,
+    const std::string &encoding,
+    bool parse,
+    FileLoadMonitor *monitor )
+{
+	wxString wideEncoding = wxString (
+	                            encoding.c_str(),
+	                            wxConvLocal,
+	                            encoding.size() );
+	WrapIconv transcoder ( "UTF-8", encoding.c_str() );
+	if ( !transcoder.isOk() )
+	{
+		lastError.Printf ( _ ( "Cannot open %s: unknown encoding %s" ),
+		                   fileName.c_str(),
+		                   wideEncoding.c_str() );
+		return false;
+	};
+
+	TranscodingSink sink ( utf8Blocks, ( parse ) ? parser.get() : NULL, monitor );
+	if ( !transcoder.convert ( docBuffer, docBufferLen, sink ) )
+	{
+		if ( transcoder.isCancelled() )
+			cancelled = true;
+		else
+			lastError.Printf ( _ ( "Cannot open %s: conversion from encoding %s failed" ),
+			                   fileName.c_str(),
+			                   wideEncoding.c_str() );
+		return false;
+	}
+	if ( parse )
+	{
+		wellFormed = sink.finish();
+		parsed = true;
+	}
+
+	if ( utf8Blocks.empty() )
+	{
+		buffer = "";
+		bufferLen = 0;
+	}
+	else
+	{
+		buffer = utf8Blocks.front().c_str();
+		bufferLen = utf8Blocks.front().size();
+	}
+	transcoded = true;
+	return true;
+}
+
+bool FileLoader::nextBuffer()
+{
+	if ( utf8Blocks.empty() )
+		return false;
+
+	utf8Blocks.pop_front();
+	if ( utf8Blocks.empty() )
+	{
+		buffer = "";
+		bufferLen = 0;
+		return false;
+	}
+	buffer = utf8Blocks.front().c_str();
+	bufferLen = utf8Blocks.front().size();
+	return true;
+}
+
+std::string FileLoader::getApproximateEncoding ( const char *docBuffer,
+        size_t docBufferLen )
+{
+	std::string line, encoding;
+	const char *it;
+	size_t i;
+
+	// grab first line
+	for (
+	    i = 0, it = docBuffer;
+	    i < docBufferLen && *it != '\n' && i < BUFSIZ;
+	    i++, it++ )
+	{
+		if ( *it )
+			line += *it;
+	}
+
+	std::pair<int, int> limits = XmlEncodingHandler::getEncodingValueLimits ( line );
+
+	if ( limits.first == -1 || limits.second == -1 )
+		return "";
+
+	return line.substr ( limits.first, limits.second );
+}
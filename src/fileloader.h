@@ -0,0 +1,170 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef FILE_LOADER_H
+#define FILE_LOADER_H
+
+#include <wx/wx.h>
+#include <string>
+#include <deque>
+#include <memory>
+#include "binaryfile.h"
+#include "xmlsaxdispatcher.h"
+#include "xmlpromptgenerator.h"
+#include "indexcache.h"
+
+// Receives progress reports from FileLoader::load
+class FileLoadMonitor
+{
+	public:
+		virtual ~FileLoadMonitor() {}
+		// return false to cancel loading
+		virtual bool progress ( int percent ) = 0;
+};
+
+// Reads a document, converts it to UTF-8 and parses it. Nothing here
+// touches the user interface, so a document can be loaded on a worker
+// thread; MyFrame only has to create the view from the result.
+class FileLoader
+{
+	public:
+		FileLoader (
+		    const wxString &fileName,
+		    const wxString &auxPath,
+		    int type,
+		    bool largeFile,
+		    bool promptMaps );
+		~FileLoader();
+		bool load ( FileLoadMonitor *monitor = NULL );
+		bool isLoaded()
+		{
+			return loaded;
+		}
+		bool isCancelled()
+		{
+			return cancelled;
+		}
+		const wxString &getLastError()
+		{
+			return lastError;
+		}
+		const wxString &getFileName()
+		{
+			return fileName;
+		}
+		const wxString &getAuxPath()
+		{
+			return auxPath;
+		}
+		int getType()
+		{
+			return type;
+		}
+		bool isLargeFile()
+		{
+			return largeFile;
+		}
+		// true if the file was gzip-compressed
+		bool isCompressed()
+		{
+			return compressed;
+		}
+		bool isEmpty()
+		{
+			return !binaryFile.get() || !binaryFile->getDataLen();
+		}
+		// the UTF-8 text; if it had to be converted, only the first block
+		// of it, valid until nextBuffer() is called
+		const char *getBuffer()
+		{
+			return buffer;
+		}
+		size_t getBufferLen()
+		{
+			return bufferLen;
+		}
+		// frees the converted block in getBuffer() and moves on to the
+		// next; returns false once the text is used up
+		bool nextBuffer();
+		bool isTranscoded()
+		{
+			return transcoded;
+		}
+		bool isParsed()
+		{
+			return parsed;
+		}
+		bool isWellFormed()
+		{
+			return wellFormed;
+		}
+		// holds the error position and message if not well-formed
+		WrapExpat &getParser()
+		{
+			return *parser;
+		}
+		// hands the mapped file over to the caller
+		BinaryFile *releaseFile()
+		{
+			return binaryFile.release();
+		}
+		XmlPromptGenerator *getPromptGenerator() // could be NULL
+		{
+			return promptGenerator.get();
+		}
+		// hands the prompt generator over to the caller
+		XmlPromptGenerator *releasePromptGenerator()
+		{
+			return promptGenerator.release();
+		}
+		// what IndexCache had on the document, or what was found out now;
+		// NULL if the document is not cached
+		DocumentIndex *getIndex()
+		{
+			return index.get();
+		}
+	private:
+		wxString fileName, auxPath, lastError;
+		int type;
+		bool largeFile, loaded, cancelled, transcoded, parsed, wellFormed, compressed;
+		std::auto_ptr<BinaryFile> binaryFile;
+		std::deque<std::string> utf8Blocks; // the text if it had to be converted
+		const char *buffer;
+		size_t bufferLen;
+		std::auto_ptr<XmlSaxDispatcher> parser;
+		std::auto_ptr<XmlPromptGenerator> promptGenerator;
+		std::auto_ptr<DocumentIndex> index;
+
+		bool parseUtf8 ( FileLoadMonitor *monitor );
+		bool transcode (
+		    const char *docBuffer,
+		    size_t docBufferLen,
+		    const std::string &encoding,
+		    bool parse,
+		    FileLoadMonitor *monitor );
+		void loadIndex();
+		void saveIndex();
+		static std::string getApproximateEncoding (
+		    const char *docBuffer,
+		    size_t docBufferLen );
+
+		DECLARE_NO_COPY_CLASS ( FileLoader )
+};
+
+#endif
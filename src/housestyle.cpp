@@ -131,16 +131,17 @@ void HouseStyle::collectRules ( const std::string& fileName,
 	if (type == HS_TYPE_SPELL)
 		return;
 	
-	std::string filePath, buffer;
+	std::string filePath;
 	filePath = (const char *) ( ruleDirectory + pathSeparator ).mb_str() + fileName;
-	if ( !ReadFile::run ( filePath, buffer ) )
+	std::auto_ptr<BinaryFile> file ( ReadFile::view ( filePath ) );
+	if ( !file.get() )
 		return;
 
 	std::auto_ptr<XmlRuleReader> xrr ( new XmlRuleReader (
 	                                       dictionary,
 	                                       passiveDictionary,
 	                                       ruleVector ) );
-	if ( !xrr->parse ( buffer ) )
+	if ( !xrr->parse ( file->getData(), file->getDataLen() ) )
 	{
 		std::string report = xrr->getIncorrectPatternReport();
 		if ( report != "" )
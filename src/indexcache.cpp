@@ -0,0 +1,496 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include <wx/filename.h>
+#include <fstream>
+#include <sstream>
+#include "indexcache.h"
+#include "binaryfile.h"
+
+#define INDEX_CACHE_MAGIC "XCEI"
+#define GRAMMAR_CACHE_MAGIC "XCEG"
+// bump whenever the layout below changes
+#define INDEX_CACHE_VERSION 2
+#define GRAMMAR_CACHE_VERSION 1
+
+// files up to this size are hashed in full, larger ones are sampled
+#define INDEX_HASH_FULL_SIZE ( 16 * 1024 * 1024 )
+#define INDEX_HASH_SAMPLES 64
+#define INDEX_HASH_SAMPLE_SIZE ( 64 * 1024 )
+
+// 64-bit FNV-1a
+static unsigned long long hashBytes (
+    const char *data,
+    size_t dataLen,
+    unsigned long long hash = 14695981039346656037ULL )
+{
+	const unsigned char *it = ( const unsigned char * ) data;
+	const unsigned char *end = it + dataLen;
+	for ( ; it != end; ++it )
+	{
+		hash ^= *it;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Writes integers little-endian and strings as length-prefixed UTF-8
+class IndexWriter
+{
+	public:
+		IndexWriter ( std::ostream &stream ) : os ( stream ) { }
+		void put ( unsigned long long n, int bytes = 8 )
+		{
+			char buffer[8];
+			for ( int i = 0; i < bytes; ++i )
+				buffer[i] = ( char ) ( ( n >> ( i * 8 ) ) & 0xFF );
+			os.write ( buffer, bytes );
+		}
+		void put ( const wxString &s )
+		{
+			std::string utf8 = ( const char * ) s.mb_str ( wxConvUTF8 );
+			put ( utf8.size(), 4 );
+			os.write ( utf8.c_str(), utf8.size() );
+		}
+		void put ( const std::set<wxString> &set )
+		{
+			put ( set.size(), 4 );
+			std::set<wxString>::const_iterator it;
+			for ( it = set.begin(); it != set.end(); ++it )
+				put ( *it );
+		}
+		void put ( const std::map<wxString, std::set<wxString> > &map )
+		{
+			put ( map.size(), 4 );
+			std::map<wxString, std::set<wxString> >::const_iterator it;
+			for ( it = map.begin(); it != map.end(); ++it )
+			{
+				put ( it->first );
+				put ( it->second );
+			}
+		}
+	private:
+		std::ostream &os;
+};
+
+// Reads what IndexWriter wrote; once anything is out of bounds, isOk()
+// returns false and every read yields nothing
+class IndexReader
+{
+	public:
+		IndexReader ( const char *data, size_t dataLen )
+			: it ( data )
+			, end ( data + dataLen )
+			, ok ( true )
+		{
+		}
+		bool isOk()
+		{
+			return ok;
+		}
+		unsigned long long get ( int bytes = 8 )
+		{
+			if ( !ok || end - it < bytes )
+			{
+				ok = false;
+				return 0;
+			}
+			unsigned long long n = 0;
+			for ( int i = 0; i < bytes; ++i )
+				n |= ( unsigned long long ) ( unsigned char ) it[i] << ( i * 8 );
+			it += bytes;
+			return n;
+		}
+		bool get ( const char *magic, size_t len )
+		{
+			if ( !ok || ( size_t ) ( end - it ) < len || memcmp ( it, magic, len ) )
+				return ok = false;
+			it += len;
+			return true;
+		}
+		void get ( wxString &s )
+		{
+			size_t len = ( size_t ) get ( 4 );
+			if ( !ok || ( size_t ) ( end - it ) < len )
+			{
+				ok = false;
+				return;
+			}
+			s = wxString ( it, wxConvUTF8, len );
+			it += len;
+		}
+		void get ( std::set<wxString> &set )
+		{
+			size_t n = ( size_t ) get ( 4 );
+			wxString s;
+			for ( size_t i = 0; ok && i < n; ++i )
+			{
+				get ( s );
+				set.insert ( s );
+			}
+		}
+		void get ( std::map<wxString, std::set<wxString> > &map )
+		{
+			size_t n = ( size_t ) get ( 4 );
+			wxString s;
+			for ( size_t i = 0; ok && i < n; ++i )
+			{
+				get ( s );
+				get ( map[s] );
+			}
+		}
+	private:
+		const char *it, *end;
+		bool ok;
+};
+
+// DocumentIndex and GrammarIndex keep the prompt maps under the same names
+template<class Index>
+static void putPromptMaps ( IndexWriter &writer, const Index &index )
+{
+	writer.put ( index.attributeMap.size(), 4 );
+	std::map<wxString, std::map<wxString, std::set<wxString> > >::const_iterator attributes;
+	for ( attributes = index.attributeMap.begin();
+	        attributes != index.attributeMap.end();
+	        ++attributes )
+	{
+		writer.put ( attributes->first );
+		writer.put ( attributes->second );
+	}
+	writer.put ( index.requiredAttributeMap );
+	writer.put ( index.elementMap );
+	writer.put ( index.elementStructureMap.size(), 4 );
+	std::map<wxString, wxString>::const_iterator structure;
+	for ( structure = index.elementStructureMap.begin();
+	        structure != index.elementStructureMap.end();
+	        ++structure )
+	{
+		writer.put ( structure->first );
+		writer.put ( structure->second );
+	}
+	writer.put ( index.entitySet );
+}
+
+template<class Index>
+static void getPromptMaps ( IndexReader &reader, Index &index )
+{
+	size_t n = ( size_t ) reader.get ( 4 );
+	wxString element;
+	for ( size_t i = 0; reader.isOk() && i < n; ++i )
+	{
+		reader.get ( element );
+		reader.get ( index.attributeMap[element] );
+	}
+	reader.get ( index.requiredAttributeMap );
+	reader.get ( index.elementMap );
+	n = ( size_t ) reader.get ( 4 );
+	for ( size_t i = 0; reader.isOk() && i < n; ++i )
+	{
+		reader.get ( element );
+		reader.get ( index.elementStructureMap[element] );
+	}
+	reader.get ( index.entitySet );
+}
+
+IndexCache::IndexCache()
+{
+}
+
+IndexCache &IndexCache::get()
+{
+	static IndexCache cache;
+	return cache;
+}
+
+void IndexCache::setDirectory ( const wxString &directoryParameter )
+{
+	directory = directoryParameter;
+}
+
+bool IndexCache::isEnabled()
+{
+	return !directory.empty();
+}
+
+void IndexCache::makeKey (
+    const wxString &fileName,
+    const char *data,
+    size_t dataLen,
+    IndexKey &key )
+{
+	key.size = dataLen;
+	wxFileName fn ( fileName );
+	key.modified = ( fn.FileExists() ) ? fn.GetModificationTime().GetTicks() : 0;
+
+	// the size and time catch nearly all changes; sampling the contents
+	// keeps the key cheap for huge files
+	if ( dataLen <= INDEX_HASH_FULL_SIZE )
+	{
+		key.hash = hashBytes ( data, dataLen );
+		return;
+	}
+	size_t stride = ( dataLen - INDEX_HASH_SAMPLE_SIZE ) / ( INDEX_HASH_SAMPLES - 1 );
+	key.hash = hashBytes ( NULL, 0 );
+	for ( size_t i = 0; i < INDEX_HASH_SAMPLES; ++i )
+	{
+		// the last sample always ends at the end of the file
+		size_t offset = ( i + 1 < INDEX_HASH_SAMPLES ) ?
+		                i * stride : dataLen - INDEX_HASH_SAMPLE_SIZE;
+		key.hash = hashBytes ( data + offset, INDEX_HASH_SAMPLE_SIZE, key.hash );
+	}
+}
+
+wxString IndexCache::getIndexFileName ( const wxString &fileName )
+{
+	wxFileName fn ( fileName );
+	fn.Normalize();
+	std::string path = ( const char * ) fn.GetFullPath().mb_str ( wxConvUTF8 );
+
+	wxString name;
+	name.Printf ( _T ( "%016" ) wxLongLongFmtSpec _T ( "x.idx" ), hashBytes ( path.c_str(), path.size() ) );
+	return directory + wxFileName::GetPathSeparator() + name;
+}
+
+bool IndexCache::load ( const wxString &fileName, DocumentIndex &index )
+{
+	if ( !isEnabled() )
+		return false;
+
+	wxString indexFileName = getIndexFileName ( fileName );
+	if ( !wxFileName::FileExists ( indexFileName ) )
+		return false;
+
+	// the sidecar is mapped rather than read
+	BinaryFile file ( indexFileName );
+	if ( !file.getData() )
+		return false;
+
+	IndexReader reader ( file.getData(), file.getDataLen() );
+	reader.get ( INDEX_CACHE_MAGIC, 4 );
+	if ( reader.get ( 4 ) != INDEX_CACHE_VERSION
+	        || reader.get() != index.key.size
+	        || ( long long ) reader.get() != index.key.modified
+	        || reader.get() != index.key.hash
+	        || !reader.isOk() )
+		return false;
+
+	DocumentIndex cached;
+	cached.key = index.key;
+
+	size_t blocks = ( size_t ) reader.get();
+	for ( size_t i = 0; reader.isOk() && i < blocks; ++i )
+		cached.blockOffsets.push_back ( ( size_t ) reader.get() );
+	cached.lastBlockLines = ( size_t ) reader.get();
+
+	cached.hasPromptMaps = reader.get ( 1 ) != 0;
+	cached.grammarFound = reader.get ( 1 ) != 0;
+	if ( cached.hasPromptMaps )
+	{
+		size_t n = ( size_t ) reader.get ( 4 );
+		for ( size_t i = 0; reader.isOk() && i < n; ++i )
+		{
+			std::pair<wxString, long long> entry;
+			reader.get ( entry.first );
+			entry.second = ( long long ) reader.get();
+			cached.grammarFiles.push_back ( entry );
+		}
+		if ( isGrammarChanged ( cached.grammarFiles ) )
+		{
+			cached.hasPromptMaps = cached.grammarFound = false;
+			cached.grammarFiles.clear();
+		}
+		else
+		{
+			getPromptMaps ( reader, cached );
+		}
+	}
+
+	if ( !reader.isOk() )
+		return false;
+	index = cached;
+	return true;
+}
+
+bool IndexCache::save ( const wxString &fileName, const DocumentIndex &index )
+{
+	if ( !isEnabled() )
+		return false;
+
+	std::ostringstream os;
+	IndexWriter writer ( os );
+	os.write ( INDEX_CACHE_MAGIC, 4 );
+	writer.put ( INDEX_CACHE_VERSION, 4 );
+	writer.put ( index.key.size );
+	writer.put ( ( unsigned long long ) index.key.modified );
+	writer.put ( index.key.hash );
+
+	writer.put ( index.blockOffsets.size() );
+	std::vector<size_t>::const_iterator offset;
+	for ( offset = index.blockOffsets.begin(); offset != index.blockOffsets.end(); ++offset )
+		writer.put ( *offset );
+	writer.put ( index.lastBlockLines );
+
+	writer.put ( index.hasPromptMaps, 1 );
+	writer.put ( index.grammarFound, 1 );
+	if ( index.hasPromptMaps )
+	{
+		writer.put ( index.grammarFiles.size(), 4 );
+		std::vector<std::pair<wxString, long long> >::const_iterator file;
+		for ( file = index.grammarFiles.begin(); file != index.grammarFiles.end(); ++file )
+		{
+			writer.put ( file->first );
+			writer.put ( ( unsigned long long ) file->second );
+		}
+		putPromptMaps ( writer, index );
+	}
+
+	return write ( getIndexFileName ( fileName ), os.str() );
+}
+
+long long IndexCache::getModificationTime ( const wxString &fileName )
+{
+	wxFileName fn ( fileName );
+	return ( fn.FileExists() ) ? fn.GetModificationTime().GetTicks() : -1;
+}
+
+bool IndexCache::isGrammarChanged (
+    const std::vector<std::pair<wxString, long long> > &files )
+{
+	std::vector<std::pair<wxString, long long> >::const_iterator it;
+	for ( it = files.begin(); it != files.end(); ++it )
+		if ( getModificationTime ( it->first ) != it->second )
+			return true;
+	return false;
+}
+
+wxString IndexCache::getGrammarFileName (
+    const wxString &publicId,
+    const wxString &systemId )
+{
+	std::string id = ( const char * ) ( publicId + _T ( "\n" ) + systemId ).mb_str ( wxConvUTF8 );
+
+	wxString name;
+	name.Printf ( _T ( "%016" ) wxLongLongFmtSpec _T ( "x.dtd.idx" ), hashBytes ( id.c_str(), id.size() ) );
+	return directory + wxFileName::GetPathSeparator() + name;
+}
+
+bool IndexCache::loadGrammar (
+    const wxString &publicId,
+    const wxString &systemId,
+    GrammarIndex &index )
+{
+	if ( !isEnabled() )
+		return false;
+
+	wxString grammarFileName = getGrammarFileName ( publicId, systemId );
+	if ( !wxFileName::FileExists ( grammarFileName ) )
+		return false;
+
+	BinaryFile file ( grammarFileName );
+	if ( !file.getData() )
+		return false;
+
+	IndexReader reader ( file.getData(), file.getDataLen() );
+	reader.get ( GRAMMAR_CACHE_MAGIC, 4 );
+	if ( reader.get ( 4 ) != GRAMMAR_CACHE_VERSION )
+		return false;
+
+	// the identifiers are stored too, in case two pairs hash alike
+	wxString cachedPublicId, cachedSystemId;
+	reader.get ( cachedPublicId );
+	reader.get ( cachedSystemId );
+	if ( !reader.isOk() || cachedPublicId != publicId || cachedSystemId != systemId )
+		return false;
+
+	GrammarIndex cached;
+	size_t n = ( size_t ) reader.get ( 4 );
+	for ( size_t i = 0; reader.isOk() && i < n; ++i )
+	{
+		std::pair<wxString, long long> entry;
+		reader.get ( entry.first );
+		entry.second = ( long long ) reader.get();
+		cached.files.push_back ( entry );
+	}
+	if ( isGrammarChanged ( cached.files ) )
+		return false;
+	getPromptMaps ( reader, cached );
+
+	if ( !reader.isOk() )
+		return false;
+	index = cached;
+	return true;
+}
+
+bool IndexCache::saveGrammar (
+    const wxString &publicId,
+    const wxString &systemId,
+    const GrammarIndex &index )
+{
+	if ( !isEnabled() )
+		return false;
+
+	std::ostringstream os;
+	IndexWriter writer ( os );
+	os.write ( GRAMMAR_CACHE_MAGIC, 4 );
+	writer.put ( GRAMMAR_CACHE_VERSION, 4 );
+	writer.put ( publicId );
+	writer.put ( systemId );
+
+	writer.put ( index.files.size(), 4 );
+	std::vector<std::pair<wxString, long long> >::const_iterator it;
+	for ( it = index.files.begin(); it != index.files.end(); ++it )
+	{
+		writer.put ( it->first );
+		writer.put ( ( unsigned long long ) it->second );
+	}
+	putPromptMaps ( writer, index );
+
+	return write ( getGrammarFileName ( publicId, systemId ), os.str() );
+}
+
+bool IndexCache::write ( const wxString &fileName, const std::string &data )
+{
+	if ( !wxFileName::DirExists ( directory )
+	        && !wxFileName::Mkdir ( directory, 0777, wxPATH_MKDIR_FULL ) )
+		return false;
+
+	// written under another name and renamed, so that a reader never
+	// sees a partial index
+	wxString tempName = wxFileName::CreateTempFileName ( fileName );
+	if ( tempName.empty() )
+		return false;
+
+	std::ofstream ofs (
+	    ( const char * ) tempName.mb_str ( wxConvLocal ),
+	    std::ios::out | std::ios::binary );
+	if ( !ofs )
+	{
+		wxRemoveFile ( tempName );
+		return false;
+	}
+	ofs.write ( data.c_str(), data.size() );
+	ofs.close();
+	if ( ofs.fail() || !wxRenameFile ( tempName, fileName, true ) )
+	{
+		wxRemoveFile ( tempName );
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef INDEX_CACHE_H
+#define INDEX_CACHE_H
+
+#include <wx/wx.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+
+// documents smaller than this are quick enough to index from scratch
+#define INDEX_CACHE_MIN_SIZE ( 1024 * 1024 )
+
+// Identifies one version of a file's contents
+struct IndexKey
+{
+	unsigned long long size, hash;
+	long long modified;
+};
+
+// What is worked out about a document when it is opened, kept so that an
+// unchanged document can be reopened without doing the work again
+struct DocumentIndex
+{
+	DocumentIndex()
+		: lastBlockLines ( 0 )
+		, hasPromptMaps ( false )
+		, grammarFound ( false )
+	{
+		key.size = key.hash = 0;
+		key.modified = 0;
+	}
+	IndexKey key;
+
+	// LargeFile block offsets, if the document has been opened windowed
+	std::vector<size_t> blockOffsets;
+	size_t lastBlockLines;
+
+	// prompt maps, if the document has been parsed; only well-formed
+	// documents are indexed
+	bool hasPromptMaps, grammarFound;
+	// the DTD and schema files they were built from, with their
+	// modification times (-1 if missing)
+	std::vector<std::pair<wxString, long long> > grammarFiles;
+	std::map<wxString, std::map<wxString, std::set<wxString> > >
+	attributeMap;
+	std::map<wxString, std::set<wxString> > requiredAttributeMap;
+	std::map<wxString, std::set<wxString> > elementMap;
+	std::map<wxString, wxString> elementStructureMap;
+	std::set<wxString> entitySet;
+};
+
+// The prompt maps compiled from an external DTD, with every file that was
+// read for them
+struct GrammarIndex
+{
+	// path and modification time (-1 if it could not be found)
+	std::vector<std::pair<wxString, long long> > files;
+
+	std::map<wxString, std::map<wxString, std::set<wxString> > >
+	attributeMap;
+	std::map<wxString, std::set<wxString> > requiredAttributeMap;
+	std::map<wxString, std::set<wxString> > elementMap;
+	std::map<wxString, wxString> elementStructureMap;
+	std::set<wxString> entitySet;
+};
+
+// Keeps a DocumentIndex for each large document in a sidecar file in the
+// cache directory. An index is only used if the file's size, modification
+// time and a hash of its contents still match. The prompt maps also depend
+// on any grammar the document refers to, so they are dropped if any of its
+// files has been modified since; the rest of the index is still used.
+//
+// It also keeps a GrammarIndex for each external DTD, keyed by its public
+// and resolved system identifiers, so that DTDs made of many modules are
+// not parsed again for every document. A GrammarIndex is only used if
+// none of the files it was read from has been modified since; a change in
+// how the catalog resolves an identifier is not noticed.
+//
+// The cache holds no state besides its directory, so loaders on worker
+// threads may use it at the same time.
+class IndexCache
+{
+	public:
+		static IndexCache &get();
+
+		// an empty directory disables the cache
+		void setDirectory ( const wxString &directory );
+		bool isEnabled();
+
+		static void makeKey (
+		    const wxString &fileName,
+		    const char *data,
+		    size_t dataLen,
+		    IndexKey &key );
+		// index.key must be set; returns false if nothing matching is cached
+		bool load ( const wxString &fileName, DocumentIndex &index );
+		bool save ( const wxString &fileName, const DocumentIndex &index );
+
+		static long long getModificationTime ( const wxString &fileName );
+		// true if any of the files has been modified, created or removed
+		static bool isGrammarChanged (
+		    const std::vector<std::pair<wxString, long long> > &files );
+		// returns false if nothing up to date is cached
+		bool loadGrammar (
+		    const wxString &publicId,
+		    const wxString &systemId,
+		    GrammarIndex &index );
+		bool saveGrammar (
+		    const wxString &publicId,
+		    const wxString &systemId,
+		    const GrammarIndex &index );
+	private:
+		IndexCache();
+		wxString directory;
+
+		wxString getIndexFileName ( const wxString &fileName );
+		wxString getGrammarFileName (
+		    const wxString &publicId,
+		    const wxString &systemId );
+		bool write ( const wxString &fileName, const std::string &data );
+
+		IndexCache ( const IndexCache& );
+		IndexCache& operator= ( const IndexCache& );
+};
+
+#endif
@@ -82,21 +82,22 @@ void InsertPanel::update (
 		if ( lastDoc )
 		{
 			lastDoc = NULL;
+			lastParent = wxEmptyString;
 			edit->SetValue ( wxEmptyString );
 			list->Clear();
-			list->Show ( false );
+			showList ( false );
 		}
 		return;
 	}
 
-	bool refreshEntities = false;
+	bool docChanged = false;
 	if ( doc != lastDoc )
 	{
-		refreshEntities = true;
+		docChanged = true;
 		lastDoc = doc;
 	}
 
-	if ( type == INSERT_PANEL_TYPE_ENTITY && refreshEntities )
+	if ( type == INSERT_PANEL_TYPE_ENTITY && docChanged )
 	{
 		list->Clear();
 		lastDoc = doc;
@@ -104,7 +105,7 @@ void InsertPanel::update (
 		std::set<wxString>::const_iterator it;
 		for ( it = entitySet.begin(); it != entitySet.end(); it++ )
 			list->Append ( *it );
-		list->Show ( true );
+		showList ( true );
 #if wxCHECK_VERSION(2,9,0)
 		list->Update();
 #else
@@ -113,7 +114,7 @@ void InsertPanel::update (
 		return;
 	}
 
-	if ( parent == lastParent )
+	if ( parent == lastParent && !docChanged )
 		return;
 	lastParent = parent;
 
@@ -127,21 +128,21 @@ void InsertPanel::update (
 	list->Clear();
 	if ( parent.empty() || ( ( type == INSERT_PANEL_TYPE_SIBLING ) && grandparent.empty() ) )
 	{
-		list->Show ( false );
+		showList ( false );
 		return;
 	}
 
-	const std::set<wxString> &elementSet = doc->getChildren (
-	            ( type == INSERT_PANEL_TYPE_SIBLING ) ? grandparent : parent );
-	if ( elementSet.empty() )
+	wxArrayString elements;
+	doc->getChildren (
+	    ( type == INSERT_PANEL_TYPE_SIBLING ) ? grandparent : parent,
+	    elements );
+	if ( elements.IsEmpty() )
 	{
-		list->Show ( false );
+		showList ( false );
 		return;
 	}
-	std::set<wxString>::const_iterator it;
-	for ( it = elementSet.begin(); it != elementSet.end(); it++ )
-		list->Append ( *it );
-	list->Show ( true );
+	list->Append ( elements );
+	showList ( true );
 #if wxCHECK_VERSION(2,9,0)
 	list->Update();
 #else
@@ -149,6 +150,15 @@ void InsertPanel::update (
 #endif
 }
 
+// Shows or hides the list, laying the panel out again if that changes it
+void InsertPanel::showList ( bool show )
+{
+	if ( list->IsShown() == show )
+		return;
+	list->Show ( show );
+	sizer->Layout();
+}
+
 void InsertPanel::OnEnter ( wxCommandEvent& event )
 {
 	if ( !doc )
@@ -58,6 +58,7 @@ class InsertPanel : public wxPanel
 		XmlDoc *doc, *lastDoc;
 
 		void handleChoice ( const wxString& choice );
+		void showList ( bool show );
 		DECLARE_EVENT_TABLE()
 };
 
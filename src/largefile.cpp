@@ -0,0 +1,417 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include "largefile.h"
+#include "textscanner.h"
+
+static bool equalNoCase ( char a, char b )
+{
+	return tolower ( ( unsigned char ) a ) == tolower ( ( unsigned char ) b );
+}
+
+static bool matchAt (
+    const std::string &text,
+    size_t pos,
+    const std::string &s,
+    bool matchCase )
+{
+	if ( pos + s.size() > text.size() )
+		return false;
+	return ( matchCase ) ?
+	       std::equal ( s.begin(), s.end(), text.begin() + pos ) :
+	       std::equal ( s.begin(), s.end(), text.begin() + pos, equalNoCase );
+}
+
+// returns end if s is not found
+static const char *searchRange (
+    const char *begin,
+    const char *end,
+    const std::string &s,
+    bool matchCase,
+    bool forward )
+{
+	if ( forward )
+		return ( matchCase ) ?
+		       std::search ( begin, end, s.begin(), s.end() ) :
+		       std::search ( begin, end, s.begin(), s.end(), equalNoCase );
+	return ( matchCase ) ?
+	       std::find_end ( begin, end, s.begin(), s.end() ) :
+	       std::find_end ( begin, end, s.begin(), s.end(), equalNoCase );
+}
+
+LargeFile::LargeFile ( BinaryFile *fileParameter )
+	: file ( fileParameter )
+	, data ( fileParameter->getData() )
+	, dataLen ( fileParameter->getDataLen() )
+	, bom ( false )
+	, scanned ( 0 )
+	, scannedLines ( 0 )
+	, lastBlockLines ( 0 )
+	, indexed ( false )
+	, fileChanged ( false )
+{
+	if ( dataLen >= 3 &&
+	        ( unsigned char ) data[0] == 0xEF &&
+	        ( unsigned char ) data[1] == 0xBB &&
+	        ( unsigned char ) data[2] == 0xBF )
+	{
+		data += 3;
+		dataLen -= 3;
+		bom = true;
+	}
+	offsets.push_back ( 0 );
+}
+
+LargeFile::~LargeFile()
+{}
+
+bool LargeFile::index ( size_t maxBytes )
+{
+	wxCriticalSectionLocker locker ( indexSection );
+
+	if ( indexed || fileChanged )
+		return false;
+	if ( file->isChanged() )
+	{
+		fileChanged = true;
+		return false;
+	}
+
+	size_t end = ( maxBytes < dataLen - scanned ) ? scanned + maxBytes : dataLen;
+	const char *it = data + scanned;
+	const char *stop = data + end;
+	while ( it < stop )
+	{
+		size_t wanted = LARGE_FILE_BLOCK_LINES - scannedLines;
+		size_t left = wanted;
+		it = TextScanner::skipLines ( it, stop, left );
+		scannedLines += wanted - left;
+		if ( scannedLines == LARGE_FILE_BLOCK_LINES )
+		{
+			offsets.push_back ( it - data );
+			scannedLines = 0;
+		}
+	}
+	scanned = end;
+
+	if ( scanned == dataLen )
+	{
+		indexed = true;
+		lastBlockLines = scannedLines;
+	}
+	return !indexed;
+}
+
+bool LargeFile::isFileChanged()
+{
+	wxCriticalSectionLocker locker ( indexSection );
+	if ( !fileChanged )
+		fileChanged = file->isChanged();
+	return fileChanged;
+}
+
+bool LargeFile::isIndexed()
+{
+	wxCriticalSectionLocker locker ( indexSection );
+	return indexed;
+}
+
+int LargeFile::getIndexedPercent()
+{
+	wxCriticalSectionLocker locker ( indexSection );
+	if ( !dataLen )
+		return 100;
+	return ( int ) ( ( double ) scanned * 100 / dataLen );
+}
+
+bool LargeFile::restoreIndex (
+    const std::vector<size_t> &blockOffsets,
+    size_t lastBlockLinesParameter )
+{
+	if ( blockOffsets.empty() || blockOffsets[0] != 0
+	        || blockOffsets.back() > dataLen
+	        || lastBlockLinesParameter > LARGE_FILE_BLOCK_LINES )
+		return false;
+	for ( size_t i = 1; i < blockOffsets.size(); ++i )
+		if ( blockOffsets[i] <= blockOffsets[i - 1] )
+			return false;
+
+	wxCriticalSectionLocker locker ( indexSection );
+	offsets = blockOffsets;
+	lastBlockLines = lastBlockLinesParameter;
+	scanned = dataLen;
+	scannedLines = lastBlockLines;
+	indexed = true;
+	return true;
+}
+
+bool LargeFile::getIndex (
+    std::vector<size_t> &blockOffsets,
+    size_t &lastBlockLinesParameter )
+{
+	wxCriticalSectionLocker locker ( indexSection );
+	if ( !indexed )
+		return false;
+	blockOffsets = offsets;
+	lastBlockLinesParameter = lastBlockLines;
+	return true;
+}
+
+size_t LargeFile::getBlockCount()
+{
+	wxCriticalSectionLocker locker ( indexSection );
+
+	// until the end of the file is reached, the last offset only marks
+	// the start of a block
+	return ( indexed ) ? offsets.size() : offsets.size() - 1;
+}
+
+void LargeFile::getBlockData ( size_t block, const char *&text, size_t &len )
+{
+	std::map<size_t, Edit>::iterator it = overlay.find ( block );
+	if ( it != overlay.end() )
+	{
+		text = it->second.text.data();
+		len = it->second.text.size();
+		return;
+	}
+
+	wxCriticalSectionLocker locker ( indexSection );
+	size_t start = offsets[block];
+	size_t end = ( block + 1 < offsets.size() ) ? offsets[block + 1] : dataLen;
+	text = data + start;
+	len = end - start;
+}
+
+void LargeFile::getBlockText ( size_t block, std::string &text )
+{
+	const char *blockText;
+	size_t len;
+	getBlockData ( block, blockText, len );
+	text.assign ( blockText, len );
+}
+
+void LargeFile::setBlockText ( size_t block, const std::string &text )
+{
+	const char *original;
+	size_t len;
+	overlay.erase ( block );
+	getBlockData ( block, original, len );
+
+	if ( len == text.size() && !memcmp ( original, text.data(), len ) )
+		return;
+
+	Edit &edit = overlay[block];
+	edit.text = text;
+	edit.lines = std::count ( text.begin(), text.end(), '\n' );
+}
+
+size_t LargeFile::getBlockLines ( size_t block )
+{
+	std::map<size_t, Edit>::iterator it = overlay.find ( block );
+	if ( it != overlay.end() )
+		return it->second.lines;
+
+	wxCriticalSectionLocker locker ( indexSection );
+	return ( indexed && block + 1 == offsets.size() ) ?
+	       lastBlockLines : LARGE_FILE_BLOCK_LINES;
+}
+
+size_t LargeFile::getFirstLine ( size_t block )
+{
+	size_t line = block * LARGE_FILE_BLOCK_LINES;
+	std::map<size_t, Edit>::iterator it;
+	for ( it = overlay.begin(); it != overlay.end() && it->first < block; ++it )
+	{
+		line += it->second.lines;
+		line -= LARGE_FILE_BLOCK_LINES;
+	}
+	return line;
+}
+
+size_t LargeFile::findBlock ( size_t line )
+{
+	for ( ;; )
+	{
+		size_t count = getBlockCount();
+		size_t block = 0, first = 0, found = ( size_t ) -1;
+
+		// blocks between the edited ones have the standard length
+		std::map<size_t, Edit>::iterator it;
+		for ( it = overlay.begin(); it != overlay.end(); ++it )
+		{
+			size_t span = ( it->first - block ) * LARGE_FILE_BLOCK_LINES;
+			if ( line < first + span )
+				break;
+			first += span;
+			block = it->first;
+			if ( line < first + it->second.lines )
+			{
+				found = block;
+				break;
+			}
+			first += it->second.lines;
+			block = it->first + 1;
+		}
+		if ( found == ( size_t ) -1 )
+			found = block + ( line - first ) / LARGE_FILE_BLOCK_LINES;
+
+		if ( found < count )
+			return found;
+		if ( !index() )
+			return ( getBlockCount() ) ? getBlockCount() - 1 : 0;
+	}
+}
+
+bool LargeFile::findInBlock (
+    const std::string &s,
+    bool matchCase,
+    bool forward,
+    size_t block,
+    size_t from,
+    size_t to,
+    size_t &offset )
+{
+	const char *text;
+	size_t len;
+	getBlockData ( block, text, len );
+	if ( to > len )
+		to = len;
+	if ( from >= to )
+		return false;
+
+	// matches that run on into the next block
+	std::string joined;
+	size_t tailStart = ( len - from > s.size() - 1 ) ? len - ( s.size() - 1 ) : from;
+	if ( tailStart < to && block + 1 < getBlockCount() )
+	{
+		const char *next;
+		size_t nextLen;
+		joined.assign ( text + tailStart, len - tailStart );
+		getBlockData ( block + 1, next, nextLen );
+		joined.append ( next, std::min ( nextLen, s.size() - 1 ) );
+	}
+	size_t limit = ( tailStart < to ) ? to - tailStart : 0;
+
+	if ( !forward )
+	{
+		for ( size_t p = limit; p > 0; --p )
+		{
+			if ( matchAt ( joined, p - 1, s, matchCase ) )
+			{
+				offset = tailStart + p - 1;
+				return true;
+			}
+		}
+	}
+
+	const char *end = text + std::min ( len, to + s.size() - 1 );
+	const char *hit = searchRange ( text + from, end, s, matchCase, forward );
+	if ( hit != end )
+	{
+		offset = hit - text;
+		return true;
+	}
+
+	if ( forward )
+	{
+		for ( size_t p = 0; p < limit; ++p )
+		{
+			if ( matchAt ( joined, p, s, matchCase ) )
+			{
+				offset = tailStart + p;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool LargeFile::find (
+    const std::string &s,
+    bool matchCase,
+    bool forward,
+    size_t &block,
+    size_t &offset )
+{
+	size_t count = getBlockCount();
+	if ( s.empty() || !count )
+		return false;
+	if ( block >= count )
+		block = count - 1;
+
+	size_t found;
+	if ( ( forward ) ?
+	        findInBlock ( s, matchCase, true, block, offset, ( size_t ) -1, found ) :
+	        findInBlock ( s, matchCase, false, block, 0, offset, found ) )
+	{
+		offset = found;
+		return true;
+	}
+
+	// the last pass takes in the whole of the starting block
+	for ( size_t i = 1; i <= count; ++i )
+	{
+		size_t b = ( forward ) ?
+		           ( block + i ) % count : ( block + count - i ) % count;
+		if ( findInBlock ( s, matchCase, forward, b, 0, ( size_t ) -1, found ) )
+		{
+			block = b;
+			offset = found;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LargeFile::write ( std::ostream &os, size_t &bytes )
+{
+	size_t count, rest;
+	{
+		wxCriticalSectionLocker locker ( indexSection );
+		count = ( indexed ) ? offsets.size() : offsets.size() - 1;
+		rest = ( indexed ) ? dataLen : offsets[count];
+	}
+
+	bytes = 0;
+	if ( bom )
+	{
+		os.write ( "\xEF\xBB\xBF", 3 );
+		bytes += 3;
+	}
+
+	const char *text;
+	size_t len;
+	for ( size_t block = 0; block < count && os; ++block )
+	{
+		getBlockData ( block, text, len );
+		os.write ( text, len );
+		bytes += len;
+	}
+
+	// the part of the file that has not been indexed yet is unchanged
+	os.write ( data + rest, dataLen - rest );
+	bytes += dataLen - rest;
+
+	return !os.fail();
+}
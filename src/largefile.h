@@ -0,0 +1,132 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef LARGE_FILE_H
+#define LARGE_FILE_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include <memory>
+#include "binaryfile.h"
+
+// number of lines in each block of a windowed document
+#define LARGE_FILE_BLOCK_LINES 2000
+// bytes scanned for line breaks per call to LargeFile::index()
+#define LARGE_FILE_INDEX_STEP ( 4 * 1024 * 1024 )
+
+// A UTF-8 document that stays memory-mapped while it is edited. The file
+// is split into blocks of LARGE_FILE_BLOCK_LINES lines; the index of block
+// offsets is built lazily (normally by a LargeFileIndexThread) and the view
+// only ever holds a few blocks. Blocks that have been edited are kept in an
+// overlay, so finding text and saving work on the mapped file with the
+// overlay spliced in.
+//
+// index() and the block lookups may be called from different threads;
+// the overlay belongs to the main thread.
+class LargeFile
+{
+	public:
+		LargeFile ( BinaryFile *file ); // takes ownership
+		~LargeFile();
+
+		// indexes the next stretch of the file; returns false once done
+		bool index ( size_t maxBytes = LARGE_FILE_INDEX_STEP );
+		bool isIndexed();
+		int getIndexedPercent();
+		// takes the block offsets found by an earlier index() of the same
+		// file (see IndexCache); returns false if they do not fit
+		bool restoreIndex (
+		    const std::vector<size_t> &blockOffsets,
+		    size_t lastBlockLines );
+		// returns false until the whole file has been indexed
+		bool getIndex (
+		    std::vector<size_t> &blockOffsets,
+		    size_t &lastBlockLines );
+		// number of blocks whose extent is known
+		size_t getBlockCount();
+
+		void getBlockText ( size_t block, std::string &text );
+		void setBlockText ( size_t block, const std::string &text );
+		// zero-based number of the block's first line, allowing for edits
+		size_t getFirstLine ( size_t block );
+		// block containing the line; indexes as far as needed
+		size_t findBlock ( size_t line );
+
+		// looks for s after (or before) the byte offset within the block,
+		// wrapping around the file; on success block and offset are set
+		// to the position of the match
+		bool find (
+		    const std::string &s,
+		    bool matchCase,
+		    bool forward,
+		    size_t &block,
+		    size_t &offset );
+		// writes the mapped file with the overlay applied
+		bool write ( std::ostream &os, size_t &bytes );
+
+		bool isModified()
+		{
+			return !overlay.empty();
+		}
+		// true once the mapped file has been changed by someone else;
+		// nothing more may then be read from it
+		bool isFileChanged();
+		size_t getSize()
+		{
+			return dataLen;
+		}
+	private:
+		struct Edit
+		{
+			std::string text;
+			size_t lines;
+		};
+
+		std::auto_ptr<BinaryFile> file;
+		const char *data;
+		size_t dataLen;
+		bool bom;
+
+		wxCriticalSection indexSection;
+		std::vector<size_t> offsets; // start of each block
+		size_t scanned, scannedLines, lastBlockLines;
+		bool indexed, fileChanged;
+
+		std::map<size_t, Edit> overlay;
+
+		void getBlockData ( size_t block, const char *&text, size_t &len );
+		size_t getBlockLines ( size_t block );
+		bool findInBlock (
+		    const std::string &s,
+		    bool matchCase,
+		    bool forward,
+		    size_t block,
+		    size_t from,
+		    size_t to,
+		    size_t &offset );
+
+		DECLARE_NO_COPY_CLASS ( LargeFile )
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "largefileindexthread.h"
+
+extern wxCriticalSection xmlcopyeditorCriticalSection;
+
+DEFINE_EVENT_TYPE(wxEVT_COMMAND_LARGE_FILE_INDEXED);
+
+LargeFileIndexThread::LargeFileIndexThread (
+	wxEvtHandler *handler,
+	LargeFile *file )
+	: wxThread ( wxTHREAD_JOINABLE )
+	, myEventHandler ( handler )
+	, myFile ( file )
+	, mStopping ( false )
+{
+}
+
+void *LargeFileIndexThread::Entry()
+{
+	int lastPercent = -1;
+	bool more = true;
+	while ( more && !TestDestroy() )
+	{
+		more = myFile->index();
+
+		int percent = ( more ) ? myFile->getIndexedPercent() : 100;
+		if ( percent == lastPercent )
+			continue;
+		lastPercent = percent;
+
+		wxCriticalSectionLocker locker ( xmlcopyeditorCriticalSection );
+		if ( !TestDestroy() )
+		{
+			wxCommandEvent event ( wxEVT_COMMAND_LARGE_FILE_INDEXED );
+			event.SetInt ( percent );
+			wxPostEvent ( myEventHandler, event );
+		}
+	}
+	return NULL;
+}
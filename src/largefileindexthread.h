@@ -0,0 +1,49 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef LARGE_FILE_INDEX_THREAD_H
+#define LARGE_FILE_INDEX_THREAD_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include "largefile.h"
+
+DECLARE_EVENT_TYPE(wxEVT_COMMAND_LARGE_FILE_INDEXED, wxID_ANY);
+
+// Builds the block index of a LargeFile in the background. Progress is
+// reported to the handler with wxEVT_COMMAND_LARGE_FILE_INDEXED, with the
+// percentage indexed in GetInt(); 100 means the index is complete.
+class LargeFileIndexThread : public wxThread
+{
+public:
+	LargeFileIndexThread ( wxEvtHandler *handler, LargeFile *file );
+	virtual void *Entry();
+
+	virtual void Cancel() { mStopping = true; }
+	virtual bool TestDestroy() { return mStopping || wxThread::TestDestroy(); }
+
+protected:
+	wxEvtHandler *myEventHandler;
+	LargeFile *myFile;
+
+	bool mStopping;
+};
+
+#endif
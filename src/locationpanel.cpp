@@ -77,7 +77,7 @@ void LocationPanel::update (
 	if ( !doc )
 	{
         edit->SetValue ( wxEmptyString );
-		structureEdit->Show ( false );
+		showStructure ( false );
 		return;
 	}
 	else
@@ -87,7 +87,7 @@ void LocationPanel::update (
 		if (!structure.empty () )
 		{
 			indentStructure( structure );
-			structureEdit->Show ( true );
+			showStructure ( true );
 			structureEdit->SetReadOnly ( false );
 			structureEdit->SetText ( structure );
 			structureEdit->SetReadOnly ( true );
@@ -99,7 +99,7 @@ void LocationPanel::update (
 		}
 		else
 		{
-			structureEdit->Show ( false );
+			showStructure ( false );
 		}
 	}
 	
@@ -110,6 +110,16 @@ void LocationPanel::update (
 	
 }
 
+// Shows or hides the content model, laying the panel out again if that
+// changes it
+void LocationPanel::showStructure ( bool show )
+{
+	if ( structureEdit->IsShown() == show )
+		return;
+	structureEdit->Show ( show );
+	sizer->Layout();
+}
+
 void LocationPanel::indentStructure ( wxString& structure )
 {
 	wxString indented;
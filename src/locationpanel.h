@@ -35,6 +35,7 @@ class LocationPanel : public wxPanel
 		    const wxString& parent = wxEmptyString );
 	private:
 		void indentStructure ( wxString& structure );
+		void showStructure ( bool show );
 		MyFrame *parentWindow;
 		XmlDoc *doc;
 		wxBoxSizer *sizer;
@@ -75,7 +75,9 @@ bool MyServerConnection::OnPoke (
 	}
 	else
 	{
-		frame->openFile ( ( wxString& ) item );
+		wxArrayString fileNames;
+		fileNames.Add ( item );
+		frame->openFiles ( fileNames ); // loaded in the background
 		//frame->addToFileQueue ( ( wxString& ) item ); // prevent event loop problems
 	}
 	frame->Raise();
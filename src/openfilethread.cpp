@@ -0,0 +1,87 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "openfilethread.h"
+#include "threadreaper.h"
+
+extern wxCriticalSection xmlcopyeditorCriticalSection;
+
+DEFINE_EVENT_TYPE(wxEVT_COMMAND_OPEN_FILE_PROGRESS);
+DEFINE_EVENT_TYPE(wxEVT_COMMAND_OPEN_FILE_COMPLETED);
+
+OpenFileThread::OpenFileThread (
+	wxEvtHandler *handler,
+	FileLoader *loader )
+	: wxThread ( wxTHREAD_JOINABLE )
+	, myEventHandler ( handler )
+	, myLoader ( loader )
+	, myLastPercent ( 0 )
+	, myIsStarted ( false )
+	, myIsFinished ( false )
+	, myIsPrefetch ( false )
+	, myPercent ( 0 )
+	, mStopping ( false )
+{
+}
+
+void *OpenFileThread::Entry()
+{
+	if ( !TestDestroy() )
+		myLoader->load ( this );
+
+	wxCriticalSectionLocker locker ( xmlcopyeditorCriticalSection );
+
+	// a cancelled thread has been handed to the ThreadReaper and must
+	// not report back
+	if ( !TestDestroy() )
+	{
+		wxCommandEvent event ( wxEVT_COMMAND_OPEN_FILE_COMPLETED );
+		event.SetClientData ( this );
+		wxPostEvent ( myEventHandler, event );
+	}
+
+	return NULL;
+}
+
+bool OpenFileThread::progress ( int percent )
+{
+	if ( TestDestroy() )
+		return false;
+	if ( percent == myLastPercent )
+		return true;
+	myLastPercent = percent;
+
+	wxCriticalSectionLocker locker ( xmlcopyeditorCriticalSection );
+
+	if ( !TestDestroy() )
+	{
+		wxCommandEvent event ( wxEVT_COMMAND_OPEN_FILE_PROGRESS );
+		event.SetInt ( percent );
+		event.SetClientData ( this );
+		wxPostEvent ( myEventHandler, event );
+	}
+	return true;
+}
+
+void OpenFileThread::PendingDelete ()
+{
+	Cancel();
+
+	ThreadReaper::get().add ( this );
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPEN_FILE_THREAD_H
+#define OPEN_FILE_THREAD_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <memory>
+#include "fileloader.h"
+
+DECLARE_EVENT_TYPE(wxEVT_COMMAND_OPEN_FILE_PROGRESS, wxID_ANY);
+DECLARE_EVENT_TYPE(wxEVT_COMMAND_OPEN_FILE_COMPLETED, wxID_ANY);
+
+// Runs a FileLoader in the background. The thread reports to the handler
+// with wxEVT_COMMAND_OPEN_FILE_PROGRESS (percentage in GetInt()) and, when
+// done, wxEVT_COMMAND_OPEN_FILE_COMPLETED; GetClientData() of both events
+// is the thread itself.
+class OpenFileThread : public wxThread, public FileLoadMonitor
+{
+public:
+	OpenFileThread ( wxEvtHandler *handler, FileLoader *loader );
+	virtual void *Entry();
+	virtual bool progress ( int percent );
+	FileLoader &getLoader() { return *myLoader; }
+
+	// bookkeeping for the handler; only used on the main thread
+	bool isStarted() { return myIsStarted; }
+	void setStarted() { myIsStarted = true; }
+	bool isFinished() { return myIsFinished; }
+	void setFinished() { myIsFinished = true; }
+	int getPercent() { return myPercent; }
+	void setPercent ( int percent ) { myPercent = percent; }
+	// the file is meant for a placeholder tab rather than a new one
+	bool isPrefetch() { return myIsPrefetch; }
+	void setPrefetch() { myIsPrefetch = true; }
+
+	void PendingDelete();
+	virtual void Cancel() { mStopping = true; }
+	virtual bool TestDestroy() { return mStopping || wxThread::TestDestroy(); }
+
+protected:
+	wxEvtHandler *myEventHandler;
+	std::auto_ptr<FileLoader> myLoader;
+	int myLastPercent;
+	bool myIsStarted, myIsFinished, myIsPrefetch;
+	int myPercent;
+
+	bool mStopping;
+};
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "outlinepanel.h"
+#include "xmldoc.h"
+#include "tagindex.h"
+
+// most children an element shows before they are put into groups
+#define OUTLINE_GROUP_SIZE 1000
+
+BEGIN_EVENT_TABLE ( OutlinePanel, wxPanel )
+	EVT_TREE_ITEM_EXPANDING ( wxID_ANY, OutlinePanel::OnItemExpanding )
+	EVT_TREE_ITEM_COLLAPSED ( wxID_ANY, OutlinePanel::OnItemCollapsed )
+	EVT_TREE_SEL_CHANGED ( wxID_ANY, OutlinePanel::OnSelectionChanged )
+	EVT_TREE_ITEM_ACTIVATED ( wxID_ANY, OutlinePanel::OnItemActivated )
+END_EVENT_TABLE()
+
+OutlinePanel::OutlinePanel ( wxWindow *parentWindowParameter, int id ) :
+		wxPanel ( parentWindowParameter, id ), doc ( NULL ), index ( NULL ), updating ( false )
+{
+	parentWindow = ( MyFrame * ) parentWindowParameter;
+
+	int width = 150;
+	SetSize ( wxSize ( width, -1 ) );
+
+	sizer = new wxBoxSizer ( wxVERTICAL );
+	SetSizer ( sizer );
+
+	tree = new wxTreeCtrl (
+	    this,
+	    wxID_ANY,
+	    wxDefaultPosition,
+	    wxDefaultSize,
+	    wxTR_DEFAULT_STYLE | wxTR_HIDE_ROOT | wxTR_LINES_AT_ROOT | wxTR_SINGLE );
+
+	sizer->Add ( tree, 1, wxGROW | wxTOP, 0 );
+	sizer->Layout();
+}
+
+void OutlinePanel::update ( XmlDoc *docParameter )
+{
+	if ( docParameter != doc )
+	{
+		doc = docParameter;
+		rebuild();
+		return;
+	}
+	if ( !index )
+		return;
+
+	int first, oldEnd, newEnd;
+	bool nesting;
+	if ( !index->takeChanges ( first, oldEnd, newEnd, nesting ) )
+		return;
+
+	wxTreeItemId root = tree->GetRootItem();
+	if ( !root.IsOk() )
+		return;
+	updating = true;
+	tree->Freeze();
+	if ( nesting )
+	{
+		renumber ( root, first, oldEnd, newEnd );
+		reconcile ( root );
+	}
+	else
+		relabel ( root, first, newEnd );
+	tree->Thaw();
+	updating = false;
+}
+
+void OutlinePanel::OnItemExpanding ( wxTreeEvent &event )
+{
+	wxTreeItemId item = event.GetItem();
+	if ( updating || !index || tree->GetChildrenCount ( item, false ) )
+		return;
+
+	updating = true;
+	reconcile ( item );
+	if ( !tree->GetChildrenCount ( item, false ) )
+		tree->SetItemHasChildren ( item, false );
+	updating = false;
+}
+
+void OutlinePanel::OnItemCollapsed ( wxTreeEvent &event )
+{
+	if ( updating )
+		return;
+
+	// only what is expanded is kept
+	wxTreeItemId item = event.GetItem();
+	updating = true;
+	tree->DeleteChildren ( item );
+	setItem ( item, getEntry ( item ) );
+	updating = false;
+}
+
+void OutlinePanel::OnSelectionChanged ( wxTreeEvent &event )
+{
+	if ( updating )
+		return;
+	jumpTo ( event.GetItem(), false );
+}
+
+void OutlinePanel::OnItemActivated ( wxTreeEvent &event )
+{
+	jumpTo ( event.GetItem(), true );
+}
+
+void OutlinePanel::rebuild()
+{
+	updating = true;
+	tree->DeleteAllItems();
+	index = ( doc ) ? doc->getTagIndex() : NULL;
+	if ( index )
+	{
+		// the tree is built from the index as it is now
+		int first, oldEnd, newEnd;
+		bool nesting;
+		index->takeChanges ( first, oldEnd, newEnd, nesting );
+
+		Entry entry;
+		entry.element = entry.first = entry.last = -1;
+		wxTreeItemId root = tree->AddRoot ( wxEmptyString, -1, -1, new ItemData ( entry ) );
+		reconcile ( root );
+	}
+	updating = false;
+}
+
+// The entries an item should have as its children
+void OutlinePanel::getEntries ( const wxTreeItemId &item, std::vector<Entry> &entries )
+{
+	const Entry &parent = getEntry ( item );
+	index->getChildElements ( parent.element, children );
+	int count = ( int ) children.size();
+
+	Entry entry;
+	entry.first = entry.last = -1;
+	if ( parent.first >= 0 )
+	{
+		int last = ( parent.last < count ) ? parent.last : count;
+		for ( int i = parent.first; i < last; ++i )
+		{
+			entry.element = children[i];
+			entries.push_back ( entry );
+		}
+	}
+	else if ( count > OUTLINE_GROUP_SIZE )
+	{
+		entry.element = parent.element;
+		for ( entry.first = 0; entry.first < count; entry.first += OUTLINE_GROUP_SIZE )
+		{
+			entry.last = entry.first + OUTLINE_GROUP_SIZE;
+			if ( entry.last > count )
+				entry.last = count;
+			entries.push_back ( entry );
+		}
+	}
+	else
+	{
+		for ( int i = 0; i < count; ++i )
+		{
+			entry.element = children[i];
+			entries.push_back ( entry );
+		}
+	}
+}
+
+// Brings the children of an expanded item into line with the index. Both
+// lists are in document order, so one pass matches them up; children of
+// the item that are themselves expanded are then dealt with in turn.
+void OutlinePanel::reconcile ( const wxTreeItemId &item )
+{
+	std::vector<Entry> entries;
+	getEntries ( item, entries );
+
+	wxTreeItemIdValue cookie;
+	wxTreeItemId child = tree->GetFirstChild ( item, cookie );
+	if ( child.IsOk() && !entries.empty() &&
+	        ( getEntry ( child ).first >= 0 ) != ( entries[0].first >= 0 ) )
+	{
+		tree->DeleteChildren ( item );
+		child = wxTreeItemId();
+	}
+
+	std::vector<wxTreeItemId> expanded;
+	size_t position = 0;
+	for ( size_t i = 0; i < entries.size(); ++i )
+	{
+		const Entry &entry = entries[i];
+		int key = entry.getKey();
+
+		// children that are no longer there go, the rest are kept
+		while ( child.IsOk() )
+		{
+			if ( getEntry ( child ).getKey() >= key )
+				break;
+			wxTreeItemId next = tree->GetNextSibling ( child );
+			tree->Delete ( child );
+			child = next;
+		}
+		if ( child.IsOk() && getEntry ( child ).getKey() == key )
+		{
+			setItem ( child, entry );
+			if ( tree->IsExpanded ( child ) )
+				expanded.push_back ( child );
+			child = tree->GetNextSibling ( child );
+		}
+		else
+			setItem ( tree->InsertItem ( item, position, wxEmptyString, -1, -1,
+			                             new ItemData ( entry ) ), entry );
+		++position;
+	}
+	while ( child.IsOk() )
+	{
+		wxTreeItemId next = tree->GetNextSibling ( child );
+		tree->Delete ( child );
+		child = next;
+	}
+
+	std::vector<wxTreeItemId>::iterator it;
+	for ( it = expanded.begin(); it != expanded.end(); ++it )
+		reconcile ( *it );
+}
+
+// Carries the element numbers of the items over an edit; elements whose
+// markup was replaced are numbered -2, which no entry matches
+void OutlinePanel::renumber ( const wxTreeItemId &item, int first, int oldEnd, int newEnd )
+{
+	Entry &entry = getEntry ( item );
+	if ( entry.element >= oldEnd )
+		entry.element += newEnd - oldEnd;
+	else if ( entry.element >= first )
+		entry.element = -2;
+
+	wxTreeItemIdValue cookie;
+	wxTreeItemId child;
+	for ( child = tree->GetFirstChild ( item, cookie ); child.IsOk();
+	        child = tree->GetNextChild ( item, cookie ) )
+		renumber ( child, first, oldEnd, newEnd );
+}
+
+// Sets the labels of elements from first up to last again, as their
+// names may have been edited
+void OutlinePanel::relabel ( const wxTreeItemId &item, int first, int last )
+{
+	wxTreeItemIdValue cookie;
+	wxTreeItemId child;
+	for ( child = tree->GetFirstChild ( item, cookie ); child.IsOk();
+	        child = tree->GetNextChild ( item, cookie ) )
+	{
+		const Entry &entry = getEntry ( child );
+		if ( entry.first < 0 && entry.element >= first && entry.element < last )
+		{
+			wxString label = getLabel ( entry );
+			if ( tree->GetItemText ( child ) != label )
+				tree->SetItemText ( child, label );
+		}
+		relabel ( child, first, last );
+	}
+}
+
+void OutlinePanel::setItem ( const wxTreeItemId &item, const Entry &entry )
+{
+	getEntry ( item ) = entry;
+	wxString label = getLabel ( entry );
+	if ( tree->GetItemText ( item ) != label )
+		tree->SetItemText ( item, label );
+	if ( !tree->IsExpanded ( item ) )
+		tree->SetItemHasChildren ( item,
+		                           entry.first >= 0 || index->hasChildElements ( entry.element ) );
+}
+
+wxString OutlinePanel::getLabel ( const Entry &entry )
+{
+	if ( entry.first >= 0 )
+		return wxString::Format ( _T ( "[%d-%d]" ), entry.first + 1, entry.last );
+	std::string name = index->getElementName ( entry.element );
+	return wxString ( name.c_str(), wxConvUTF8, name.size() );
+}
+
+OutlinePanel::Entry &OutlinePanel::getEntry ( const wxTreeItemId &item )
+{
+	return ( ( ItemData * ) tree->GetItemData ( item ) )->entry;
+}
+
+void OutlinePanel::jumpTo ( const wxTreeItemId &item, bool focus )
+{
+	if ( !doc || !index || !item.IsOk() )
+		return;
+	const Entry &entry = getEntry ( item );
+	if ( entry.first >= 0 )
+		return;
+	int pos = index->getElementStart ( entry.element );
+	if ( pos < 0 )
+		return;
+
+	doc->EnsureVisible ( doc->LineFromPosition ( pos ) );
+	doc->GotoPos ( pos );
+	if ( focus )
+		doc->SetFocus();
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef OUTLINE_PANEL_H
+#define OUTLINE_PANEL_H
+
+#include <wx/wx.h>
+#include <wx/treectrl.h>
+#include <vector>
+#include "xmlcopyeditor.h"
+
+class XmlDoc;
+class TagIndex;
+
+// A tree of the elements in a document, read from the document's
+// TagIndex rather than parsed. Only expanded nodes have their children
+// created, and collapsing a node lets them go again, so the tree stays as
+// small as the part of the document being looked at. Elements with very
+// many children show them in groups, each expanded on its own.
+//
+// Edits are followed from the changes the index reports: as long as no
+// markup is added or removed, at most a few labels change; otherwise the
+// children of the expanded nodes are worked out again from the index and
+// the tree is brought into line with them, keeping what is open.
+class OutlinePanel : public wxPanel
+{
+	public:
+		OutlinePanel ( wxWindow *parent, int id );
+		void update ( XmlDoc *docParameter = NULL );
+		void OnItemExpanding ( wxTreeEvent &event );
+		void OnItemCollapsed ( wxTreeEvent &event );
+		void OnSelectionChanged ( wxTreeEvent &event );
+		void OnItemActivated ( wxTreeEvent &event );
+	private:
+		struct Entry
+		{
+			int element; // by TagIndex numbering; for a group, its parent
+			int first, last; // the children in a group; first is -1 otherwise
+
+			// what orders the entries among their siblings
+			int getKey() const
+			{
+				return ( first >= 0 ) ? first : element;
+			}
+		};
+		class ItemData : public wxTreeItemData
+		{
+			public:
+				ItemData ( const Entry &entryParameter ) : entry ( entryParameter ) { }
+				Entry entry;
+		};
+
+		MyFrame *parentWindow;
+		XmlDoc *doc;
+		TagIndex *index;
+		wxBoxSizer *sizer;
+		wxTreeCtrl *tree;
+		bool updating; // ignore the tree's events while changing it
+		std::vector<int> children;
+
+		void rebuild();
+		void getEntries ( const wxTreeItemId &item, std::vector<Entry> &entries );
+		void reconcile ( const wxTreeItemId &item );
+		void renumber ( const wxTreeItemId &item, int first, int oldEnd, int newEnd );
+		void relabel ( const wxTreeItemId &item, int first, int last );
+		void setItem ( const wxTreeItemId &item, const Entry &entry );
+		wxString getLabel ( const Entry &entry );
+		Entry &getEntry ( const wxTreeItemId &item );
+		void jumpTo ( const wxTreeItemId &item, bool focus );
+
+		DECLARE_EVENT_TABLE()
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include "parserdata.h"
+
+// names are stored in blocks of this size; a longer one gets its own
+#define PARSER_DATA_BLOCK_SIZE 4096
+// the smallest table of slots, which is kept at most half full
+#define PARSER_DATA_MIN_SLOTS 64
+
+// FNV-1a
+static size_t hashName ( const char *name, size_t len )
+{
+	size_t hash = 2166136261U;
+	for ( size_t i = 0; i < len; ++i )
+	{
+		hash ^= ( unsigned char ) name[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+ParserData::ParserData()
+	: state ( 0 )
+	, count ( 0 )
+	, blockFree ( NULL )
+	, blockFreeLen ( 0 )
+{
+}
+
+// The names of the open elements are interned again, so that the copy
+// has blocks of its own
+ParserData::ParserData ( const ParserData &other )
+	: blockFree ( NULL )
+	, blockFreeLen ( 0 )
+{
+	*this = other;
+}
+
+ParserData &ParserData::operator= ( const ParserData &other )
+{
+	if ( this == &other )
+		return *this;
+
+	state = other.state;
+	count = other.count;
+	stack.clear();
+	names.clear();
+	slots.clear();
+	blocks.clear();
+	blockFree = NULL;
+	blockFreeLen = 0;
+
+	std::vector<int>::const_iterator it;
+	for ( it = other.stack.begin(); it != other.stack.end(); ++it )
+		stack.push_back ( intern ( other.names[*it].text ) );
+	return *this;
+}
+
+int ParserData::intern ( const char *name )
+{
+	size_t len = strlen ( name );
+	size_t hash = hashName ( name, len );
+
+	if ( slots.empty() )
+		slots.assign ( PARSER_DATA_MIN_SLOTS, -1 );
+	size_t mask = slots.size() - 1;
+	size_t i;
+	for ( i = hash & mask; slots[i] != -1; i = ( i + 1 ) & mask )
+	{
+		const Name &candidate = names[slots[i]];
+		if ( candidate.hash == hash &&
+		        candidate.len == len &&
+		        !memcmp ( candidate.text, name, len ) )
+			return slots[i];
+	}
+
+	Name entry;
+	entry.text = store ( name, len );
+	entry.len = len;
+	entry.hash = hash;
+	int id = ( int ) names.size();
+	names.push_back ( entry );
+	slots[i] = id;
+
+	if ( names.size() * 2 > slots.size() )
+		rehash ( slots.size() * 2 );
+	return id;
+}
+
+const char *ParserData::store ( const char *name, size_t len )
+{
+	if ( blockFreeLen < len + 1 )
+	{
+		size_t blockSize = ( len + 1 > PARSER_DATA_BLOCK_SIZE ) ?
+		                   len + 1 : PARSER_DATA_BLOCK_SIZE;
+		blocks.push_back ( std::vector<char> ( blockSize ) );
+		blockFree = &blocks.back()[0];
+		blockFreeLen = blockSize;
+	}
+	char *text = blockFree;
+	memcpy ( text, name, len );
+	text[len] = '\0';
+	blockFree += len + 1;
+	blockFreeLen -= len + 1;
+	return text;
+}
+
+void ParserData::rehash ( size_t slotCount )
+{
+	slots.assign ( slotCount, -1 );
+	size_t mask = slotCount - 1;
+	for ( size_t id = 0; id < names.size(); ++id )
+	{
+		size_t i = names[id].hash & mask;
+		while ( slots[i] != -1 )
+			i = ( i + 1 ) & mask;
+		slots[i] = ( int ) id;
+	}
+}
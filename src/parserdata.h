@@ -22,19 +22,24 @@
 
 #include <string>
 #include <vector>
+#include <list>
 
+// Holds what the Expat handlers of a reader share during a parse,
+// including the names of the open elements. Each distinct name is stored
+// once, in blocks that never move, and the stack holds name ids; once a
+// name has been seen, pushing it again allocates nothing. The names handed
+// out point into the blocks and last as long as the ParserData.
 class ParserData
 {
 	public:
-		ParserData()
-		{
-			count = 0;
-		}
+		ParserData();
+		ParserData ( const ParserData &other );
+		ParserData &operator= ( const ParserData &other );
 		~ParserData()
 		{ }
-		void push ( const std::string& s )
+		void push ( const char *name )
 		{
-			stack.push_back ( s );
+			stack.push_back ( intern ( name ) );
 		}
 		void pop()
 		{
@@ -53,21 +58,41 @@ class ParserData
 		{
 			return count;
 		}
-		std::vector<std::string> getStack()
+		// the name ids of the open elements, outermost first
+		const std::vector<int> &getStack()
 		{
 			return stack;
 		}
-		std::string getElement()
+		const char *getName ( int id )
+		{
+			return names[id].text;
+		}
+		const char *getElement()
 		{
-			return ( stack.empty() ) ? "" : stack.at ( stack.size() - 1 );
+			return ( stack.empty() ) ? "" : names[stack.back()].text;
 		}
-		std::string getParent()
+		const char *getParent()
 		{
-			return ( stack.size() < 2 ) ? "" : stack.at ( stack.size() - 2 );
+			return ( stack.size() < 2 ) ? "" : names[stack[stack.size() - 2]].text;
 		}
+		// the id of name, which is added if new
+		int intern ( const char *name );
 	private:
+		struct Name
+		{
+			const char *text;
+			size_t len, hash;
+		};
 		int state, count;
-		std::vector<std::string> stack;
+		std::vector<int> stack;
+		std::vector<Name> names; // by id
+		std::vector<int> slots; // open addressing on the hash; -1 if empty
+		std::list<std::vector<char> > blocks;
+		char *blockFree; // the unused end of the last block
+		size_t blockFreeLen;
+
+		const char *store ( const char *name, size_t len );
+		void rehash ( size_t slotCount );
 };
 
 #endif
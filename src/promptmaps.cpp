@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "promptmaps.h"
+
+void PromptMaps::addPredefinedEntities()
+{
+	entitySet.insert ( _T ( "amp" ) );
+	entitySet.insert ( _T ( "apos" ) );
+	entitySet.insert ( _T ( "quot" ) );
+	entitySet.insert ( _T ( "lt" ) );
+	entitySet.insert ( _T ( "gt" ) );
+}
+
+PromptMapsCache PromptMapsCache::instance;
+
+PromptMapsCache::PromptMapsCache()
+{
+}
+
+PromptMapsCache &PromptMapsCache::get()
+{
+	return instance;
+}
+
+PromptMapsPtr PromptMapsCache::find ( const wxString &key )
+{
+	wxCriticalSectionLocker locker ( section );
+	std::map<wxString, boost::weak_ptr<const PromptMaps> >::iterator it =
+	    entries.find ( key );
+	return ( it != entries.end() ) ? it->second.lock() : PromptMapsPtr();
+}
+
+PromptMapsPtr PromptMapsCache::add ( const wxString &key, PromptMapsPtr maps )
+{
+	wxCriticalSectionLocker locker ( section );
+
+	// forget the grammars no document uses any more
+	std::map<wxString, boost::weak_ptr<const PromptMaps> >::iterator it;
+	for ( it = entries.begin(); it != entries.end(); )
+	{
+		if ( it->second.expired() )
+			entries.erase ( it++ );
+		else
+			++it;
+	}
+
+	boost::weak_ptr<const PromptMaps> &entry = entries[key];
+	PromptMapsPtr kept = entry.lock();
+	if ( kept )
+		return kept;
+	entry = maps;
+	return maps;
+}
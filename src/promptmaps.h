@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PROMPT_MAPS_H
+#define PROMPT_MAPS_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <map>
+#include <set>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include "completiondatabase.h"
+
+// The prompt maps of a document as XmlCtrl uses them. They are not
+// changed once built, so they can be handed from a worker thread to the
+// UI without copying and shared by every document using the same grammar.
+struct PromptMaps
+{
+	CompletionDatabase database;
+	std::set<wxString> entitySet;
+
+	void addPredefinedEntities();
+};
+
+typedef boost::shared_ptr<const PromptMaps> PromptMapsPtr;
+
+// Finds the prompt maps already built for a grammar, for as long as any
+// document holds them. The key must identify the grammar and the version
+// of its files (see XmlPromptGenerator::getPromptMaps).
+class PromptMapsCache
+{
+	public:
+		static PromptMapsCache &get();
+
+		// a null pointer if no document holds maps for the key
+		PromptMapsPtr find ( const wxString &key );
+		// returns the maps kept for the key, which are those of another
+		// thread if it got there first
+		PromptMapsPtr add ( const wxString &key, PromptMapsPtr maps );
+	private:
+		static PromptMapsCache instance;
+		wxCriticalSection section;
+		std::map<wxString, boost::weak_ptr<const PromptMaps> > entries;
+
+		PromptMapsCache();
+
+		PromptMapsCache ( const PromptMapsCache& );
+		PromptMapsCache& operator= ( const PromptMapsCache& );
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <wx/wx.h>
+#include <cstring>
+#include <algorithm>
+#include "promptmapthread.h"
+#include "xmlpromptgenerator.h"
+#include "xmlencodinghandler.h"
+#include "threadreaper.h"
+
+// the longest XML declaration looked for at the start of a snapshot
+#define PROMPT_MAP_HEAD_MAX 1024
+
+extern wxCriticalSection xmlcopyeditorCriticalSection;
+
+DEFINE_EVENT_TYPE(wxEVT_COMMAND_PROMPT_MAPS_COMPLETED);
+
+PromptMapThread::PromptMapThread (
+	wxEvtHandler *handler,
+	int request,
+	DocumentSnapshotPtr snapshot,
+	const wxString &basePath,
+	const wxString &auxPath )
+	: wxThread ( wxTHREAD_JOINABLE )
+	, myEventHandler ( handler )
+	, myRequest ( request )
+	, mySnapshot ( snapshot )
+	, myBasePath ( basePath )
+	, myAuxPath ( auxPath )
+	, myGrammarFound ( false )
+	, mStopping ( false )
+	, myInThread ( false )
+{
+}
+
+PromptMapThread::PromptMapThread (
+	wxEvtHandler *handler,
+	int request,
+	XmlPromptGenerator *generator )
+	: wxThread ( wxTHREAD_JOINABLE )
+	, myEventHandler ( handler )
+	, myRequest ( request )
+	, myGenerator ( generator )
+	, myGrammarFound ( false )
+	, mStopping ( false )
+	, myInThread ( false )
+{
+}
+
+PromptMapThread::~PromptMapThread()
+{
+}
+
+void *PromptMapThread::Entry()
+{
+	myInThread = true;
+	if ( !compile() )
+		return NULL;
+
+	wxCriticalSectionLocker locker ( xmlcopyeditorCriticalSection );
+
+	if ( !TestDestroy() )
+	{
+		wxCommandEvent event ( wxEVT_COMMAND_PROMPT_MAPS_COMPLETED );
+		event.SetInt ( myRequest );
+		wxPostEvent ( myEventHandler, event );
+	}
+
+	return NULL;
+}
+
+bool PromptMapThread::compile()
+{
+	if ( !myGenerator.get() )
+	{
+		myGenerator.reset ( new XmlPromptGenerator ( myBasePath, myAuxPath ) );
+		bool parsed = parseSnapshot();
+		mySnapshot.reset();
+		if ( !parsed )
+			return false;
+	}
+
+	if ( isCancelled() )
+		return false;
+
+	myPromptMaps = myGenerator->getPromptMaps();
+	myGrammarFound = myGenerator->getGrammarFound();
+	myGenerator.reset();
+	return true;
+}
+
+// Feeds the snapshot to the generator a segment at a time, with the
+// declaration rewritten as XmlCtrl::updatePromptMaps used to do; returns
+// false if cancelled
+bool PromptMapThread::parseSnapshot()
+{
+	size_t size = mySnapshot->size();
+	if ( !size )
+		return true;
+
+	std::string head ( std::min ( size, ( size_t ) PROMPT_MAP_HEAD_MAX ), '\0' );
+	head.resize ( mySnapshot->read ( 0, &head[0], head.size() ) );
+	size_t headLen = 0;
+	if ( head.size() >= 5 && !head.compare ( 0, 5, "<?xml" ) )
+		headLen = head.find ( '>' ) + 1; // 0 if there is none
+	head.resize ( headLen );
+	XmlEncodingHandler::setUtf8 ( head, true );
+
+	// the generator stops the parser once it has what it needs, after
+	// which parse returns false
+	if ( !head.empty() && !myGenerator->parse ( head, false ) )
+		return !isCancelled();
+
+	size_t pos = 0;
+	for ( size_t i = 0; i < mySnapshot->getSegmentCount(); ++i )
+	{
+		if ( isCancelled() )
+			return false;
+
+		const std::string &segment = mySnapshot->getSegment ( i );
+		size_t skip = ( pos < headLen ) ? std::min ( headLen - pos, segment.size() ) : 0;
+		pos += segment.size();
+		bool isFinal = ( pos == size );
+		if ( skip == segment.size() && !isFinal )
+			continue;
+		if ( !myGenerator->parse ( segment.data() + skip, segment.size() - skip, isFinal ) )
+			break;
+	}
+	return !isCancelled();
+}
+
+// wxThread::TestDestroy may only be called by the thread itself
+bool PromptMapThread::isCancelled()
+{
+	return ( myInThread ) ? TestDestroy() : mStopping;
+}
+
+void PromptMapThread::PendingDelete()
+{
+	Cancel();
+
+	ThreadReaper::get().add ( this );
+}
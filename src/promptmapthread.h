@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PROMPT_MAP_THREAD_H
+#define PROMPT_MAP_THREAD_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <memory>
+#include "documentsnapshot.h"
+#include "promptmaps.h"
+
+class XmlPromptGenerator;
+
+DECLARE_EVENT_TYPE(wxEVT_COMMAND_PROMPT_MAPS_COMPLETED, wxID_ANY);
+
+// Compiles the prompt maps of a document away from the UI thread, either
+// by parsing a snapshot of it or from a generator that has been fed the
+// document already. The event it posts carries the request number, so
+// that the control can tell the result of a request it has since
+// replaced.
+class PromptMapThread : public wxThread
+{
+public:
+	PromptMapThread (
+	                wxEvtHandler *handler,
+	                int request,
+	                DocumentSnapshotPtr snapshot,
+	                const wxString &basePath,
+	                const wxString &auxPath );
+	// takes the generator over
+	PromptMapThread (
+	                wxEvtHandler *handler,
+	                int request,
+	                XmlPromptGenerator *generator );
+	virtual ~PromptMapThread();
+	virtual void *Entry();
+	// does the work of Entry without posting the event; returns false
+	// if cancelled. May also be called on the UI thread if the thread
+	// could not be started, so it never calls TestDestroy itself.
+	bool compile();
+	int getRequest() { return myRequest; }
+	PromptMapsPtr getPromptMaps() { return myPromptMaps; }
+	bool getGrammarFound() { return myGrammarFound; }
+
+	void PendingDelete();
+	// see ValidationThread
+	virtual void Cancel() { mStopping = true; }
+	virtual bool TestDestroy() { return mStopping || wxThread::TestDestroy(); }
+
+protected:
+	wxEvtHandler *myEventHandler;
+	int myRequest;
+	DocumentSnapshotPtr mySnapshot;
+	wxString myBasePath, myAuxPath;
+	std::auto_ptr<XmlPromptGenerator> myGenerator;
+	PromptMapsPtr myPromptMaps;
+	bool myGrammarFound;
+
+	bool mStopping, myInThread;
+
+	bool isCancelled();
+	bool parseSnapshot();
+};
+
+#endif
@@ -17,7 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <sstream>
+#include <memory>
 #include "readfile.h"
 
 bool ReadFile::run ( std::string fname, std::string &buffer )
@@ -30,11 +30,20 @@ bool ReadFile::run ( std::string fname, std::string &buffer )
 	size_t size = ifs.tellg();
 	ifs.seekg ( 0, std::ios::beg );
 
-	buffer.reserve ( size + 1 );
-
-	std::stringstream iss;
-	iss << ifs.rdbuf();
-	buffer = iss.str();
+	// read straight into the result
+	buffer.resize ( size );
+	if ( size )
+		ifs.read ( &buffer[0], size );
+	buffer.resize ( ifs.gcount() );
 
 	return true;
 }
+
+BinaryFile *ReadFile::view ( const std::string &fname )
+{
+	std::auto_ptr<BinaryFile> file (
+	    new BinaryFile ( wxString ( fname.c_str(), wxConvLocal ) ) );
+	if ( !file->getData() )
+		return NULL;
+	return file.release();
+}
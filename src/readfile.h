@@ -23,11 +23,16 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include "binaryfile.h"
 
 class ReadFile
 {
 	public:
 		static bool run ( std::string fname, std::string &buffer );
+		// Returns a read-only view of the file (mapped where possible,
+		// otherwise read once), or NULL if the file cannot be read. Use
+		// this rather than run() when the contents are only parsed.
+		static BinaryFile *view ( const std::string &fname );
 };
 
 #endif
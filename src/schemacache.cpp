@@ -0,0 +1,219 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <memory>
+#include "schemacache.h"
+#include "indexcache.h"
+
+// Xerces-C req'd for Schema parsing
+#include "wrapxerces.h" // Declaration of toString() and XERCES_TMPLSINC definition
+
+#include <xercesc/util/NameIdPool.hpp>
+#include <xercesc/framework/XMLValidator.hpp>
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include <xercesc/validators/schema/SchemaGrammar.hpp>
+#include <xercesc/validators/common/ContentSpecNode.hpp>
+
+using namespace xercesc;
+
+typedef std::map<const SchemaElementDecl *, std::set<wxString> >
+        SubstitutionMap;
+
+static void buildSubstitutionMap (
+    SubstitutionMap &substitutions,
+    const SchemaGrammar &grammar )
+{
+	substitutions.clear();
+
+	RefHash2KeysTableOfEnumerator<ElemVector> list ( grammar.getValidSubstitutionGroups() );
+	if ( !list.hasMoreElements() )
+		return;
+
+	while ( list.hasMoreElements() )
+	{
+		const ElemVector &elmts = list.nextElement();
+
+		const QName *qnm;
+		const SchemaElementDecl *cur, *substitution;
+		substitution = elmts.elementAt ( 0 )->getSubstitutionGroupElem();
+
+		size_t index = elmts.size();
+		while ( index-- > 0 )
+		{
+			cur = elmts.elementAt ( index );
+			qnm = cur->getElementName();
+			wxString element = WrapXerces::toString ( qnm->getRawName() );
+
+			substitutions[substitution].insert ( element );
+		}
+	}
+}
+
+static void getContent (
+    std::set<wxString> &list,
+    const ContentSpecNode *spec,
+    SubstitutionMap &substitutions )
+{
+	//if ( spec == NULL) return;
+
+	const QName *qnm = spec->getElement();
+	if ( qnm )
+	{
+		const SchemaElementDecl *elem = (const SchemaElementDecl *)spec->getElementDecl();
+		SubstitutionMap::const_iterator itr = substitutions.find ( elem );
+		if ( itr == substitutions.end() && elem != NULL )
+			itr = substitutions.find ( elem->getSubstitutionGroupElem() );
+		if ( itr != substitutions.end() )
+		{
+			list.insert ( itr->second.begin(), itr->second.end() );
+		}
+		else
+		{
+			wxString element = WrapXerces::toString ( qnm->getRawName() );
+			if ( !element.IsEmpty() )
+				list.insert( element );
+		}
+	}
+
+	if ( spec->getFirst() != NULL)
+		getContent( list, spec->getFirst(), substitutions );
+	if ( spec->getSecond() != NULL)
+		getContent( list, spec->getSecond(), substitutions );
+}
+
+SchemaCache SchemaCache::instance;
+
+SchemaCache::SchemaCache()
+{
+}
+
+SchemaCache &SchemaCache::get()
+{
+	return instance;
+}
+
+SchemaTablesPtr SchemaCache::find ( const wxString &schemaPath )
+{
+	long long modified = IndexCache::getModificationTime ( schemaPath );
+	long now = wxGetLocalTime();
+
+	wxCriticalSectionLocker locker ( section );
+	std::map<wxString, Entry>::iterator it = entries.find ( schemaPath );
+	if ( it != entries.end() && it->second.modified == modified &&
+	        ( it->second.tables || now - it->second.failed < SCHEMA_CACHE_RETRY ) )
+		return it->second.tables;
+
+	Entry &entry = entries[schemaPath];
+	entry.modified = modified;
+	entry.tables = compile ( schemaPath );
+	entry.failed = ( entry.tables ) ? 0 : now;
+	return entry.tables;
+}
+
+void SchemaCache::clear()
+{
+	wxCriticalSectionLocker locker ( section );
+	entries.clear();
+}
+
+SchemaTablesPtr SchemaCache::compile ( const wxString &schemaPath )
+{
+	std::auto_ptr<XercesDOMParser> parser ( new XercesDOMParser() );
+	parser->setDoNamespaces ( true );
+	parser->setDoSchema ( true );
+	parser->setValidationSchemaFullChecking ( true );
+
+	Grammar *rootGrammar = parser->loadGrammar
+			( ( const XMLCh * ) WrapXerces::toString ( schemaPath ).GetData()
+			, Grammar::SchemaGrammarType
+			);
+	if ( !rootGrammar )
+	{
+		return SchemaTablesPtr();
+	}
+
+	SchemaGrammar* grammar = ( SchemaGrammar* ) rootGrammar;
+	RefHash3KeysIdPoolEnumerator<SchemaElementDecl> elemEnum = grammar->getElemEnumerator();
+
+	if ( !elemEnum.hasMoreElements() )
+	{
+		return SchemaTablesPtr();
+	}
+
+	SubstitutionMap substitutions;
+	buildSubstitutionMap ( substitutions, *grammar );
+
+	boost::shared_ptr<SchemaTables> tables ( new SchemaTables() );
+	while ( elemEnum.hasMoreElements() )
+	{
+		const SchemaElementDecl& curElem = elemEnum.nextElement();
+
+		wxString element;
+
+		const QName *qnm = curElem.getElementName();
+		if ( qnm == NULL )
+			continue;
+		element = WrapXerces::toString ( qnm->getRawName() ); // this includes any prefix:localname combinations
+		if ( element.empty() )
+			continue;
+
+		const XMLCh* fmtCntModel = curElem.getFormattedContentModel();
+		if ( fmtCntModel != NULL ) // tbd: this does not yet pick up prefix:localname combinations
+		{
+			wxString structure = WrapXerces::toString ( fmtCntModel );
+			tables->elementStructureMap[element] = structure;
+		}
+		const ContentSpecNode *spec = curElem.getContentSpec();
+		if ( spec != NULL )
+		{
+			getContent ( tables->elementMap[element], spec, substitutions );
+		}
+
+		// fetch attributes
+		if ( !curElem.hasAttDefs() )
+			continue;
+
+		XMLAttDefList& attIter = curElem.getAttDefList();
+		for ( unsigned int i = 0; i < attIter.getAttDefCount(); i++ )
+		{
+			wxString attribute, attributeValue;
+
+			XMLAttDef& attr = attIter.getAttDef ( i );
+			XMLAttDef::DefAttTypes ty = attr.getDefaultType();
+			if ( ty == XMLAttDef::Prohibited )
+				continue;
+			SchemaAttDef *pAttr = ( SchemaAttDef * ) &attr;
+
+			const QName *qnm = pAttr->getAttName();
+			if ( qnm == NULL )
+				continue;
+			attribute = WrapXerces::toString ( qnm->getRawName() );
+			if ( attribute.empty() )
+				continue;
+
+			// Value
+			attributeValue = WrapXerces::toString ( pAttr->getValue() );
+			tables->attributeMap[element][attribute].insert( attributeValue );
+
+			if ( ty == XMLAttDef::Required || ty == XMLAttDef::Required_And_Fixed)
+				tables->requiredAttributeMap[element].insert ( attribute );
+		}
+	}
+	return tables;
+}
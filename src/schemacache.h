@@ -0,0 +1,78 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SCHEMA_CACHE_H
+#define SCHEMA_CACHE_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <map>
+#include <set>
+#include <boost/shared_ptr.hpp>
+
+#define SCHEMA_CACHE_RETRY 30
+
+// What XmlPromptGenerator takes from an XML Schema
+struct SchemaTables
+{
+	std::map<wxString, std::map<wxString, std::set<wxString> > >
+	attributeMap;
+	std::map<wxString, std::set<wxString> > elementMap;
+	std::map<wxString, std::set<wxString> > requiredAttributeMap;
+	std::map<wxString, wxString> elementStructureMap;
+};
+
+typedef boost::shared_ptr<const SchemaTables> SchemaTablesPtr;
+
+// Compiles each schema once for the whole process, so that documents
+// sharing a schema, and every rebuild of their prompt maps, share the
+// tables. A schema is compiled again when the modification time of its
+// file changes; schemas it includes or imports are not checked. A schema
+// that could not be loaded, perhaps for want of a network, is only
+// tried again after SCHEMA_CACHE_RETRY seconds.
+//
+// Loaders on worker threads may use the cache; a schema is compiled while
+// the cache is locked, so that it is only compiled once.
+class SchemaCache
+{
+	public:
+		static SchemaCache &get();
+
+		// a null pointer if the schema cannot be loaded
+		SchemaTablesPtr find ( const wxString &schemaPath );
+		void clear();
+	private:
+		struct Entry
+		{
+			long long modified; // -1 if not a local file
+			SchemaTablesPtr tables;
+			long failed; // when loading last failed
+		};
+		static SchemaCache instance;
+		wxCriticalSection section;
+		std::map<wxString, Entry> entries;
+
+		SchemaCache();
+		static SchemaTablesPtr compile ( const wxString &schemaPath );
+
+		SchemaCache ( const SchemaCache& );
+		SchemaCache& operator= ( const SchemaCache& );
+};
+
+#endif
@@ -0,0 +1,578 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "tagindex.h"
+#include "xmlctrl.h"
+
+// bytes read from the control at a time while scanning
+#define TAG_INDEX_CHUNK_SIZE ( 64 * 1024 )
+// longest element name read for getElementName
+#define TAG_INDEX_NAME_MAX 256
+
+TagIndex::TagIndex ( wxStyledTextCtrl *ctrlParameter )
+	: ctrl ( ctrlParameter )
+	, changed ( false )
+	, chunk ( TAG_INDEX_CHUNK_SIZE )
+{
+	clear();
+}
+
+void TagIndex::clear()
+{
+	noteChange ( 0, ( int ) spans.size(), 0, true );
+	spans.clear();
+	stepIndex = 0;
+	stepLength = 0;
+	resolved = 0;
+	unterminated = -1;
+	chunkStart = chunkEnd = length = 0;
+}
+
+void TagIndex::insert ( int pos, int len )
+{
+	if ( len <= 0 )
+		return;
+	length = ctrl->GetLength();
+	chunkStart = chunkEnd = 0;
+
+	if ( unterminated >= pos )
+		unterminated += len;
+
+	// a span the text went into is scanned again; it starts before the
+	// edit, so the scan cannot mistake it for an unchanged span
+	size_t i = findStart ( pos );
+	applyStep ( i );
+	stepLength += len;
+
+	int from = pos;
+	if ( i > 0 && getEnd ( i - 1 ) >= pos )
+		from = getStart ( --i );
+
+	rescan ( from, pos + len, i, true );
+}
+
+void TagIndex::remove ( int pos, int len )
+{
+	if ( len <= 0 )
+		return;
+	length = ctrl->GetLength();
+	chunkStart = chunkEnd = 0;
+
+	// if the first unclosed markup has gone, any later markup may be the
+	// first unclosed one, so the scan cannot stop early
+	bool resync = true;
+	if ( unterminated >= pos + len )
+		unterminated -= len;
+	else if ( unterminated >= pos )
+	{
+		unterminated = -1;
+		resync = false;
+	}
+
+	// spans that lost text are scanned again; they are moved before the
+	// scan's starting point, so that it cannot mistake them for unchanged
+	// spans
+	size_t i = findEnd ( pos );
+	size_t j = findStart ( pos + len );
+	int from = pos;
+	if ( i < j && getStart ( i ) < pos )
+		from = getStart ( i );
+	applyStep ( j );
+	for ( size_t k = i; k < j; ++k )
+		spans[k].start = spans[k].end = from - 1;
+	stepLength -= len;
+
+	rescan ( from, pos, i, resync );
+}
+
+int TagIndex::getParentEnd ( int pos )
+{
+	int i = findEndingBefore ( pos );
+	if ( i < 0 )
+		return -1;
+	resolve ( i );
+	int parent = spans[i].after;
+	return ( parent >= 0 ) ? getEnd ( parent ) : -1;
+}
+
+int TagIndex::getTagType ( int pos )
+{
+	int i = findEndingBefore ( pos );
+	if ( i < 0 || getEnd ( i ) != pos )
+		return TAG_TYPE_ERROR;
+	return spans[i].type;
+}
+
+int TagIndex::getTagStart ( int pos )
+{
+	int i = findEndingBefore ( pos );
+	if ( i < 0 || getEnd ( i ) != pos )
+		return -1;
+	return getStart ( i );
+}
+
+bool TagIndex::isInMarkup ( int pos )
+{
+	size_t i = findStart ( pos );
+	return i > 0 && getEnd ( i - 1 ) >= pos;
+}
+
+int TagIndex::getMarkupStart ( int pos )
+{
+	size_t i = findStart ( pos );
+	return ( i > 0 && getEnd ( i - 1 ) >= pos ) ? getStart ( i - 1 ) : -1;
+}
+
+int TagIndex::getMarkupEnd ( int pos )
+{
+	size_t i = findStart ( pos );
+	return ( i > 0 && getEnd ( i - 1 ) >= pos ) ? getEnd ( i - 1 ) : -1;
+}
+
+int TagIndex::getNextMarkupStart ( int pos )
+{
+	size_t i = findStart ( pos );
+	return ( i < spans.size() ) ? getStart ( i ) : -1;
+}
+
+void TagIndex::getChildElements ( int element, std::vector<int> &children )
+{
+	children.clear();
+	if ( element >= ( int ) spans.size() ||
+	        ( element >= 0 && spans[element].type != TAG_TYPE_OPEN ) )
+		return;
+
+	// the element's content runs on until the nesting leaves it
+	size_t size = spans.size();
+	for ( size_t i = element + 1; i < size; ++i )
+	{
+		resolve ( i );
+		int enclosing = ( i ) ? spans[i - 1].after : -1;
+		if ( enclosing < element )
+			break;
+		if ( enclosing == element &&
+		        ( spans[i].type == TAG_TYPE_OPEN || spans[i].type == TAG_TYPE_EMPTY ) )
+			children.push_back ( ( int ) i );
+	}
+}
+
+bool TagIndex::hasChildElements ( int element )
+{
+	if ( element >= ( int ) spans.size() ||
+	        ( element >= 0 && spans[element].type != TAG_TYPE_OPEN ) )
+		return false;
+
+	size_t size = spans.size();
+	for ( size_t i = element + 1; i < size; ++i )
+	{
+		resolve ( i );
+		int enclosing = ( i ) ? spans[i - 1].after : -1;
+		if ( enclosing < element )
+			break;
+		if ( enclosing == element &&
+		        ( spans[i].type == TAG_TYPE_OPEN || spans[i].type == TAG_TYPE_EMPTY ) )
+			return true;
+	}
+	return false;
+}
+
+int TagIndex::getElementStart ( int element )
+{
+	if ( element < 0 || element >= ( int ) spans.size() )
+		return -1;
+	return getStart ( element );
+}
+
+std::string TagIndex::getElementName ( int element )
+{
+	if ( element < 0 || element >= ( int ) spans.size() )
+		return std::string();
+
+	// read directly: names are wanted from all over the document, and the
+	// chunk belongs to the scan
+	int start = getStart ( element ) + 1;
+	int end = getEnd ( element );
+	if ( end - start > TAG_INDEX_NAME_MAX )
+		end = start + TAG_INDEX_NAME_MAX;
+	if ( end <= start )
+		return std::string();
+	wxCharBuffer buffer = ctrl->GetTextRangeRaw ( start, end );
+	const char *name = buffer.data();
+	size_t len = 0, max = end - start;
+	while ( len < max && !strchr ( " \t\r\n/>", name[len] ) )
+		++len;
+	return std::string ( name, len );
+}
+
+bool TagIndex::takeChanges ( int &first, int &oldEnd, int &newEnd, bool &nesting )
+{
+	if ( !changed )
+		return false;
+	first = changedFirst;
+	oldEnd = changedOldEnd;
+	newEnd = changedNewEnd;
+	nesting = changedNesting;
+	changed = false;
+	return true;
+}
+
+// Merges a change into those not yet taken: the runs are joined in the
+// numbering between the two changes, then their end is taken back to the
+// numbering before the first and on to that after the second
+void TagIndex::noteChange ( int first, int oldEnd, int newEnd, bool nesting )
+{
+	if ( !changed )
+	{
+		changed = true;
+		changedFirst = first;
+		changedOldEnd = oldEnd;
+		changedNewEnd = newEnd;
+		changedNesting = nesting;
+		return;
+	}
+	int end = ( changedNewEnd > oldEnd ) ? changedNewEnd : oldEnd;
+	changedOldEnd += end - changedNewEnd;
+	changedNewEnd = end + newEnd - oldEnd;
+	if ( first < changedFirst )
+		changedFirst = first;
+	changedNesting = changedNesting || nesting;
+}
+
+int TagIndex::getStart ( size_t i )
+{
+	return ( i >= stepIndex ) ? spans[i].start + stepLength : spans[i].start;
+}
+
+int TagIndex::getEnd ( size_t i )
+{
+	return ( i >= stepIndex ) ? spans[i].end + stepLength : spans[i].end;
+}
+
+// Moves the step to i, paying out or taking back the pending length for
+// the spans in between
+void TagIndex::applyStep ( size_t i )
+{
+	if ( stepLength )
+	{
+		size_t size = spans.size();
+		if ( i > stepIndex )
+		{
+			for ( size_t j = stepIndex; j < i && j < size; ++j )
+			{
+				spans[j].start += stepLength;
+				spans[j].end += stepLength;
+			}
+		}
+		else
+		{
+			for ( size_t j = i; j < stepIndex && j < size; ++j )
+			{
+				spans[j].start -= stepLength;
+				spans[j].end -= stepLength;
+			}
+		}
+	}
+	stepIndex = i;
+}
+
+size_t TagIndex::findStart ( int pos )
+{
+	size_t low = 0, high = spans.size();
+	while ( low < high )
+	{
+		size_t middle = low + ( high - low ) / 2;
+		if ( getStart ( middle ) < pos )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+size_t TagIndex::findEnd ( int pos )
+{
+	size_t low = 0, high = spans.size();
+	while ( low < high )
+	{
+		size_t middle = low + ( high - low ) / 2;
+		if ( getEnd ( middle ) < pos )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+int TagIndex::findEndingBefore ( int pos )
+{
+	return ( int ) findEnd ( pos + 1 ) - 1;
+}
+
+// Works out the enclosing element for spans up to i. Only the nesting is
+// followed, as in a well-formed document; names are not matched.
+void TagIndex::resolve ( size_t i )
+{
+	for ( ; resolved <= i && resolved < spans.size(); ++resolved )
+	{
+		int previous = ( resolved ) ? spans[resolved - 1].after : -1;
+		Span &span = spans[resolved];
+		switch ( span.type )
+		{
+			case TAG_TYPE_OPEN:
+				span.after = ( int ) resolved;
+				break;
+			case TAG_TYPE_CLOSE:
+				span.after = ( previous > 0 ) ? spans[previous - 1].after : -1;
+				break;
+			default:
+				span.after = previous;
+				break;
+		}
+	}
+}
+
+// Scans from a point outside any markup for the spans that replace those
+// from index i on. Once past the edit, the scan stops at the first old
+// span it meets: the text from there on is unchanged, and so are the
+// spans.
+void TagIndex::rescan ( int from, int editEnd, size_t i, bool resync )
+{
+	if ( unterminated >= 0 && unterminated < from )
+	{
+		// the edit may have closed it
+		from = unterminated;
+		i = findStart ( from );
+	}
+	int oldUnterminated = unterminated;
+	unterminated = -1;
+
+	std::vector<Span> found;
+	size_t j = i;
+	int pos = from;
+	for ( ;; )
+	{
+		int start = find ( pos, '<' );
+		if ( start < 0 )
+		{
+			j = spans.size();
+			break;
+		}
+		while ( j < spans.size() && getStart ( j ) < start )
+			++j;
+		// if the first unclosed markup was passed and has now been
+		// closed, the scan goes on to find the next one
+		if ( resync && start >= editEnd && j < spans.size() && getStart ( j ) == start
+		        && ( unterminated >= 0 || oldUnterminated < 0 || oldUnterminated >= start ) )
+		{
+			if ( unterminated < 0 )
+				unterminated = oldUnterminated;
+			break;
+		}
+
+		Span span;
+		span.start = start;
+		span.after = -1;
+		if ( scanMarkup ( start, span.end, span.type ) )
+		{
+			found.push_back ( span );
+			pos = span.end + 1;
+		}
+		else
+		{
+			// never closed: taken as text
+			if ( unterminated < 0 )
+				unterminated = start;
+			pos = start + 1;
+		}
+	}
+
+	// the new spans take the place of the old, which usually means no
+	// more than overwriting the one that was edited
+	applyStep ( i );
+	std::vector<Span>::iterator it;
+	for ( it = found.begin(); it != found.end(); ++it )
+	{
+		it->start -= stepLength;
+		it->end -= stepLength;
+	}
+	size_t replaced = ( found.size() < j - i ) ? found.size() : j - i;
+	bool nesting = ( found.size() != j - i );
+	for ( size_t k = 0; k < replaced && !nesting; ++k )
+		nesting = ( found[k].type != spans[i + k].type );
+	if ( j > i || !found.empty() )
+		noteChange ( ( int ) i, ( int ) j, ( int ) ( i + found.size() ), nesting );
+	std::copy ( found.begin(), found.begin() + replaced, spans.begin() + i );
+	if ( replaced < j - i )
+		spans.erase ( spans.begin() + i + replaced, spans.begin() + j );
+	else
+		spans.insert ( spans.begin() + j, found.begin() + replaced, found.end() );
+	if ( resolved > i )
+		resolved = i;
+}
+
+void TagIndex::fetch ( int pos )
+{
+	chunkStart = pos;
+	chunkEnd = ( length - pos > TAG_INDEX_CHUNK_SIZE ) ?
+	           pos + TAG_INDEX_CHUNK_SIZE : length;
+	if ( chunkEnd > chunkStart )
+	{
+		wxCharBuffer buffer = ctrl->GetTextRangeRaw ( chunkStart, chunkEnd );
+		memcpy ( &chunk[0], buffer.data(), chunkEnd - chunkStart );
+	}
+}
+
+int TagIndex::charAt ( int pos )
+{
+	if ( pos < 0 || pos >= length )
+		return -1;
+	if ( pos < chunkStart || pos >= chunkEnd )
+		fetch ( pos );
+	return ( unsigned char ) chunk[pos - chunkStart];
+}
+
+int TagIndex::find ( int pos, char c )
+{
+	while ( pos >= 0 && pos < length )
+	{
+		if ( pos < chunkStart || pos >= chunkEnd )
+			fetch ( pos );
+		const char *begin = &chunk[0] + ( pos - chunkStart );
+		const char *found = ( const char * ) memchr ( begin, c, chunkEnd - pos );
+		if ( found )
+			return chunkStart + ( found - &chunk[0] );
+		pos = chunkEnd;
+	}
+	return -1;
+}
+
+int TagIndex::find ( int pos, const char *s )
+{
+	for ( ;; )
+	{
+		pos = find ( pos, s[0] );
+		if ( pos < 0 )
+			return -1;
+		if ( matchAt ( pos, s ) )
+			return pos;
+		++pos;
+	}
+}
+
+bool TagIndex::matchAt ( int pos, const char *s )
+{
+	for ( ; *s; ++s, ++pos )
+		if ( charAt ( pos ) != ( unsigned char ) *s )
+			return false;
+	return true;
+}
+
+// Finds the '>' that closes the markup starting at pos; returns false if
+// there is none
+bool TagIndex::scanMarkup ( int pos, int &end, int &type )
+{
+	int c = charAt ( pos + 1 );
+	int found;
+	type = TAG_TYPE_OTHER;
+	if ( c == '!' )
+	{
+		if ( matchAt ( pos + 2, "--" ) )
+		{
+			found = find ( pos + 4, "-->" );
+			end = found + 2;
+			return found >= 0;
+		}
+		if ( matchAt ( pos + 2, "[CDATA[" ) )
+		{
+			found = find ( pos + 9, "]]>" );
+			end = found + 2;
+			return found >= 0;
+		}
+
+		// a declaration, which may hold an internal subset
+		int depth = 0, quote = 0;
+		for ( int i = pos + 2; ; ++i )
+		{
+			c = charAt ( i );
+			if ( c < 0 )
+				return false;
+			else if ( quote )
+			{
+				if ( c == quote )
+					quote = 0;
+			}
+			else if ( c == '"' || c == '\'' )
+				quote = c;
+			else if ( c == '[' )
+				++depth;
+			else if ( c == ']' )
+				--depth;
+			else if ( c == '<' && matchAt ( i + 1, "!--" ) )
+			{
+				i = find ( i + 4, "-->" );
+				if ( i < 0 )
+					return false;
+				i += 2;
+			}
+			else if ( c == '>' && depth <= 0 )
+			{
+				end = i;
+				return true;
+			}
+		}
+	}
+	else if ( c == '?' )
+	{
+		found = find ( pos + 2, "?>" );
+		end = found + 1;
+		return found >= 0;
+	}
+	else if ( c == '/' )
+	{
+		type = TAG_TYPE_CLOSE;
+		end = find ( pos + 2, '>' );
+		return end >= 0;
+	}
+
+	// attribute values may hold '>'
+	int quote = 0, last = 0;
+	for ( int i = pos + 1; ; ++i )
+	{
+		c = charAt ( i );
+		if ( c < 0 )
+			return false;
+		else if ( quote )
+		{
+			if ( c == quote )
+				quote = 0;
+		}
+		else if ( ( c == '"' || c == '\'' ) && last == '=' )
+			quote = c;
+		else if ( c == '>' )
+		{
+			end = i;
+			type = ( last == '/' ) ? TAG_TYPE_EMPTY : TAG_TYPE_OPEN;
+			return true;
+		}
+		if ( !quote && c != ' ' && c != '\t' && c != '\r' && c != '\n' )
+			last = c;
+	}
+}
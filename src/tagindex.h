@@ -0,0 +1,120 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TAG_INDEX_H
+#define TAG_INDEX_H
+
+#include <wx/wx.h>
+#include <wx/stc/stc.h>
+#include <vector>
+#include <string>
+
+// Positions of the markup in an XmlCtrl: every tag, comment, CDATA
+// section, processing instruction and declaration is a span running from
+// its '<' to its '>'. The index is patched from the control's modification
+// notifications, rescanning only from the edit to the point where the old
+// spans line up again, so finding the element around a position takes a
+// binary search instead of a walk back through the text.
+//
+// Span positions are kept the way Scintilla keeps line starts: spans from
+// stepIndex on still owe stepLength, which is only paid out when an edit
+// elsewhere moves the step, so typing in one place costs no more in a
+// large document than in a small one.
+class TagIndex
+{
+	public:
+		TagIndex ( wxStyledTextCtrl *ctrl );
+		void clear();
+
+		// to be called after text has been inserted or deleted
+		void insert ( int pos, int len );
+		void remove ( int pos, int len );
+
+		// position of the '>' of the innermost open tag that encloses pos,
+		// counting any tag that ends at pos; -1 at the top level
+		int getParentEnd ( int pos );
+		// TAG_TYPE_* of the tag whose '>' is at pos
+		int getTagType ( int pos );
+		// position of the '<' of the tag whose '>' is at pos, or -1
+		int getTagStart ( int pos );
+		// true if pos lies within markup, after its '<'
+		bool isInMarkup ( int pos );
+		// position of the '<' or the '>' of the markup that pos lies
+		// within, as for isInMarkup; -1 if none
+		int getMarkupStart ( int pos );
+		int getMarkupEnd ( int pos );
+		// position of the '<' of the first markup at or after pos, or -1
+		int getNextMarkupStart ( int pos );
+
+		// Elements are known by the number of their start tag among the
+		// spans; the top level is element -1. The numbers stay the same
+		// until an edit adds or removes markup before them.
+		void getChildElements ( int element, std::vector<int> &children );
+		bool hasChildElements ( int element );
+		int getElementStart ( int element );
+		std::string getElementName ( int element );
+		// Reports the spans changed since the last call: those numbered
+		// from first up to oldEnd were replaced by those from first up to
+		// newEnd. nesting is false if only the text within markup changed,
+		// so that every element is numbered and nested as it was. Returns
+		// false if nothing has changed.
+		bool takeChanges ( int &first, int &oldEnd, int &newEnd, bool &nesting );
+	private:
+		struct Span
+		{
+			int start, end;
+			int type;
+			int after; // index of the open tag enclosing the text after the span
+		};
+		wxStyledTextCtrl *ctrl;
+		std::vector<Span> spans;
+		size_t stepIndex;
+		int stepLength;
+		size_t resolved; // spans whose after field is up to date
+		int unterminated; // first '<' whose markup is never closed, or -1
+
+		// the changes not yet taken, merged into one run of spans
+		bool changed, changedNesting;
+		int changedFirst, changedOldEnd, changedNewEnd;
+
+		// text read from the control a chunk at a time
+		std::vector<char> chunk;
+		int chunkStart, chunkEnd, length;
+
+		int getStart ( size_t i );
+		int getEnd ( size_t i );
+		void applyStep ( size_t i );
+		// index of the first span starting (or ending) at or after pos
+		size_t findStart ( int pos );
+		size_t findEnd ( int pos );
+		// index of the last span ending at or before pos, or -1
+		int findEndingBefore ( int pos );
+		void resolve ( size_t i );
+		void rescan ( int from, int editEnd, size_t i, bool resync );
+		void noteChange ( int first, int oldEnd, int newEnd, bool nesting );
+
+		void fetch ( int pos );
+		int charAt ( int pos );
+		int find ( int pos, char c );
+		int find ( int pos, const char *s );
+		bool matchAt ( int pos, const char *s );
+		bool scanMarkup ( int pos, int &end, int &type );
+};
+
+#endif
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include "textdiff.h"
+
+// steps the line matching may take over the whole comparison; once they
+// are spent, what is left is matched at unique lines only
+#define TEXT_DIFF_WORK ( 1LL << 26 )
+
+void TextDiff::compare (
+    const char *oldText,
+    size_t oldLen,
+    const char *newText,
+    size_t newLen,
+    std::vector<Hunk> &hunks )
+{
+	hunks.clear();
+
+	// most edits leave the start and the end alone
+	size_t prefix = 0;
+	while ( prefix < oldLen && prefix < newLen && oldText[prefix] == newText[prefix] )
+		++prefix;
+	size_t suffix = 0;
+	while ( suffix < oldLen - prefix && suffix < newLen - prefix &&
+	        oldText[oldLen - suffix - 1] == newText[newLen - suffix - 1] )
+		++suffix;
+	if ( prefix == oldLen && prefix == newLen )
+		return;
+
+	Lines a, b;
+	split ( oldText + prefix, oldLen - prefix - suffix, a );
+	split ( newText + prefix, newLen - prefix - suffix, b );
+	TextDiff diff ( a, b, prefix, hunks );
+	diff.compareLines ( 0, ( int ) a.hashes.size(), 0, ( int ) b.hashes.size() );
+}
+
+TextDiff::TextDiff (
+    const Lines &aParameter,
+    const Lines &bParameter,
+    size_t baseParameter,
+    std::vector<Hunk> &hunksParameter )
+	: a ( aParameter )
+	, b ( bParameter )
+	, base ( baseParameter )
+	, work ( TEXT_DIFF_WORK )
+	, hunks ( hunksParameter )
+{
+}
+
+void TextDiff::split ( const char *text, size_t len, Lines &lines )
+{
+	lines.text = text;
+	size_t start = 0;
+	while ( start < len )
+	{
+		const char *end = ( const char * ) memchr ( text + start, '\n', len - start );
+		size_t next = ( end ) ? end - text + 1 : len;
+
+		// FNV-1a
+		size_t hash = 2166136261u;
+		for ( size_t i = start; i < next; ++i )
+			hash = ( hash ^ ( unsigned char ) text[i] ) * 16777619u;
+
+		lines.starts.push_back ( start );
+		lines.hashes.push_back ( hash );
+		start = next;
+	}
+	lines.starts.push_back ( len );
+}
+
+void TextDiff::compareLines ( int a0, int a1, int b0, int b1 )
+{
+	while ( a0 < a1 && b0 < b1 && equal ( a0, b0 ) )
+		++a0, ++b0;
+	while ( a0 < a1 && b0 < b1 && equal ( a1 - 1, b1 - 1 ) )
+		--a1, --b1;
+	if ( a0 == a1 && b0 == b1 )
+		return;
+
+	int x, y, u, v;
+	if ( a0 != a1 && b0 != b1 )
+	{
+		if ( findMiddleSnake ( a0, a1, b0, b1, x, y, u, v ) )
+		{
+			compareLines ( a0, x, b0, y );
+			compareLines ( u, a1, v, b1 );
+			return;
+		}
+		if ( splitAtUniqueLines ( a0, a1, b0, b1 ) )
+			return;
+	}
+	addHunk ( a0, a1, b0, b1 );
+}
+
+// Finds a run of matching lines on an optimal path from (a0, b0) to
+// (a1, b1), searching from both ends at once; the run goes from (x, y) to
+// (u, v). Returns false if the work left runs out first.
+bool TextDiff::findMiddleSnake (
+    int a0, int a1, int b0, int b1,
+    int &x, int &y, int &u, int &v )
+{
+	int n = a1 - a0, m = b1 - b0;
+	int delta = n - m;
+	bool odd = ( delta & 1 ) != 0;
+	// reaching cost d takes at least d * d steps
+	int max = ( n + m + 1 ) / 2;
+	while ( max > 0 && ( long long ) max * max > work )
+		max /= 2;
+
+	// diagonal k is at offset + k; both searches count x from their start
+	int offset = max + 1;
+	forward.assign ( 2 * offset + 1, 0 );
+	backward.assign ( 2 * offset + 1, 0 );
+
+	for ( int d = 0; d <= max && work > 0; ++d )
+	{
+		for ( int k = -d; k <= d; k += 2 )
+		{
+			int i = ( k == -d || ( k != d && forward[offset + k - 1] < forward[offset + k + 1] ) ) ?
+			        forward[offset + k + 1] : forward[offset + k - 1] + 1;
+			int j = i - k;
+			int startI = i, startJ = j;
+			while ( i < n && j < m && equal ( a0 + i, b0 + j ) )
+				++i, ++j;
+			forward[offset + k] = i;
+			work -= 1 + i - startI;
+
+			int c = delta - k; // the same diagonal, seen from the end
+			if ( odd && c >= - ( d - 1 ) && c <= d - 1 && i + backward[offset + c] >= n )
+			{
+				x = a0 + startI;
+				y = b0 + startJ;
+				u = a0 + i;
+				v = b0 + j;
+				return true;
+			}
+		}
+		for ( int k = -d; k <= d; k += 2 )
+		{
+			int i = ( k == -d || ( k != d && backward[offset + k - 1] < backward[offset + k + 1] ) ) ?
+			        backward[offset + k + 1] : backward[offset + k - 1] + 1;
+			int j = i - k;
+			int startI = i, startJ = j;
+			while ( i < n && j < m && equal ( a1 - 1 - i, b1 - 1 - j ) )
+				++i, ++j;
+			backward[offset + k] = i;
+			work -= 1 + i - startI;
+
+			int c = delta - k;
+			if ( !odd && c >= -d && c <= d && i + forward[offset + c] >= n )
+			{
+				x = a1 - i;
+				y = b1 - j;
+				u = a1 - startI;
+				v = b1 - startJ;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Matches the lines that occur once on each side, keeping the longest
+// sequence of them that is in the same order on both (found by patience
+// sorting), and compares the runs in between. Returns false if there are
+// no such lines.
+bool TextDiff::splitAtUniqueLines ( int a0, int a1, int b0, int b1 )
+{
+	std::vector<Occurrence> occurrences;
+	occurrences.reserve ( a1 - a0 + b1 - b0 );
+	Occurrence occurrence;
+	for ( occurrence.side = 0; occurrence.side < 2; ++occurrence.side )
+	{
+		const Lines &lines = ( occurrence.side ) ? b : a;
+		int end = ( occurrence.side ) ? b1 : a1;
+		for ( occurrence.line = ( occurrence.side ) ? b0 : a0; occurrence.line < end; ++occurrence.line )
+		{
+			occurrence.hash = lines.hashes[occurrence.line];
+			occurrences.push_back ( occurrence );
+		}
+	}
+	std::sort ( occurrences.begin(), occurrences.end() );
+
+	// pairs of old and new line numbers, in the order of the old
+	std::vector<std::pair<int, int> > unique;
+	size_t count = occurrences.size();
+	for ( size_t i = 0; i < count; )
+	{
+		size_t j = i + 1;
+		while ( j < count && occurrences[j].hash == occurrences[i].hash )
+			++j;
+		if ( j == i + 2 && occurrences[i].side == 0 && occurrences[i + 1].side == 1 &&
+		        equal ( occurrences[i].line, occurrences[i + 1].line ) )
+			unique.push_back ( std::make_pair ( occurrences[i].line, occurrences[i + 1].line ) );
+		i = j;
+	}
+	if ( unique.empty() )
+		return false;
+	std::sort ( unique.begin(), unique.end() );
+
+	// tails[k] is the pair ending the best sequence of length k + 1 so far
+	std::vector<int> tails, previous ( unique.size() );
+	for ( size_t i = 0; i < unique.size(); ++i )
+	{
+		int low = 0, high = ( int ) tails.size();
+		while ( low < high )
+		{
+			int middle = ( low + high ) / 2;
+			if ( unique[tails[middle]].second < unique[i].second )
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		previous[i] = ( low ) ? tails[low - 1] : -1;
+		if ( low == ( int ) tails.size() )
+			tails.push_back ( ( int ) i );
+		else
+			tails[low] = ( int ) i;
+	}
+	std::vector<int> sequence;
+	for ( int i = tails.back(); i >= 0; i = previous[i] )
+		sequence.push_back ( i );
+
+	std::vector<int>::reverse_iterator it;
+	for ( it = sequence.rbegin(); it != sequence.rend(); ++it )
+	{
+		compareLines ( a0, unique[*it].first, b0, unique[*it].second );
+		a0 = unique[*it].first + 1;
+		b0 = unique[*it].second + 1;
+	}
+	compareLines ( a0, a1, b0, b1 );
+	return true;
+}
+
+bool TextDiff::Occurrence::operator< ( const Occurrence &other ) const
+{
+	if ( hash != other.hash )
+		return hash < other.hash;
+	if ( side != other.side )
+		return side < other.side;
+	return line < other.line;
+}
+
+bool TextDiff::equal ( int i, int j )
+{
+	if ( a.hashes[i] != b.hashes[j] )
+		return false;
+	size_t len = a.starts[i + 1] - a.starts[i];
+	return len == b.starts[j + 1] - b.starts[j] &&
+	       !memcmp ( a.text + a.starts[i], b.text + b.starts[j], len );
+}
+
+// Adds the replacement of lines a0 to a1 by lines b0 to b1, less the
+// bytes they have in common at either end
+void TextDiff::addHunk ( int a0, int a1, int b0, int b1 )
+{
+	const char *oldText = a.text, *newText = b.text;
+	size_t oldStart = a.starts[a0], oldEnd = a.starts[a1];
+	size_t newStart = b.starts[b0], newEnd = b.starts[b1];
+	while ( oldStart < oldEnd && newStart < newEnd && oldText[oldStart] == newText[newStart] )
+		++oldStart, ++newStart;
+	while ( oldStart < oldEnd && newStart < newEnd && oldText[oldEnd - 1] == newText[newEnd - 1] )
+		--oldEnd, --newEnd;
+
+	Hunk hunk;
+	hunk.oldPos = base + oldStart;
+	hunk.oldLen = oldEnd - oldStart;
+	hunk.newPos = base + newStart;
+	hunk.newLen = newEnd - newStart;
+	hunks.push_back ( hunk );
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef TEXT_DIFF_H
+#define TEXT_DIFF_H
+
+#include <cstddef>
+#include <vector>
+
+// Works out the ranges that have to be replaced to turn one text into
+// another: lines are matched as in diff (Myers' algorithm, in linear
+// space), and each changed run of lines is then narrowed down to the
+// bytes that differ. Where the lines differ too much for that to be
+// quick, the texts are first cut apart at lines that occur once in each
+// (as patience diff does); a run that still cannot be matched is left as
+// one range.
+class TextDiff
+{
+	public:
+		struct Hunk
+		{
+			size_t oldPos, oldLen; // range in the old text
+			size_t newPos, newLen; // its replacement in the new text
+		};
+		// hunks are returned in order and do not overlap
+		static void compare (
+		    const char *oldText,
+		    size_t oldLen,
+		    const char *newText,
+		    size_t newLen,
+		    std::vector<Hunk> &hunks );
+	private:
+		struct Lines
+		{
+			const char *text;
+			std::vector<size_t> starts; // one past the end last
+			std::vector<size_t> hashes;
+		};
+		struct Occurrence
+		{
+			size_t hash;
+			int side; // 0 for the old text, 1 for the new
+			int line;
+			bool operator< ( const Occurrence &other ) const;
+		};
+		const Lines &a, &b;
+		size_t base; // where the texts start to differ
+		long long work; // steps left for findMiddleSnake
+		std::vector<int> forward, backward;
+		std::vector<Hunk> &hunks;
+
+		TextDiff (
+		    const Lines &a,
+		    const Lines &b,
+		    size_t base,
+		    std::vector<Hunk> &hunks );
+		static void split ( const char *text, size_t len, Lines &lines );
+		void compareLines ( int a0, int a1, int b0, int b1 );
+		bool findMiddleSnake (
+		    int a0, int a1, int b0, int b1,
+		    int &x, int &y, int &u, int &v );
+		bool splitAtUniqueLines ( int a0, int a1, int b0, int b1 );
+		bool equal ( int i, int j );
+		void addHunk ( int a0, int a1, int b0, int b1 );
+};
+
+#endif
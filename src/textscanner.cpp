@@ -0,0 +1,257 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cstring>
+#include "textscanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TEXT_SCAN_BLOCK 32
+#elif defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define TEXT_SCAN_BLOCK 16
+#endif
+
+#ifdef TEXT_SCAN_BLOCK
+// sets one bit per byte: bytes with the high bit set, and line feeds
+static inline void scanBlock (
+    const unsigned char *p,
+    unsigned &high,
+    unsigned &lineFeeds )
+{
+#if TEXT_SCAN_BLOCK == 32
+	__m256i v = _mm256_loadu_si256 ( ( const __m256i * ) p );
+	high = ( unsigned ) _mm256_movemask_epi8 ( v );
+	lineFeeds = ( unsigned ) _mm256_movemask_epi8 (
+	                _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( '\n' ) ) );
+#else
+	__m128i v = _mm_loadu_si128 ( ( const __m128i * ) p );
+	high = ( unsigned ) _mm_movemask_epi8 ( v );
+	lineFeeds = ( unsigned ) _mm_movemask_epi8 (
+	                _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( '\n' ) ) );
+#endif
+}
+
+static inline size_t bitCount ( unsigned mask )
+{
+	size_t count = 0;
+	for ( ; mask; mask &= mask - 1 )
+		++count;
+	return count;
+}
+#endif
+
+size_t TextScanner::getSequenceLength (
+    const unsigned char *p,
+    const unsigned char *end )
+{
+	// RFC 3629: no overlong forms, surrogates or values above U+10FFFF
+	unsigned char c = *p, low = 0x80, high = 0xBF;
+	size_t len;
+	if ( c >= 0xC2 && c <= 0xDF )
+		len = 2;
+	else if ( c == 0xE0 )
+	{
+		len = 3;
+		low = 0xA0;
+	}
+	else if ( c == 0xED )
+	{
+		len = 3;
+		high = 0x9F;
+	}
+	else if ( c >= 0xE1 && c <= 0xEF )
+		len = 3;
+	else if ( c == 0xF0 )
+	{
+		len = 4;
+		low = 0x90;
+	}
+	else if ( c == 0xF4 )
+	{
+		len = 4;
+		high = 0x8F;
+	}
+	else if ( c >= 0xF1 && c <= 0xF3 )
+		len = 4;
+	else
+		return 0;
+
+	if ( ( size_t ) ( end - p ) < len || p[1] < low || p[1] > high )
+		return 0;
+	for ( size_t i = 2; i < len; ++i )
+		if ( ( p[i] & 0xC0 ) != 0x80 )
+			return 0;
+	return len;
+}
+
+static void getSignature (
+    const unsigned char *p,
+    size_t len,
+    TextScanResult &result )
+{
+	result.signatureLen = 0;
+	result.signature.clear();
+
+	// byte order marks, then the first character of a document without
+	// one (XML 1.0, appendix F)
+	if ( len >= 4 && !p[0] && !p[1] && p[2] == 0xFE && p[3] == 0xFF )
+	{
+		result.signature = "UTF-32BE";
+		result.signatureLen = 4;
+	}
+	else if ( len >= 4 && p[0] == 0xFF && p[1] == 0xFE && !p[2] && !p[3] )
+	{
+		result.signature = "UTF-32LE";
+		result.signatureLen = 4;
+	}
+	else if ( len >= 2 && p[0] == 0xFE && p[1] == 0xFF )
+	{
+		result.signature = "UTF-16BE";
+		result.signatureLen = 2;
+	}
+	else if ( len >= 2 && p[0] == 0xFF && p[1] == 0xFE )
+	{
+		result.signature = "UTF-16LE";
+		result.signatureLen = 2;
+	}
+	else if ( len >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF )
+	{
+		result.signature = "UTF-8";
+		result.signatureLen = 3;
+	}
+	else if ( len >= 4 && !p[0] && !p[1] && !p[2] && p[3] == '<' )
+		result.signature = "UTF-32BE";
+	else if ( len >= 4 && p[0] == '<' && !p[1] && !p[2] && !p[3] )
+		result.signature = "UTF-32LE";
+	else if ( len >= 4 && !p[0] && p[1] == '<' && !p[2] && p[3] == '?' )
+		result.signature = "UTF-16BE";
+	else if ( len >= 4 && p[0] == '<' && !p[1] && p[2] == '?' && !p[3] )
+		result.signature = "UTF-16LE";
+}
+
+void TextScanner::scan ( const char *buffer, size_t len, TextScanResult &result )
+{
+	const unsigned char *begin = ( const unsigned char * ) buffer;
+	const unsigned char *end = begin + len;
+
+	getSignature ( begin, len, result );
+	const unsigned char *p = begin + result.signatureLen;
+
+	// wider encodings are only counted
+	bool wide = !result.signature.empty() && result.signature != "UTF-8";
+	result.ascii = result.utf8 = !wide;
+	result.invalidOffset = ( wide ) ? 0 : len;
+	result.lines = 0;
+
+	while ( p < end )
+	{
+#ifdef TEXT_SCAN_BLOCK
+		if ( end - p >= TEXT_SCAN_BLOCK )
+		{
+			unsigned high, lineFeeds;
+			scanBlock ( p, high, lineFeeds );
+			result.lines += bitCount ( lineFeeds );
+
+			const unsigned char *blockEnd = p + TEXT_SCAN_BLOCK;
+			if ( !high || !result.utf8 )
+			{
+				if ( high )
+					result.ascii = false;
+				p = blockEnd;
+				continue;
+			}
+
+			// a sequence may run on past the block; its continuation
+			// bytes are never line feeds
+			result.ascii = false;
+			while ( p < blockEnd )
+			{
+				if ( *p < 0x80 )
+				{
+					++p;
+					continue;
+				}
+				size_t n = getSequenceLength ( p, end );
+				if ( !n )
+				{
+					result.utf8 = false;
+					result.invalidOffset = p - begin;
+					p = blockEnd;
+					break;
+				}
+				p += n;
+			}
+			continue;
+		}
+#endif
+		if ( *p < 0x80 )
+		{
+			if ( *p == '\n' )
+				++result.lines;
+			++p;
+			continue;
+		}
+
+		result.ascii = false;
+		size_t n = ( result.utf8 ) ? getSequenceLength ( p, end ) : 1;
+		if ( !n )
+		{
+			result.utf8 = false;
+			result.invalidOffset = p - begin;
+			n = 1;
+		}
+		p += n;
+	}
+}
+
+size_t TextScanner::countLines ( const char *begin, const char *end )
+{
+	size_t n = ( size_t ) -1;
+	skipLines ( begin, end, n );
+	return ( size_t ) -1 - n;
+}
+
+const char *TextScanner::skipLines (
+    const char *begin,
+    const char *end,
+    size_t &n )
+{
+	const char *p = begin;
+#ifdef TEXT_SCAN_BLOCK
+	while ( n && end - p >= TEXT_SCAN_BLOCK )
+	{
+		unsigned high, lineFeeds;
+		scanBlock ( ( const unsigned char * ) p, high, lineFeeds );
+		size_t count = bitCount ( lineFeeds );
+		if ( count >= n )
+			break; // the line ends in this block
+		n -= count;
+		p += TEXT_SCAN_BLOCK;
+	}
+#endif
+	while ( n && p < end &&
+	        ( p = ( const char * ) memchr ( p, '\n', end - p ) ) != NULL )
+	{
+		++p;
+		--n;
+	}
+	return ( p ) ? p : end;
+}
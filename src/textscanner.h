@@ -0,0 +1,60 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef TEXT_SCANNER_H
+#define TEXT_SCANNER_H
+
+#include <string>
+#include <cstddef>
+
+struct TextScanResult
+{
+	// encoding given by a byte order mark or by the first character
+	// ("<" or "<?xml"), or empty
+	std::string signature;
+	size_t signatureLen; // length of the byte order mark, if any
+	bool ascii, utf8;
+	size_t invalidOffset; // first byte that is not valid UTF-8
+	size_t lines; // number of line feeds
+};
+
+// Byte-level checks on a document, done sixteen (SSE2) or thirty-two
+// (AVX2) bytes at a time where the compiler targets those instruction
+// sets. Runs of ASCII are skipped a block at a time; only multibyte
+// sequences are decoded one by one.
+class TextScanner
+{
+	public:
+		// a single pass over the buffer fills in all of the result
+		static void scan ( const char *buffer, size_t len, TextScanResult &result );
+		static size_t countLines ( const char *begin, const char *end );
+		// returns the position after the nth line feed, or end if there
+		// are fewer; n is reduced by the number of line feeds passed
+		static const char *skipLines (
+		    const char *begin,
+		    const char *end,
+		    size_t &n );
+		// length of the valid UTF-8 sequence at p, or 0
+		static size_t getSequenceLength (
+		    const unsigned char *p,
+		    const unsigned char *end );
+};
+
+#endif
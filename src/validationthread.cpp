@@ -12,18 +12,18 @@ DEFINE_EVENT_TYPE(wxEVT_COMMAND_VALIDATION_COMPLETED);
 
 ValidationThread::ValidationThread (
 	wxEvtHandler *handler,
-	const char *buffer,
+	DocumentSnapshotPtr snapshot,
 	const wxString &system )
 	: wxThread ( wxTHREAD_JOINABLE )
 	, mStopping ( false )
 {
-	if ( buffer == NULL )
+	if ( !snapshot.get() )
 	{
 		throw;
 	}
 
 	myEventHandler = handler;
-	myBuffer = buffer;
+	mySnapshot = snapshot;
 	mySystem = system;
 	myIsSucceeded = false;
 }
@@ -34,17 +34,16 @@ void *ValidationThread::Entry()
 	
 	if ( TestDestroy()  )
 	{
-		myBuffer.clear();
+		mySnapshot.reset();
 		return NULL;
 	}
 
 	myIsSucceeded = validator->validateMemory (
-		myBuffer.c_str(),
-		myBuffer.size(),
+		mySnapshot,
 		mySystem,
 		this );
 
-	myBuffer.clear();
+	mySnapshot.reset();
 
 	if ( TestDestroy() )
 	{
@@ -5,6 +5,7 @@
 #include <utility>
 #include <string>
 #include <wx/thread.h>
+#include "documentsnapshot.h"
 
 DECLARE_EVENT_TYPE(wxEVT_COMMAND_VALIDATION_COMPLETED, wxID_ANY);
 
@@ -13,10 +14,9 @@ class ValidationThread : public wxThread
 public:
 	ValidationThread (
 	                 wxEvtHandler *handler,
-	                 const char *buffer,
+	                 DocumentSnapshotPtr snapshot,
 	                 const wxString &system );
 	virtual void *Entry();
-	void setBuffer ( const char *buffer, const char *system );
 	bool isSucceeded () { return myIsSucceeded; }
 	const std::pair<int, int> &getPosition() { return myPosition; }
 	const wxString &getMessage() { return myMessage; }
@@ -29,7 +29,7 @@ public:
 
 protected:
 	wxEvtHandler *myEventHandler;
-	std::string myBuffer;
+	DocumentSnapshotPtr mySnapshot;
 	wxString mySystem;
 	bool myIsSucceeded;
 	std::pair<int, int> myPosition;
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cerrno>
+#include "wrapiconv.h"
+
+typedef size_t universal_iconv (iconv_t cd,
+        char* * inbuf, size_t * inbytesleft,
+        char* * outbuf, size_t * outbytesleft);
+/* On other platform, it could be:
+size_t iconv (iconv_t cd,
+        const char* * inbuf, size_t * inbytesleft,
+        char* * outbuf, size_t * outbytesleft);
+and a char ** can't be assigned to const char **
+    http://c-faq.com/ansi/constmismatch.html
+*/
+
+WrapIconv::WrapIconv (
+    const char *toEncoding,
+    const char *fromEncoding,
+    size_t blockSize )
+	: block ( blockSize )
+	, cancelled ( false )
+	, continued ( false )
+{
+	cd = iconv_open ( toEncoding, fromEncoding );
+}
+
+WrapIconv::~WrapIconv()
+{
+	if ( cd != ( iconv_t ) -1 )
+		iconv_close ( cd );
+}
+
+bool WrapIconv::isOk()
+{
+	return cd != ( iconv_t ) -1;
+}
+
+bool WrapIconv::isCancelled()
+{
+	return cancelled;
+}
+
+bool WrapIconv::convert (
+    const char *buffer,
+    size_t bufferLen,
+    IconvSink &sink,
+    bool isFinal )
+{
+	cancelled = false;
+	if ( cd == ( iconv_t ) -1 || block.empty() )
+		return false;
+
+	// start from the initial shift state unless carrying on
+	if ( !continued )
+		reinterpret_cast < universal_iconv & > ( iconv ) ( cd, NULL, NULL, NULL, NULL );
+	continued = false;
+
+	char *in = ( char * ) buffer;
+	size_t inLeft = bufferLen;
+	bool flushed = false;
+	for ( ;; )
+	{
+		char *out = &block[0];
+		size_t outLeft = block.size();
+		size_t nconv = 0;
+
+		// once the final input is consumed, flush any pending shift
+		// sequence (ISO-2022-JP, UTF-7) back to the initial state
+		if ( inLeft )
+			nconv = reinterpret_cast < universal_iconv & > ( iconv ) (
+			            cd, &in, &inLeft, &out, &outLeft );
+		else if ( isFinal )
+		{
+			nconv = reinterpret_cast < universal_iconv & > ( iconv ) (
+			            cd, NULL, NULL, &out, &outLeft );
+			flushed = true;
+		}
+
+		size_t produced = block.size() - outLeft;
+		if ( nconv == ( size_t ) -1 && ( errno != E2BIG || !produced ) )
+			return false; // invalid or incomplete input
+
+		if ( produced && !sink.write ( &block[0], produced ) )
+			return false;
+
+		if ( !inLeft && nconv != ( size_t ) -1 )
+		{
+			if ( isFinal && !flushed )
+				continue;
+			continued = !isFinal;
+			break;
+		}
+
+		if ( !sink.progress ( bufferLen - inLeft, bufferLen ) )
+		{
+			cancelled = true;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef WRAP_ICONV_H
+#define WRAP_ICONV_H
+
+#include <iconv.h>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Receives the output of WrapIconv::convert one block at a time.
+class IconvSink
+{
+	public:
+		virtual ~IconvSink() {}
+		// return false to abort the conversion
+		virtual bool write ( const char *buffer, size_t bufferLen ) = 0;
+		// called after each block; return false to cancel the conversion
+		virtual bool progress ( size_t done, size_t total )
+		{
+			return true;
+		}
+};
+
+class IconvStreamSink : public IconvSink
+{
+	public:
+		IconvStreamSink ( std::ostream &stream ) : os ( stream ), bytes ( 0 ) { }
+		virtual bool write ( const char *buffer, size_t bufferLen )
+		{
+			os.write ( buffer, bufferLen );
+			bytes += bufferLen;
+			return os.good();
+		}
+		size_t getBytesWritten()
+		{
+			return bytes;
+		}
+	private:
+		std::ostream &os;
+		size_t bytes;
+};
+
+class IconvStringSink : public IconvSink
+{
+	public:
+		IconvStringSink ( std::string &s ) : output ( s ) { }
+		virtual bool write ( const char *buffer, size_t bufferLen )
+		{
+			output.append ( buffer, bufferLen );
+			return true;
+		}
+	private:
+		std::string &output;
+};
+
+// Converts between encodings in fixed-size blocks, so that the scratch
+// memory needed does not depend on the size of the input.
+class WrapIconv
+{
+	public:
+		WrapIconv (
+		    const char *toEncoding,
+		    const char *fromEncoding,
+		    size_t blockSize = 256 * 1024 );
+		~WrapIconv();
+		bool isOk();
+		// if isFinal is false the next call carries on where this one
+		// stopped, so the buffer must end on a character boundary
+		bool convert (
+		    const char *buffer,
+		    size_t bufferLen,
+		    IconvSink &sink,
+		    bool isFinal = true );
+		bool isCancelled();
+	private:
+		iconv_t cd;
+		std::vector<char> block;
+		bool cancelled, continued;
+
+		WrapIconv ( const WrapIconv& );
+		WrapIconv& operator= ( const WrapIconv& );
+};
+
+#endif
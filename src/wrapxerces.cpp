@@ -24,6 +24,8 @@
 #include <xercesc/sax2/DefaultHandler.hpp>
 #include <xercesc/util/XMLUni.hpp>
 #include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/util/BinInputStream.hpp>
+#include <xercesc/util/XercesVersion.hpp>
 #include <sstream>
 #include <utility>
 #include <stdexcept>
@@ -31,6 +33,59 @@
 
 using namespace xercesc;
 
+#if _XERCES_VERSION >= 30000
+typedef XMLSize_t StreamSize;
+typedef XMLFilePos StreamPos;
+#else
+typedef unsigned int StreamSize;
+typedef unsigned int StreamPos;
+#endif
+
+// Reads a DocumentSnapshot segment by segment, so that it need not be
+// copied into one buffer first
+class SnapshotInputStream : public BinInputStream
+{
+	public:
+		SnapshotInputStream ( DocumentSnapshotPtr snapshotParameter )
+			: snapshot ( snapshotParameter ), pos ( 0 )
+		{
+		}
+		virtual StreamPos curPos() const
+		{
+			return pos;
+		}
+		virtual StreamSize readBytes ( XMLByte* const toFill, const StreamSize maxToRead )
+		{
+			size_t n = snapshot->read ( pos, ( char * ) toFill, maxToRead );
+			pos += n;
+			return n;
+		}
+#if _XERCES_VERSION >= 30000
+		virtual const XMLCh *getContentType() const
+		{
+			return NULL;
+		}
+#endif
+	private:
+		DocumentSnapshotPtr snapshot;
+		size_t pos;
+};
+
+class SnapshotInputSource : public InputSource
+{
+	public:
+		SnapshotInputSource ( DocumentSnapshotPtr snapshotParameter, const XMLCh *systemId )
+			: InputSource ( systemId ), snapshot ( snapshotParameter )
+		{
+		}
+		virtual BinInputStream *makeStream() const
+		{
+			return new SnapshotInputStream ( snapshot );
+		}
+	private:
+		DocumentSnapshotPtr snapshot;
+};
+
 void WrapXerces::Init() throw()
 {
 	static class Initializer
@@ -117,6 +172,31 @@ bool WrapXerces::validateMemory (
 	size_t len,
 	const wxString &system,
 	wxThread *thread /*= NULL*/ )
+{
+	XMLByte* xmlBuffer = (XMLByte*) buffer;
+	MemBufInputSource source
+			( xmlBuffer
+			, len
+			, ( const XMLCh * ) ( const char * ) system.mb_str ( getMBConv() )
+			);
+	return validateSource ( source, thread );
+}
+
+bool WrapXerces::validateMemory (
+	DocumentSnapshotPtr snapshot,
+	const wxString &system,
+	wxThread *thread /*= NULL*/ )
+{
+	SnapshotInputSource source
+			( snapshot
+			, ( const XMLCh * ) ( const char * ) system.mb_str ( getMBConv() )
+			);
+	// the text is UTF-8 even where its declaration says otherwise
+	source.setEncoding ( XMLUni::fgUTF8EncodingString );
+	return validateSource ( source, thread );
+}
+
+bool WrapXerces::validateSource ( const InputSource &source, wxThread *thread )
 {
 	std::auto_ptr<SAX2XMLReader> parser ( XMLReaderFactory::createXMLReader() );
 
@@ -135,12 +215,6 @@ bool WrapXerces::validateMemory (
 	//parser->setEntityResolver ( &handler );
 	parser->setEntityResolver ( catalogResolver );
 
-	XMLByte* xmlBuffer = (XMLByte*) buffer;
-	MemBufInputSource source
-			( xmlBuffer
-			, len
-			, ( const XMLCh * ) ( const char * ) system.mb_str ( getMBConv() )
-			);
 	try
 	{
 		if ( thread == NULL )
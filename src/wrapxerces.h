@@ -33,6 +33,7 @@
 #include <xercesc/sax2/SAX2XMLReader.hpp>
 #include <xercesc/sax2/DefaultHandler.hpp>
 #include "xercescatalogresolver.h"
+#include "documentsnapshot.h"
 
 using namespace xercesc;
 
@@ -45,6 +46,9 @@ class WrapXerces
 		bool validate ( const wxString &fileName );
 		bool validateMemory ( const char *buffer, size_t len,
 		    const wxString &system, wxThread *thread = NULL );
+		// the snapshot is read as UTF-8 whatever its declaration says
+		bool validateMemory ( DocumentSnapshotPtr snapshot,
+		    const wxString &system, wxThread *thread = NULL );
 		const wxString &getLastError();
 		std::pair<int, int> getErrorPosition();
 		static wxString toString ( const XMLCh *str );
@@ -57,6 +61,7 @@ class WrapXerces
 
 	private:
 		static const wxMBConv &getMBConv();
+		bool validateSource ( const InputSource &source, wxThread *thread );
 
 		XercesCatalogResolver *catalogResolver;
 		wxString lastError;
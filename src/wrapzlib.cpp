@@ -0,0 +1,186 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <fstream>
+#include <zlib.h>
+#include "wrapzlib.h"
+
+// windowBits for a gzip wrapper rather than a zlib one
+static const int GZIP_WINDOW_BITS = 15 + 16;
+
+WrapZlib::WrapZlib ( size_t blockSize )
+	: block ( blockSize )
+	, cancelled ( false )
+{
+}
+
+bool WrapZlib::isCompressed ( const char *buffer, size_t bufferLen )
+{
+	return bufferLen >= 2 &&
+	       ( unsigned char ) buffer[0] == 0x1f &&
+	       ( unsigned char ) buffer[1] == 0x8b;
+}
+
+bool WrapZlib::isCompressedName ( const std::string &fileName )
+{
+	size_t len = fileName.size();
+	return len > 3 &&
+	       fileName[len - 3] == '.' &&
+	       ( fileName[len - 2] == 'g' || fileName[len - 2] == 'G' ) &&
+	       ( fileName[len - 1] == 'z' || fileName[len - 1] == 'Z' );
+}
+
+bool WrapZlib::isCancelled()
+{
+	return cancelled;
+}
+
+bool WrapZlib::inflate ( const char *buffer, size_t bufferLen, IconvSink &sink )
+{
+	cancelled = false;
+	if ( block.empty() )
+		return false;
+
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	zs.next_in = ( Bytef * ) buffer;
+	zs.avail_in = 0;
+	if ( inflateInit2 ( &zs, GZIP_WINDOW_BITS ) != Z_OK )
+		return false;
+
+	// avail_in is only an unsigned int, so very large inputs are fed
+	// in slices
+	const size_t maxSlice = 1024 * 1024 * 1024;
+	size_t inLeft = bufferLen;
+	bool ok = true;
+	for ( ;; )
+	{
+		if ( !zs.avail_in && inLeft )
+		{
+			size_t slice = ( inLeft > maxSlice ) ? maxSlice : inLeft;
+			zs.avail_in = ( uInt ) slice;
+			inLeft -= slice;
+		}
+
+		zs.next_out = ( Bytef * ) &block[0];
+		zs.avail_out = ( uInt ) block.size();
+		int result = ::inflate ( &zs, Z_NO_FLUSH );
+		if ( result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR )
+		{
+			ok = false;
+			break;
+		}
+
+		size_t produced = block.size() - zs.avail_out;
+		if ( produced && !sink.write ( &block[0], produced ) )
+		{
+			ok = false;
+			break;
+		}
+
+		if ( result == Z_STREAM_END )
+		{
+			// gzip files may hold several members one after another
+			size_t left = zs.avail_in + inLeft;
+			if ( !isCompressed ( ( const char * ) zs.next_in, left ) )
+				break;
+			inflateReset ( &zs );
+		}
+		else if ( result == Z_BUF_ERROR && !produced && !zs.avail_in && !inLeft )
+		{
+			ok = false; // truncated
+			break;
+		}
+
+		if ( !sink.progress ( bufferLen - inLeft - zs.avail_in, bufferLen ) )
+		{
+			cancelled = true;
+			ok = false;
+			break;
+		}
+	}
+	inflateEnd ( &zs );
+	return ok;
+}
+
+bool WrapZlib::compressFile (
+    const std::string &sourceFileName,
+    const std::string &destFileName,
+    size_t &bytes )
+{
+	bytes = 0;
+	if ( block.empty() )
+		return false;
+
+	std::ifstream ifs ( sourceFileName.c_str(), std::ios::in | std::ios::binary );
+	std::ofstream ofs ( destFileName.c_str(), std::ios::out | std::ios::binary );
+	if ( !ifs || !ofs )
+		return false;
+
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree = Z_NULL;
+	zs.opaque = Z_NULL;
+	if ( deflateInit2 (
+	            &zs,
+	            Z_DEFAULT_COMPRESSION,
+	            Z_DEFLATED,
+	            GZIP_WINDOW_BITS,
+	            8,
+	            Z_DEFAULT_STRATEGY ) != Z_OK )
+		return false;
+
+	std::vector<char> input ( block.size() );
+	bool ok = true;
+	int flush = Z_NO_FLUSH;
+	while ( ok && flush != Z_FINISH )
+	{
+		ifs.read ( &input[0], input.size() );
+		zs.next_in = ( Bytef * ) &input[0];
+		zs.avail_in = ( uInt ) ifs.gcount();
+		if ( ifs.eof() )
+			flush = Z_FINISH;
+		else if ( !ifs )
+			ok = false;
+
+		// deflate until the input is used up (and, at the end, until
+		// the trailer has been written)
+		do
+		{
+			zs.next_out = ( Bytef * ) &block[0];
+			zs.avail_out = ( uInt ) block.size();
+			if ( deflate ( &zs, flush ) == Z_STREAM_ERROR )
+			{
+				ok = false;
+				break;
+			}
+			size_t produced = block.size() - zs.avail_out;
+			ofs.write ( &block[0], produced );
+			bytes += produced;
+			if ( !ofs )
+				ok = false;
+		}
+		while ( ok && zs.avail_out == 0 );
+	}
+	deflateEnd ( &zs );
+	ofs.close();
+	return ok && !ofs.fail();
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef WRAP_ZLIB_H
+#define WRAP_ZLIB_H
+
+#include <string>
+#include <vector>
+#include "wrapiconv.h"
+
+// Compresses and decompresses gzip streams in fixed-size blocks, so that
+// neither the whole compressed nor the whole plain text has to be held
+// twice. Output is handed to an IconvSink as it is produced.
+class WrapZlib
+{
+	public:
+		WrapZlib ( size_t blockSize = 256 * 1024 );
+		// true if the buffer starts with the gzip signature
+		static bool isCompressed ( const char *buffer, size_t bufferLen );
+		// true if the file name ends in ".gz"
+		static bool isCompressedName ( const std::string &fileName );
+		// decompresses one or more concatenated gzip members
+		bool inflate ( const char *buffer, size_t bufferLen, IconvSink &sink );
+		// writes a gzip-compressed copy of the file; bytes is set to the
+		// size of the copy
+		bool compressFile (
+		    const std::string &sourceFileName,
+		    const std::string &destFileName,
+		    size_t &bytes );
+		bool isCancelled();
+	private:
+		std::vector<char> block;
+		bool cancelled;
+
+		WrapZlib ( const WrapZlib& );
+		WrapZlib& operator= ( const WrapZlib& );
+};
+
+#endif
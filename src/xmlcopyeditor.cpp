@@ -20,6 +20,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
 #include <wx/aboutdlg.h>
 #include "xmlcopyeditor.h"
 #include "xmlcopyeditorcopy.h"
@@ -45,18 +46,19 @@
 #include "aboutdialog.h"
 #include "pathresolver.h"
 #include "locationpanel.h"
+#include "outlinepanel.h"
 #include "insertpanel.h"
 #include "xmlwordcount.h"
 #include "mynotebook.h"
 #include "commandpanel.h"
-#include "binaryfile.h"
 #include "exportdialog.h"
 #include <wx/aui/auibook.h>
 #include <wx/richtext/richtextsymboldlg.h>
 #include <wx/textctrl.h>
 #include <wx/artprov.h>
 #include <wx/stockitem.h>
-#include <iconv.h>
+#include <wx/progdlg.h>
+#include <wx/timer.h>
 #include <wx/stdpaths.h>
 #include <wx/tokenzr.h>
 #include <wx/dir.h>
@@ -71,21 +73,18 @@
 #endif
 
 #include "wrapxerces.h"
+#include "wrapiconv.h"
+#include "wrapzlib.h"
+#include "indexcache.h"
+#include "fileloader.h"
+#include "openfilethread.h"
+#include "xmltextview.h"
 #ifndef __WXMSW__
 #include "xpm/appicon.xpm"
 #endif
 
-typedef size_t universal_iconv (iconv_t cd,
-        char* * inbuf, size_t * inbytesleft,
-        char* * outbuf, size_t * outbytesleft);
-/* On other platform, it could be:
-size_t iconv (iconv_t cd,
-        const char* * inbuf, size_t * inbytesleft,
-        char* * outbuf, size_t * outbytesleft);
-and a char ** can't be assigned to const char **
-    http://c-faq.com/ansi/constmismatch.html
-Let's deal with this mess.
-*/
+// global protection for background threads; defined in xmlctrl.cpp
+extern wxCriticalSection xmlcopyeditorCriticalSection;
 
 BEGIN_EVENT_TABLE ( MyFrame, wxFrame )
 	EVT_ACTIVATE_APP ( MyFrame::OnActivateApp )
@@ -153,6 +152,7 @@ BEGIN_EVENT_TABLE ( MyFrame, wxFrame )
 	EVT_MENU ( ID_DOWNLOAD_SOURCE, MyFrame::OnDownloadSource )
 	EVT_MENU ( ID_TOOLBAR_VISIBLE, MyFrame::OnToolbarVisible )
 	EVT_MENU ( ID_LOCATION_PANE_VISIBLE, MyFrame::OnLocationPaneVisible )
+	EVT_MENU ( ID_OUTLINE_PANE_VISIBLE, MyFrame::OnOutlinePaneVisible )
 	EVT_MENU ( ID_PROTECT_TAGS, MyFrame::OnProtectTags )
 	EVT_MENU ( ID_WRAP_WORDS, MyFrame::OnWrapWords )
 	EVT_MENU_RANGE ( ID_SHOW_TAGS, ID_HIDE_TAGS, MyFrame::OnVisibilityState )
@@ -177,6 +177,7 @@ BEGIN_EVENT_TABLE ( MyFrame, wxFrame )
 	EVT_FIND_REPLACE_ALL ( wxID_ANY, MyFrame::OnDialogReplaceAll )
 	EVT_ICONIZE ( MyFrame::OnIconize )
 	EVT_UPDATE_UI ( ID_LOCATION_PANE_VISIBLE, MyFrame::OnUpdateLocationPaneVisible )
+	EVT_UPDATE_UI ( ID_OUTLINE_PANE_VISIBLE, MyFrame::OnUpdateOutlinePaneVisible )
 	EVT_UPDATE_UI ( wxID_CLOSE, MyFrame::OnUpdateDocRange )
 	EVT_UPDATE_UI ( wxID_SAVEAS, MyFrame::OnUpdateDocRange )
 	EVT_UPDATE_UI ( wxID_CLOSE_ALL, MyFrame::OnUpdateCloseAll )
@@ -195,7 +196,14 @@ BEGIN_EVENT_TABLE ( MyFrame, wxFrame )
 	EVT_UPDATE_UI ( ID_HIDE_PANE, MyFrame::OnUpdateClosePane )
 	EVT_UPDATE_UI ( ID_RELOAD, MyFrame::OnUpdateReload )
 	EVT_IDLE ( MyFrame::OnIdle )
+	EVT_TIMER ( ID_UPDATE_TIMER, MyFrame::OnUpdateTimer )
+	EVT_STC_UPDATEUI ( wxID_ANY, MyFrame::OnDocumentUpdateUI )
+	EVT_STC_SAVEPOINTREACHED ( wxID_ANY, MyFrame::OnDocumentSavePoint )
+	EVT_STC_SAVEPOINTLEFT ( wxID_ANY, MyFrame::OnDocumentSavePoint )
+	EVT_COMMAND ( wxID_ANY, wxEVT_COMMAND_OPEN_FILE_PROGRESS, MyFrame::OnOpenFileProgress )
+	EVT_COMMAND ( wxID_ANY, wxEVT_COMMAND_OPEN_FILE_COMPLETED, MyFrame::OnOpenFileCompleted )
 	EVT_AUINOTEBOOK_PAGE_CLOSE ( wxID_ANY, MyFrame::OnPageClosing )
+	EVT_AUINOTEBOOK_PAGE_CHANGED ( wxID_ANY, MyFrame::OnPageChanged )
 #ifdef __WXMSW__
 	EVT_DROP_FILES ( MyFrame::OnDropFiles )
 #endif
@@ -685,6 +693,13 @@ MyFrame::MyFrame (
 	lastPos = 0;
 	htmlReport = NULL;
 	lastDoc = NULL;
+	fileLoadCount = fileLoadsDone = 0;
+	fileLoadProgressBusy = false;
+	restoringTabs = false;
+	tabActivationCount = 0;
+	pendingUpdates = UPDATE_ALL;
+	deferredUpdates = 0;
+	updateTimer.SetOwner ( this, ID_UPDATE_TIMER );
 
 	wxString defaultFont = wxSystemSettings::GetFont ( wxSYS_SYSTEM_FONT ).GetFaceName();
 
@@ -801,13 +816,16 @@ MyFrame::MyFrame (
 		frameHeight = config->Read ( _T ( "frameHeight" ), frameHeight );
 		rememberOpenTabs = config->Read ( _T ( "rememberOpenTabs" ), true );
 		libxmlNetAccess = config->Read ( _T ( "libxmlNetAccess" ), longFalse );
+		useIndexCache = config->Read ( _T ( "indexCache" ), true );
 		openTabsOnClose = config->Read ( _T ( "openTabsOnClose" ), _T ( "" ) );
+		openTabsState = config->Read ( _T ( "openTabsState" ), _T ( "" ) );
 		notebookStyle = config->Read ( _T ( "notebookStyle" ), ID_NOTEBOOK_STYLE_VC8_COLOR );
 		saveBom = config->Read ( _T ( "saveBom" ), true );
 		unlimitedUndo = config->Read ( _T ( "unlimitedUndo" ), true );
 		layout = config->Read ( _T ( "layout" ), wxEmptyString );
 		restoreLayout = config->Read ( _T ( "restoreLayout" ), true );
 		showLocationPane = config->Read ( _T ( "showLocationPane" ), true );
+		showOutlinePane = config->Read ( _T ( "showOutlinePane" ), true );
 		showInsertChildPane = config->Read ( _T ( "showInsertChildPane" ), true );
 		showInsertSiblingPane = config->Read ( _T ( "showInsertSiblingPane" ), true );
 		showInsertEntityPane = config->Read ( _T ( "showInsertEntityPane" ), true );
@@ -845,12 +863,15 @@ MyFrame::MyFrame (
 		framePosX = framePosY = frameWidth = frameHeight = 0;
 		rememberOpenTabs = true;
 		libxmlNetAccess = false;
+		useIndexCache = true;
 		openTabsOnClose = wxEmptyString;
+		openTabsState = wxEmptyString;
 		notebookStyle = ID_NOTEBOOK_STYLE_VC8_COLOR;
 		saveBom = unlimitedUndo = true;
 		layout = wxEmptyString;
 		restoreLayout = true;
 		showLocationPane = true;
+		showOutlinePane = true;
 		showInsertChildPane = true;
 		showInsertSiblingPane = true;
 		showInsertEntityPane = true;
@@ -972,6 +993,12 @@ MyFrame::MyFrame (
 	                  .PaneBorder ( false ).Name ( _T ( "documentPane" ) ) );
 	manager.GetPane ( mainBook ).dock_proportion = 10;
 
+	outlinePanel = new OutlinePanel ( this, ID_OUTLINE_PANEL );
+	manager.AddPane ( ( wxWindow * ) outlinePanel, wxLEFT, _ ( "Outline" ) );
+	manager.GetPane ( outlinePanel ).Name ( _T ( "outlinePane" ) ).Show (
+	    ( restoreLayout ) ? showOutlinePane : true ).DestroyOnClose ( false ).PinButton ( true );
+	manager.GetPane ( outlinePanel ).dock_proportion = 1;
+
 	// add insert child panes
 	locationPanel = new LocationPanel ( this, ID_LOCATION_PANEL );
 	insertChildPanel = new InsertPanel ( this, ID_INSERT_CHILD_PANEL,
@@ -1053,6 +1080,11 @@ MyFrame::MyFrame (
 	    ( wxWindow * ) commandPanel,
 	    wxAuiPaneInfo().Bottom().Hide().Caption ( _T ( "Command" ) ).DestroyOnClose ( false ).Layer ( 3 ) );
 
+	// large documents reopen from the indexes kept here
+	if ( useIndexCache )
+		IndexCache::get().setDirectory ( wxStandardPaths::Get().GetUserDataDir()
+		                                 + wxFileName::GetPathSeparator() + _T ( "cache" ) );
+
 	if ( !wxFileName::DirExists ( applicationDir ) )
 #ifdef __WXMSW__
 		GetStatusBar()->SetStatusText ( _ ( "Cannot open application directory: see Tools, Options..., General" ) );
@@ -1094,6 +1126,7 @@ MyFrame::MyFrame (
 
 MyFrame::~MyFrame()
 {
+	cancelFileLoads();
 	ThreadReaper::get().clear();
 
 	std::vector<wxString>::iterator it;
@@ -1133,6 +1166,7 @@ MyFrame::~MyFrame()
 	config->Write ( _T ( "protectTags" ), protectTags );
 	config->Write ( _T ( "visibilityState" ), visibilityState );
  	config->Write ( _T ( "showLocationPane" ), manager.GetPane ( locationPanel ).IsShown() );
+	config->Write ( _T ( "showOutlinePane" ), manager.GetPane ( outlinePanel ).IsShown() );
 	config->Write ( _T ( "showInsertChildPane" ), manager.GetPane ( insertChildPanel ).IsShown() );
 	config->Write ( _T ( "showInsertSiblingPane" ), manager.GetPane ( insertSiblingPanel ).IsShown() );
 	config->Write ( _T ( "showInsertEntityPane" ), manager.GetPane ( insertEntityPanel ).IsShown() );
@@ -1165,7 +1199,9 @@ MyFrame::~MyFrame()
 
 	config->Write ( _T ( "rememberOpenTabs" ), rememberOpenTabs );
 	config->Write ( _T ( "openTabsOnClose" ), openTabsOnClose );
+	config->Write ( _T ( "openTabsState" ), openTabsState );
 	config->Write ( _T ( "libxmlNetAccess" ), libxmlNetAccess );
+	config->Write ( _T ( "indexCache" ), useIndexCache );
 
 	config->Write ( _T ( "singleInstanceCheck" ), singleInstanceCheck );
 	config->Write ( _T ( "lang" ), lang );
@@ -1259,15 +1295,16 @@ void MyFrame::handleCommandLine()
 	if ( !styleFlag && !wordFlag )
 #endif
 	{
+		wxArrayString fileNames;
 		for ( ; argc > 0; --argc, ++argv )
 		{
 			fileName = wxString ( *argv, wxConvLocal );
 			fileName = PathResolver::run ( fileName );
 			if ( isOpen ( fileName ) )
 				continue;
-			else if ( !openFile ( fileName ) )
-				break;
+			fileNames.Add ( fileName );
 		}
+		openFiles ( fileNames );
 		return;
 	}
 
@@ -1378,13 +1415,12 @@ void MyFrame::OnCheckWellformedness ( wxCommandEvent& event )
 	if ( ( doc = getActiveDocument() ) == NULL )
 		return;
 
-	std::string utf8Buffer;
-	getRawText ( doc, utf8Buffer );
-	if ( utf8Buffer.empty() )
+	XmlTextView text ( doc );
+	if ( text.empty() )
 		return;
 
 	// handle unusual encodings
-	if ( !XmlEncodingHandler::setUtf8 ( utf8Buffer ) )
+	if ( !text.setUtf8() )
 	{
 		encodingMessage();
 		return;
@@ -1395,7 +1431,7 @@ void MyFrame::OnCheckWellformedness ( wxCommandEvent& event )
 
 	// check for well-formedness
 	auto_ptr<WrapExpat> we ( new WrapExpat() );
-	if ( !we->parse ( utf8Buffer.c_str() ) )
+	if ( !text.parse ( *we ) )
 	{
 		statusProgress ( wxEmptyString );
 		messagePane ( we->getLastError(), CONST_WARNING );
@@ -1422,6 +1458,7 @@ void MyFrame::OnPageClosing ( wxAuiNotebookEvent& event ) //wxNotebookEvent& eve
 		insertChildPanel->update ( NULL, wxEmptyString );
 		insertSiblingPanel->update ( NULL, wxEmptyString );
 		locationPanel->update();
+		outlinePanel->update();
 		manager.Update();
 	}
 
@@ -1433,7 +1470,7 @@ void MyFrame::OnPageClosing ( wxAuiNotebookEvent& event ) //wxNotebookEvent& eve
 	statusProgress ( wxEmptyString );
 	closePane();
 
-	if ( doc->GetModify() ) //CanUndo())
+	if ( !doc->isPlaceholder() && doc->isModified() ) //CanUndo())
 	{
 		int selection;
 		wxString fileName;
@@ -1474,12 +1511,14 @@ void MyFrame::OnCloseAll ( wxCommandEvent& WXUNUSED ( event ) )
 	if ( !mainBook )
 		return;
 	openTabsOnClose = wxEmptyString;
+	openTabsState = wxEmptyString;
 
-	// retain tab order
+	// retain tab order, along with each tab's caret position, when it
+	// was last used and whether it was windowed ("caret,stamp,large|")
 	if ( rememberOpenTabs && !openFileSet.empty() )
 	{
 		XmlDoc *doc;
-		wxString fullPath;
+		wxString fullPath, state;
 		size_t maxTabs = mainBook->GetPageCount();
 		for ( size_t i = 0; i < maxTabs; ++i )
 		{
@@ -1491,6 +1530,11 @@ void MyFrame::OnCloseAll ( wxCommandEvent& WXUNUSED ( event ) )
 				{
 					openTabsOnClose.Append ( fullPath );
 					openTabsOnClose.Append ( _T ( "|" ) );
+					state.Printf ( _T ( "%i,%lu,%i|" ),
+					               doc->getCaret(),
+					               doc->getLastActivated(),
+					               ( doc->isLargeFile() ) ? 1 : 0 );
+					openTabsState.Append ( state );
 				}
 			}
 		}
@@ -1620,48 +1664,64 @@ void MyFrame::OnIdle ( wxIdleEvent& event )
     }
     */
 
-	// update attributes hidden field even if no document loaded
-	wxString currentHiddenStatus = status->GetStatusText ( STATUS_HIDDEN );
-	if ( visibilityState == HIDE_ATTRIBUTES )
-	{
-		if ( currentHiddenStatus != _ ( "Attributes hidden" ) )
-			status->SetStatusText (
-			    _ ( "Attributes hidden" ),
-			    STATUS_HIDDEN );
-	}
-	else if ( visibilityState == HIDE_TAGS )
-	{
-		if ( currentHiddenStatus != _ ( "Tags hidden" ) )
-			status->SetStatusText (
-			    _ ( "Tags hidden" ),
-			    STATUS_HIDDEN );
-	}
-	else
+	XmlDoc *doc = getActiveDocument();
+	if ( doc && restoreFocusToNotebook )
 	{
-		if ( !currentHiddenStatus.empty() )
-			status->SetStatusText ( wxEmptyString, STATUS_HIDDEN );
+		doc->SetFocus();
+		restoreFocusToNotebook = false;
 	}
 
-	// update protected field even if no document loaded
-	wxString currentProtectedStatus = status->GetStatusText ( STATUS_PROTECTED );
-	if ( protectTags )
-	{
-		if ( currentProtectedStatus != _ ( "Tags locked" ) )
-			status->SetStatusText (
-			    _ ( "Tags locked" ),
-			    STATUS_PROTECTED );
-	}
-	else
+	// nothing is looked at again unless something asked for it; a page
+	// can go without an event saying so, hence the check on lastDoc
+	if ( doc != lastDoc )
+		pendingUpdates |= UPDATE_DOCUMENT;
+	if ( !pendingUpdates )
+		return;
+	int updates = pendingUpdates;
+	pendingUpdates = 0;
+
+	if ( updates & UPDATE_STATUS )
 	{
-		if ( !currentProtectedStatus.empty() )
-			status->SetStatusText ( wxEmptyString, STATUS_PROTECTED );
+		// update attributes hidden field even if no document loaded
+		wxString currentHiddenStatus = status->GetStatusText ( STATUS_HIDDEN );
+		if ( visibilityState == HIDE_ATTRIBUTES )
+		{
+			if ( currentHiddenStatus != _ ( "Attributes hidden" ) )
+				status->SetStatusText (
+				    _ ( "Attributes hidden" ),
+				    STATUS_HIDDEN );
+		}
+		else if ( visibilityState == HIDE_TAGS )
+		{
+			if ( currentHiddenStatus != _ ( "Tags hidden" ) )
+				status->SetStatusText (
+				    _ ( "Tags hidden" ),
+				    STATUS_HIDDEN );
+		}
+		else
+		{
+			if ( !currentHiddenStatus.empty() )
+				status->SetStatusText ( wxEmptyString, STATUS_HIDDEN );
+		}
+
+		// update protected field even if no document loaded
+		wxString currentProtectedStatus = status->GetStatusText ( STATUS_PROTECTED );
+		if ( protectTags )
+		{
+			if ( currentProtectedStatus != _ ( "Tags locked" ) )
+				status->SetStatusText (
+				    _ ( "Tags locked" ),
+				    STATUS_PROTECTED );
+		}
+		else
+		{
+			if ( !currentProtectedStatus.empty() )
+				status->SetStatusText ( wxEmptyString, STATUS_PROTECTED );
+		}
 	}
 
 	// check if document loaded
-	wxString frameTitle = GetTitle();
-
-	XmlDoc *doc;
-	if ( ( doc = getActiveDocument() ) == NULL )
+	if ( doc == NULL )
 	{
 		if ( lastDoc != NULL )
 		{
@@ -1669,11 +1729,12 @@ void MyFrame::OnIdle ( wxIdleEvent& event )
 			status->SetStatusText ( wxEmptyString, STATUS_MODIFIED );
 			status->SetStatusText ( wxEmptyString, STATUS_POSITION );
 			locationPanel->update ( NULL, wxEmptyString );
+			outlinePanel->update();
 			insertChildPanel->update ( NULL, wxEmptyString );
 			insertSiblingPanel->update ( NULL, wxEmptyString );
 			insertEntityPanel->update ( NULL, wxEmptyString );
 			wxString minimal = _ ( "XML Copy Editor" );
-			if ( frameTitle != minimal )
+			if ( GetTitle() != minimal )
 				SetTitle ( minimal );
 
 			closeFindReplacePane();
@@ -1684,78 +1745,101 @@ void MyFrame::OnIdle ( wxIdleEvent& event )
 		return;
 	}
 
-	if ( restoreFocusToNotebook )
-	{
-		doc->SetFocus();
-		restoreFocusToNotebook = false;
-	}
+	if ( !mainBook )
+		return;
 
-	wxString docTitle;
-	if ( doc->getFullFileName().empty() || !showFullPathOnFrame )
-		docTitle = doc->getShortFileName();
-	else
-		docTitle = doc->getFullFileName();
+	if ( updates & ( UPDATE_DOCUMENT | UPDATE_MODIFIED ) )
+	{
+		wxString docTitle;
+		if ( doc->getFullFileName().empty() || !showFullPathOnFrame )
+			docTitle = doc->getShortFileName();
+		else
+			docTitle = doc->getFullFileName();
 
-	docTitle += _T ( " - " );
-	docTitle += _ ( "XML Copy Editor" );
+		docTitle += _T ( " - " );
+		docTitle += _ ( "XML Copy Editor" );
 
-	if ( frameTitle != docTitle )
-		SetTitle ( docTitle );
+		if ( GetTitle() != docTitle )
+			SetTitle ( docTitle );
 
-    // update modified field
-	if ( !mainBook )
-		return;
-	int index = mainBook->GetSelection();
+		// update modified field
+		int index = mainBook->GetSelection();
 
-	wxString currentModifiedStatus = status->GetStatusText ( STATUS_MODIFIED );
-	wxString currentTabLabel = mainBook->GetPageText ( index );
-	if ( doc->GetModify() )
-	{
-		if ( currentModifiedStatus != _ ( "Modified" ) )
+		wxString currentModifiedStatus = status->GetStatusText ( STATUS_MODIFIED );
+		wxString currentTabLabel = mainBook->GetPageText ( index );
+		if ( doc->isModified() )
 		{
-			status->SetStatusText ( _ ( "Modified" ), STATUS_MODIFIED );
-
-			if ( ! ( currentTabLabel.Mid ( 0, 1 ) == _T ( "*" ) ) )
+			if ( currentModifiedStatus != _ ( "Modified" ) )
 			{
-				currentTabLabel.Prepend ( _T ( "*" ) );
-				mainBook->SetPageText ( index, currentTabLabel );
+				status->SetStatusText ( _ ( "Modified" ), STATUS_MODIFIED );
+
+				if ( ! ( currentTabLabel.Mid ( 0, 1 ) == _T ( "*" ) ) )
+				{
+					currentTabLabel.Prepend ( _T ( "*" ) );
+					mainBook->SetPageText ( index, currentTabLabel );
+				}
 			}
 		}
-	}
-	else
-	{
-		if ( !currentModifiedStatus.empty() )
+		else
 		{
-			status->SetStatusText ( _T ( "" ), STATUS_MODIFIED );
-
-			if ( currentTabLabel.Mid ( 0, 1 ) == _T ( "*" ) )
+			if ( !currentModifiedStatus.empty() )
 			{
-				currentTabLabel.Remove ( 0, 1 );
-				mainBook->SetPageText ( index, currentTabLabel );
+				status->SetStatusText ( _T ( "" ), STATUS_MODIFIED );
+
+				if ( currentTabLabel.Mid ( 0, 1 ) == _T ( "*" ) )
+				{
+					currentTabLabel.Remove ( 0, 1 );
+					mainBook->SetPageText ( index, currentTabLabel );
+				}
 			}
 		}
 	}
 
-	// update coordinates field
-	std::pair<int, int> myControlCoordinates;
-	int current = doc->GetCurrentPos();
-	myControlCoordinates.first = doc->LineFromPosition ( current ) + 1;
-	myControlCoordinates.second = doc->GetColumn ( current ) + 1;
+	if ( updates & ( UPDATE_DOCUMENT | UPDATE_CARET ) )
+	{
+		// update coordinates field
+		std::pair<int, int> myControlCoordinates;
+		int current = doc->GetCurrentPos();
+		myControlCoordinates.first =
+		    doc->LineFromPosition ( current ) + ( int ) doc->getWindowLine() + 1;
+		myControlCoordinates.second = doc->GetColumn ( current ) + 1;
+
+		if ( myControlCoordinates != controlCoordinates )
+		{
+			wxString coordinates;
+			coordinates.Printf (
+			    _ ( "Ln %i Col %i" ),
+			    myControlCoordinates.first,
+			    myControlCoordinates.second );
+			GetStatusBar()->SetStatusText ( coordinates, STATUS_POSITION );
+			controlCoordinates = myControlCoordinates;
+		}
+	}
 
-	if ( myControlCoordinates != controlCoordinates )
+	// the panes are brought up to date at most once every
+	// PANE_UPDATE_INTERVAL milliseconds; requests in between wait for the
+	// timer, so that typing or scrolling does not refresh them each time
+	if ( !( updates & ( UPDATE_DOCUMENT | UPDATE_CARET | UPDATE_PROMPT_MAPS | UPDATE_PANES ) ) )
+		return;
+	long sinceLast = paneUpdateWatch.Time();
+	if ( !( updates & UPDATE_DOCUMENT ) && sinceLast < PANE_UPDATE_INTERVAL )
 	{
-		wxString coordinates;
-		coordinates.Printf (
-		    _ ( "Ln %i Col %i" ),
-		    myControlCoordinates.first,
-		    myControlCoordinates.second );
-		GetStatusBar()->SetStatusText ( coordinates, STATUS_POSITION );
-		controlCoordinates = myControlCoordinates;
+		deferredUpdates |= UPDATE_PANES | ( updates & UPDATE_PROMPT_MAPS );
+		if ( !updateTimer.IsRunning() )
+			updateTimer.Start ( PANE_UPDATE_INTERVAL - sinceLast, wxTIMER_ONE_SHOT );
+		return;
 	}
+	paneUpdateWatch.Start();
+	bool promptMapsChanged = ( updates & UPDATE_PROMPT_MAPS ) != 0;
+
+	// bring the outline up to date with any edits
+	if ( manager.GetPane ( outlinePanel ).IsShown() )
+		outlinePanel->update ( doc );
 
 	// update parent element field
 	wxString parent, grandparent;
-	if ( current == lastPos && doc == lastDoc )
+	int current = doc->GetCurrentPos();
+	if ( current == lastPos && doc == lastDoc && !promptMapsChanged )
 		return;
 
 	lastPos = current;
@@ -1782,34 +1866,36 @@ void MyFrame::OnIdle ( wxIdleEvent& event )
 	}
 
 
-	if ( parent == lastParent )
+	if ( parent == lastParent && !promptMapsChanged )
 		return;
 	lastParent = parent;
 
-	bool mustUpdate = false;
+	if ( promptMapsChanged )
+	{
+		// the lists come from the prompt maps, so they are filled afresh
+		insertChildPanel->update ( NULL );
+		insertSiblingPanel->update ( NULL );
+		insertEntityPanel->update ( NULL );
+	}
+
+	// the panes lay themselves out if they need to; the frame's layout
+	// does not change
 	if ( locationPanel && insertChildPanel && insertEntityPanel )
 	{
 		locationPanel->update ( doc, parent );
 		insertChildPanel->update ( doc, parent );
 		insertEntityPanel->update ( doc );
-		mustUpdate = true;
 	}
 
 	if ( parent.empty() )
 	{
 		if ( insertSiblingPanel )
 			insertSiblingPanel->update ( doc, wxEmptyString );
-		if ( mustUpdate )
-			manager.Update();
 		return;
 	}
 
 	if ( !manager.GetPane ( insertSiblingPanel ).IsShown() )
-	{
-		if ( mustUpdate )
-			manager.Update();
 		return;
-	}
 
 	// try to fetch grandparent if necessary/possible
 	if ( !parent.empty() && parentCloseAngleBracket != -1 )
@@ -1822,15 +1908,33 @@ void MyFrame::OnIdle ( wxIdleEvent& event )
 
 		if ( insertSiblingPanel )
 			insertSiblingPanel->update ( doc, parent, grandparent );
-		if ( grandparent != lastGrandparent )
-		{
-			mustUpdate = true;
-			lastGrandparent = grandparent;
-		}
-
 	}
-	if ( mustUpdate )
-		manager.Update();
+}
+
+void MyFrame::requestUpdate ( int updates )
+{
+	if ( !pendingUpdates )
+		wxWakeUpIdle();
+	pendingUpdates |= updates;
+}
+
+void MyFrame::OnUpdateTimer ( wxTimerEvent& event )
+{
+	requestUpdate ( deferredUpdates );
+	deferredUpdates = 0;
+}
+
+void MyFrame::OnDocumentUpdateUI ( wxStyledTextEvent& event )
+{
+	event.Skip();
+	if ( event.GetEventObject() == ( wxObject * ) getActiveDocument() )
+		requestUpdate ( UPDATE_CARET );
+}
+
+void MyFrame::OnDocumentSavePoint ( wxStyledTextEvent& event )
+{
+	event.Skip();
+	requestUpdate ( UPDATE_MODIFIED );
 }
 
 void MyFrame::OnInsertChild ( wxCommandEvent& event )
@@ -2220,9 +2324,8 @@ void MyFrame::OnExport ( wxCommandEvent& event )
     exportDoc = ed->getDoc();
     exportFullDaisy = ed->getFullDaisy();
 
-	std::string rawBufferUtf8;
-	getRawText ( doc, rawBufferUtf8 );
-	if ( !XmlEncodingHandler::setUtf8 ( rawBufferUtf8 ) )
+	XmlTextView text ( doc );
+	if ( !text.setUtf8() )
 	{
 		encodingMessage();
 		return;
@@ -2233,7 +2336,7 @@ void MyFrame::OnExport ( wxCommandEvent& event )
 	ofstream rawBufferStream ( tempFileName.name().c_str() );
 	if ( !rawBufferStream )
 		return;
-	rawBufferStream << rawBufferUtf8;
+	text.write ( rawBufferStream );
 	rawBufferStream.close();
 
     wxString tempFile= tempFileName.wideName();
@@ -2374,9 +2477,7 @@ void MyFrame::OnExportMSWord ( wxCommandEvent& event )
 		if ( !ofs )
 			return;
 
-		std::string utf8Buffer;
-		getRawText ( doc, utf8Buffer );
-		ofs << utf8Buffer;
+		XmlTextView ( doc ).write ( ofs );
 		ofs.close();
 	}
 	else if ( doc->GetModify() ) //CanUndo())
@@ -2455,9 +2556,7 @@ void MyFrame::OnBrowser ( wxCommandEvent& WXUNUSED ( event ) )
 			return;
 		}
 
-		std::string utf8Buffer;
-		getRawText ( doc, utf8Buffer );
-		ofs << utf8Buffer;
+		XmlTextView ( doc ).write ( ofs );
 		ofs.close();
 
 		// keep files until application closes
@@ -2645,6 +2744,7 @@ void MyFrame::OnOptions ( wxCommandEvent& WXUNUSED ( event ) )
 		showFullPathOnFrame = mpsd->getShowFullPathOnFrame();
 		lang = mpsd->getLang();
 		updatePaths();
+		requestUpdate ( UPDATE_ALL );
 	}
 	if ( doc )
 		doc->SetFocus();
@@ -2682,7 +2782,7 @@ void MyFrame::OnGoto ( wxCommandEvent& WXUNUSED ( event ) )
 		return;
 	}
 	--line;
-	doc->GotoLine ( ( int ) line );
+	doc->gotoLine ( ( size_t ) line );
 	doc->SetFocus();
 }
 
@@ -2800,7 +2900,7 @@ void MyFrame::OnGlobalReplace ( wxCommandEvent& event )
 			                        findUtf8,
 			                        replaceUtf8,
 			                        flags & wxFR_MATCHCASE );
-			currentDoc->SetTextRaw ( bufferUtf8.c_str() );
+			currentDoc->replaceTextRaw ( bufferUtf8 );
 			currentDoc->setValidationRequired ( true );
 		}
 		else
@@ -2815,7 +2915,7 @@ void MyFrame::OnGlobalReplace ( wxCommandEvent& event )
 				int matchCount;
 				std::string outputBuffer = wr->replaceGlobal ( bufferUtf8, &matchCount );
 				globalMatchCount += matchCount;
-				currentDoc->SetTextRaw ( outputBuffer.c_str() );
+				currentDoc->replaceTextRaw ( outputBuffer );
 				currentDoc->setValidationRequired ( true );
 			}
 			catch ( std::exception& e )
@@ -3008,12 +3108,97 @@ void MyFrame::OnOpen ( wxCommandEvent& event )
 	size_t count = paths.Count();
 	if ( !count )
 		return;
-	for ( size_t i = 0; i < count; ++i )
-		if ( !openFile ( paths[i], largeFile ) )
-			break;
+	openFiles ( paths, largeFile );
 }
 
+// the number of files loaded at the same time
+static const int MAX_OPEN_FILE_THREADS = 4;
+// remembered tabs loaded in the background at startup
+static const size_t MAX_PREFETCH_TABS = 3;
+
+// Shows a progress dialog if loading a document on the main thread
+// takes more than half a second
+class OpenFileMonitor : public FileLoadMonitor
+{
+	public:
+		OpenFileMonitor ( const wxString &fileNameParameter )
+			: fileName ( fileNameParameter )
+		{
+		}
+		virtual bool progress ( int percent )
+		{
+			if ( !pd.get() )
+			{
+				if ( stopWatch.Time() < 500 )
+					return true;
+				pd.reset ( new wxProgressDialog (
+				               _ ( "Opening file" ),
+				               fileName,
+				               100,
+				               NULL,
+				               wxPD_SMOOTH | wxPD_CAN_ABORT | wxPD_APP_MODAL | wxPD_AUTO_HIDE ) );
+			}
+			return pd->Update ( ( percent < 100 ) ? percent : 99 );
+		}
+	private:
+		wxString fileName;
+		wxStopWatch stopWatch;
+		std::auto_ptr<wxProgressDialog> pd;
+};
+
 bool MyFrame::openFile ( wxString& fileName, bool largeFile )
+{
+	if ( !canOpenFile ( fileName ) )
+		return false;
+
+	return loadFile ( fileName, largeFile );
+}
+
+// Loads the file on this thread, with a progress dialog if it is slow
+bool MyFrame::loadFile ( const wxString& fileName, bool largeFile )
+{
+	statusProgress ( _T ( "Opening file..." ) );
+	std::auto_ptr<FileLoader> loader ( createFileLoader ( fileName, largeFile ) );
+	OpenFileMonitor monitor ( fileName );
+	if ( !loader->load ( &monitor ) )
+	{
+		if ( loader->isCancelled() )
+		{
+			wxString message;
+			message.Printf ( _ ( "Opening %s cancelled" ), fileName.c_str() );
+			statusProgress ( message );
+			return false;
+		}
+		messagePane ( loader->getLastError(), CONST_STOP );
+		statusProgress ( wxEmptyString );
+		return false;
+	}
+	statusProgress ( wxEmptyString );
+
+	return showLoadedFile ( *loader );
+}
+
+// Loads the files on worker threads; each file is shown as soon as it
+// and the files requested before it have been loaded
+void MyFrame::openFiles ( const wxArrayString& fileNames, bool largeFile )
+{
+	size_t count = fileNames.GetCount();
+	for ( size_t i = 0; i < count; ++i )
+	{
+		wxString fileName = fileNames[i];
+		if ( !canOpenFile ( fileName ) )
+			continue;
+
+		fileLoads.push_back ( new OpenFileThread (
+		                          this,
+		                          createFileLoader ( fileName, largeFile ) ) );
+		++fileLoadCount;
+	}
+	startFileLoads();
+}
+
+// Checks a file that is about to be opened
+bool MyFrame::canOpenFile ( wxString& fileName )
 {
 #ifndef __WXMSW__
 	// truncate string up to file:/ portion added by GNOME
@@ -3042,6 +3227,28 @@ bool MyFrame::openFile ( wxString& fileName, bool largeFile )
 		return false;
 	}
 
+	std::deque<OpenFileThread *>::iterator it;
+	for ( it = fileLoads.begin(); it != fileLoads.end(); ++it )
+		if ( ( *it )->getLoader().getFileName() == fileName )
+			return false; // still loading
+
+	return true;
+}
+
+FileLoader *MyFrame::createFileLoader ( const wxString& fileName, bool largeFile )
+{
+	return new FileLoader (
+	           fileName,
+	           getAuxPath ( fileName ),
+	           getFileType ( fileName ),
+	           largeFile,
+	           properties.completion || properties.validateAsYouType );
+}
+
+// Creates the view for a document that has been loaded
+bool MyFrame::showLoadedFile ( FileLoader& loader )
+{
+	wxString fileName = loader.getFileName();
 	wxString directory, name, extension;
 	wxFileName::SplitPath ( fileName, NULL, &directory, &name, &extension );
 
@@ -3051,208 +3258,21 @@ bool MyFrame::openFile ( wxString& fileName, bool largeFile )
 		name += extension;
 	}
 
-	wxString wideError;
-	std::string buffer;
 	pair<int, int> posPair;
 	XmlDoc *doc;
 
-	int type = getFileType ( fileName );
-	wxString auxPath = getAuxPath ( fileName );
-
-	char *docBuffer = NULL;
-	size_t docBufferLen = 0;
-	bool fileEmpty = false;
-
-	statusProgress ( _T ( "Opening file..." ) );
-	BinaryFile binaryfile ( fileName );
-	if ( !binaryfile.getData() )
-	{
-		wxString message;
-		message.Printf ( _ ( "Cannot open %s" ), fileName.c_str() );
-		messagePane ( message, CONST_STOP );
-		statusProgress ( wxEmptyString );
-		return false;
-	}
-	/*
-	//wxMemoryMappedFile memorymap (
-	  fileName,
-	  true, // readOnly
-	  true // fread
-	);
-	*/
-
-	/*
-	  catch (wxMemoryMappedFileEmptyException&)
-	  {
-	    fileEmpty = true;
-	  }
-	*/
-
-	bool isUtf8 = false;
+	int type = loader.getType();
+	bool largeFile = loader.isLargeFile();
 
-	if ( !fileEmpty )
-	{
-		docBuffer = ( char * ) binaryfile.getData();//memorymap->GetStream();
-		docBufferLen = binaryfile.getDataLen();//memorymap->GetMapSize();
-	}
-	else
-	{
-		docBuffer = NULL;
-		docBufferLen = 0;
-		isUtf8 = true;
-	}
-
-	statusProgress ( wxEmptyString );
-
-	wxCharBuffer iconvBuffer;
-	size_t iconvBufferLen = 0;
-
-	char *finalBuffer;
-	size_t finalBufferLen;
-
-	std::string encoding;
-	if ( largeFile )
-	{
-		encoding = "UTF-8";
-	}
-	else if ( docBufferLen >= 4 && // UTF-32 BE
-			( unsigned char ) docBuffer[0] == 0x00 &&
-			( unsigned char ) docBuffer[1] == 0x00 &&
-			( unsigned char ) docBuffer[2] == 0xFE &&
-			( unsigned char ) docBuffer[3] == 0xFF )
-	{
-		docBuffer += 4;
-		docBufferLen -= 4;
-		encoding = "UTF-32BE";
-	}
-	else if ( docBufferLen >= 4 && // UTF-32 LE
-			( unsigned char ) docBuffer[0] == 0xFF &&
-			( unsigned char ) docBuffer[1] == 0xFE &&
-			( unsigned char ) docBuffer[2] == 0x00 &&
-			( unsigned char ) docBuffer[3] == 0x00 )
-	{
-		docBuffer += 4;
-		docBufferLen -= 4;
-		encoding = "UTF-32LE";
-	}
-	else if ( docBufferLen >= 2 && //UTF-16 BE
-			( unsigned char ) docBuffer[0] == 0xFE &&
-			( unsigned char ) docBuffer[1] == 0xFF )
-	{
-		docBuffer += 2;
-		docBufferLen -= 2;
-		encoding = "UTF-16BE";
-	}
-	else if ( docBufferLen >= 2 && //UTF-16 LE
-			( unsigned char ) docBuffer[0] == 0xFF &&
-			( unsigned char ) docBuffer[1] == 0xFE )
-	{
-		docBuffer += 2;
-		docBufferLen -= 2;
-		encoding = "UTF-16LE";
-	}
-	else if ( docBufferLen >= 3 && //UTF-8
-			( unsigned char ) docBuffer[0] == 0xEF &&
-			( unsigned char ) docBuffer[1] == 0xBB &&
-			( unsigned char ) docBuffer[2] == 0xBF )
-	{
-		docBuffer += 3;
-		docBufferLen -= 3;
-		encoding = "UTF-8";
-	}
-
-	if ( encoding.empty() )
-	{
-		XmlEncodingSpy es;
-		es.parse ( docBuffer, docBufferLen );
-		encoding = es.getEncoding();
-		if ( encoding.empty() )  // Expat couldn't parse file (e.g. UTF-32)
-			encoding = getApproximateEncoding ( docBuffer, docBufferLen );
-	}
-
-	// convert buffer if not UTF-8
-	if ( encoding == "UTF-8" ||
-		encoding == "utf-8" ||
-		encoding == "US-ASCII" ||
-		encoding == "us-ascii" || // US-ASCII is a subset of UTF-8
-		docBufferLen == 0 )
+	statusProgress ( _ ( "Creating document view..." ) );
+	if ( ( doc = getPlaceholder ( fileName ) ) != NULL )
 	{
-		finalBuffer = docBuffer;
-		finalBufferLen = docBufferLen;
-		isUtf8 = true;
+		doc->loadPlaceholder ( loader.getBuffer(), loader.getBufferLen() );
+		doc->setCompressed ( loader.isCompressed() );
+		if ( largeFile )
+			doc->setLargeFile ( loader.releaseFile(), loader.getIndex() );
 	}
 	else
-	{
-		wxString wideEncoding = wxString (
-		                            encoding.c_str(),
-		                            wxConvLocal,
-		                            encoding.size() );
-		iconv_t cd = iconv_open ( "UTF-8", encoding.c_str() );
-		if ( cd == ( iconv_t )-1 )
-		{
-			wxString message;
-			message.Printf ( _ ( "Cannot open %s: unknown encoding %s" ),
-			                 fileName.c_str(),
-			                 wideEncoding.c_str() );
-			messagePane ( message, CONST_STOP );
-			return false;
-		};
-
-		int iconvLenMultiplier = 4; // worst case scenario
-		if ( encoding == "ISO-8859-1" ||
-		        encoding == "UTF-16" ||
-		        encoding == "UTF-16BE" ||
-		        encoding == "UTF-16LE" )
-		{
-			iconvLenMultiplier = 2;
-		}
-		else if ( encoding == "UTF-32" ||
-		          encoding == "UTF-32BE" ||
-		          encoding == "UTF-32LE" )
-		{
-			iconvLenMultiplier = 1;
-		}
-
-		size_t nconv;
-		char *buffer;
-		size_t iconvBufferLeft, docBufferLeft;
-		iconvBufferLen = iconvBufferLeft = docBufferLen * iconvLenMultiplier + 1;
-		docBufferLeft = docBufferLen;
-		if ( ( ( ( size_t ) -1 ) - 1 ) / iconvLenMultiplier < docBufferLen
-			|| !iconvBuffer.extend ( iconvBufferLen ) )
-		{
-			wxString message;
-			message.Printf ( _ ( "Cannot open %s: out of memory" ),
-					fileName.c_str() );
-			messagePane ( message, CONST_STOP );
-			statusProgress ( wxEmptyString );
-			return false;
-		}
-		finalBuffer = buffer = iconvBuffer.data(); // buffer will be incremented by iconv
-		nconv = reinterpret_cast < universal_iconv & > ( iconv ) (
-		            cd,
-		            &docBuffer,
-		            &docBufferLeft,
-		            &buffer,
-		            &iconvBufferLeft );
-
-		*buffer = '\0';
-
-		iconv_close ( cd );
-
-		if ( nconv == ( size_t )-1 )
-		{
-			wxString message;
-			message.Printf ( _ ( "Cannot open %s: conversion from encoding %s failed" ),
-			                 fileName.c_str(),
-			                 wideEncoding.c_str() );
-			messagePane ( message, CONST_STOP );
-			return false;
-		}
-		finalBufferLen = iconvBufferLen - iconvBufferLeft;
-	}
-
-	statusProgress ( _ ( "Creating document view..." ) );
 	{
 		wxWindowUpdateLocker noupdate ( this );
 
@@ -3261,12 +3281,14 @@ bool MyFrame::openFile ( wxString& fileName, bool largeFile )
 			( largeFile ) ? largeFileProperties: properties,
 			&protectTags,
 			visibilityState,
-			( !binaryfile.getDataLen() ) ? FILE_TYPE_XML : type,
+			( loader.isEmpty() ) ? FILE_TYPE_XML : type,
 			wxID_ANY,
-			finalBuffer,
-			finalBufferLen,
+			loader.getBuffer(),
+			loader.getBufferLen(),
 			fileName,
-			auxPath );
+			loader.getAuxPath() );
+		if ( largeFile )
+			doc->setLargeFile ( loader.releaseFile(), loader.getIndex() );
 #ifdef __WXMSW__
 		doc->SetUndoCollection ( false );
 		doc->SetUndoCollection ( true );
@@ -3280,73 +3302,55 @@ bool MyFrame::openFile ( wxString& fileName, bool largeFile )
 		updateFileMenu();
 		wxFileName ofn ( fileName );
 		doc->setLastModified ( ofn.GetModificationTime() );
+		doc->setCompressed ( loader.isCompressed() );
 
 		mainBook->AddPage ( ( wxWindow * ) doc, name, _T ( "" ) );
 	}
+	// converted text comes in blocks, each freed as soon as the view has
+	// it, so that the document is never held twice over
+	while ( loader.nextBuffer() )
+		doc->appendBuffer ( loader.getBuffer(), loader.getBufferLen() );
+	if ( doc->isPlaceholder() )
+		doc->endPlaceholder();
 	statusProgress ( wxEmptyString );
 
 	mainBook->Layout();
 
 	wxFileName fn ( fileName );
 	doc->setLastModified ( fn.GetModificationTime() );
-	doc->SetFocus();
+	if ( doc == getActiveDocument() ) // not so for prefetched tabs
+		doc->SetFocus();
 
-	if ( type != FILE_TYPE_XML || !binaryfile.getDataLen() )
+	if ( type != FILE_TYPE_XML || largeFile || loader.isEmpty() )
 	{
 		return true;
 	}
 
-	// NOW parse the document, but don't create a UTF-8 copy
-	statusProgress ( _T ( "Parsing document..." ) );
-	std::auto_ptr<WrapExpat> we ( new WrapExpat() );
-
-	// omit XML declaration
-	if ( !isUtf8 && finalBufferLen > 5 &&
-	        finalBuffer[0] == '<' &&
-	        finalBuffer[1] == '?' &&
-	        finalBuffer[2] == 'x' &&
-	        finalBuffer[3] == 'm' &&
-	        finalBuffer[4] == 'l' )
-	{
-		for ( ; *finalBuffer && finalBufferLen; finalBuffer++ && finalBufferLen-- )
-		{
-			if ( *finalBuffer == '>' )
-			{
-				finalBuffer++;
-				finalBufferLen--;
-				break;
-			}
-		}
-	}
-
-	bool optimisedParseSuccess = false;
-	if ( finalBuffer )
+	// the loader has parsed the document already; the prompt maps are
+	// built from what it found on a worker thread
+	if ( loader.getPromptGenerator() )
 	{
-		optimisedParseSuccess = we->parse ( finalBuffer, finalBufferLen );
-		statusProgress ( wxEmptyString );
+		doc->updatePromptMaps ( loader.releasePromptGenerator() );
 	}
-
-	// NOW update prompt maps if necessary
-	if ( !largeFile && ( properties.completion || properties.validateAsYouType ) )
+	else if ( loader.getIndex() && loader.getIndex()->hasPromptMaps )
 	{
-		statusProgress ( _T ( "Compiling autocompletion lists..." ) );
-		doc->updatePromptMaps ( finalBuffer, finalBufferLen );
-		statusProgress ( wxEmptyString );
+		doc->updatePromptMaps ( *loader.getIndex() );
 	}
 
-	if ( !largeFile && ( properties.validateAsYouType && doc->getGrammarFound() ) )
+	if ( properties.validateAsYouType && doc->getGrammarFound() )
 	{
 		statusProgress ( _T ( "Validating document..." ) );
-		//doc->backgroundValidate ( finalBuffer, doc->getFullFileName().mb_str(wxConvUTF8), finalBufferLen );
+		// the snapshot taken here is shared by later validations
 		doc->backgroundValidate();
 		statusProgress ( wxEmptyString );
 	}
 
-	if ( !optimisedParseSuccess )
+	if ( !loader.isWellFormed() )
 	{
-		posPair = we->getErrorPosition();
+		WrapExpat &we = loader.getParser();
+		posPair = we.getErrorPosition();
 		-- ( posPair.first );
-		messagePane ( we->getLastError(), CONST_WARNING );
+		messagePane ( we.getLastError(), CONST_WARNING );
 
 		int newPosition = doc->PositionFromLine ( posPair.first );
 		doc->SetSelection ( newPosition, newPosition );
@@ -3360,29 +3364,183 @@ bool MyFrame::openFile ( wxString& fileName, bool largeFile )
 	return true;
 }
 
-std::string MyFrame::getApproximateEncoding ( char *docBuffer,
-        size_t docBufferLen )
+void MyFrame::startFileLoads()
+{
+	int maxThreads = wxThread::GetCPUCount();
+	if ( maxThreads < 1 )
+		maxThreads = 1;
+	else if ( maxThreads > MAX_OPEN_FILE_THREADS )
+		maxThreads = MAX_OPEN_FILE_THREADS;
+
+	int running = 0;
+	std::deque<OpenFileThread *>::iterator it;
+	for ( it = fileLoads.begin(); it != fileLoads.end(); ++it )
+		if ( ( *it )->isStarted() && ! ( *it )->isFinished() )
+			++running;
+
+	for ( it = fileLoads.begin(); it != fileLoads.end() && running < maxThreads; ++it )
+	{
+		OpenFileThread *thread = *it;
+		if ( thread->isStarted() )
+			continue;
+		thread->setStarted();
+		if ( thread->Create() == wxTHREAD_NO_ERROR
+		        && thread->Run() == wxTHREAD_NO_ERROR )
+		{
+			++running;
+			continue;
+		}
+		// no thread to be had: load the file here instead
+		thread->getLoader().load();
+		thread->setFinished();
+	}
+
+	showLoadedFiles();
+	updateFileLoadProgress();
+}
+
+// Tabs are added in the order in which the files were requested
+void MyFrame::showLoadedFiles()
 {
-	std::string line, encoding;
-	char *it;
-	size_t i;
+	while ( !fileLoads.empty() && fileLoads.front()->isFinished() )
+	{
+		OpenFileThread *thread = fileLoads.front();
+		fileLoads.pop_front();
+		++fileLoadsDone;
+
+		FileLoader &loader = thread->getLoader();
+		if ( loader.isLoaded() )
+		{
+			// a placeholder may have been loaded or closed meanwhile
+			if ( thread->isPrefetch() ?
+			        getPlaceholder ( loader.getFileName() ) != NULL :
+			        !isOpen ( loader.getFileName() ) )
+				showLoadedFile ( loader );
+		}
+		else if ( !loader.isCancelled() )
+		{
+			messagePane ( loader.getLastError(), CONST_STOP );
+		}
+		delete thread;
+	}
+}
 
-	// grab first line
-	for (
-	    i = 0, it = docBuffer;
-	    i < docBufferLen && *it != '\n' && i < BUFSIZ;
-	    i++, it++ )
+void MyFrame::updateFileLoadProgress()
+{
+	if ( fileLoads.empty() )
 	{
-		if ( *it )
-			line += *it;
+		fileLoadProgress.reset();
+		fileLoadCount = fileLoadsDone = 0;
+		return;
 	}
+	if ( fileLoadProgressBusy ) // wxProgressDialog::Update() yields
+		return;
+
+	// only files that take a while to load report their progress
+	bool slow = false;
+	int total = fileLoadsDone * 100;
+	wxString message;
+	std::deque<OpenFileThread *>::iterator it;
+	for ( it = fileLoads.begin(); it != fileLoads.end(); ++it )
+	{
+		OpenFileThread *thread = *it;
+		if ( thread->isFinished() )
+		{
+			total += 100;
+			continue;
+		}
+		if ( !thread->isStarted() )
+			continue;
 
-	std::pair<int, int> limits = XmlEncodingHandler::getEncodingValueLimits ( line );
+		total += thread->getPercent();
+		if ( thread->getPercent() )
+			slow = true;
 
-	if ( limits.first == -1 || limits.second == -1 )
-		return "";
+		wxFileName fn ( thread->getLoader().getFileName() );
+		if ( !message.empty() )
+			message += _T ( ", " );
+		message += wxString::Format (
+		               _T ( "%s (%i%%)" ),
+		               fn.GetFullName().c_str(),
+		               thread->getPercent() );
+	}
+
+	if ( !fileLoadProgress.get() )
+	{
+		if ( !slow )
+		{
+			statusProgress ( message );
+			return;
+		}
+		fileLoadProgress.reset ( new wxProgressDialog (
+		                             _ ( "Opening files" ),
+		                             message,
+		                             100,
+		                             NULL,
+		                             wxPD_SMOOTH | wxPD_CAN_ABORT | wxPD_AUTO_HIDE ) );
+	}
 
-	return line.substr ( limits.first, limits.second );
+	int percent = total / fileLoadCount;
+	fileLoadProgressBusy = true;
+	bool proceed = fileLoadProgress->Update ( ( percent < 100 ) ? percent : 99, message );
+	fileLoadProgressBusy = false;
+	if ( !proceed )
+	{
+		cancelFileLoads();
+		statusProgress ( _ ( "Opening files cancelled" ) );
+	}
+}
+
+void MyFrame::cancelFileLoads()
+{
+	std::vector<OpenFileThread *> running;
+	std::deque<OpenFileThread *>::iterator it;
+	{
+		wxCriticalSectionLocker locker ( xmlcopyeditorCriticalSection );
+
+		for ( it = fileLoads.begin(); it != fileLoads.end(); ++it )
+		{
+			if ( ( *it )->isStarted() && ! ( *it )->isFinished() )
+			{
+				( *it )->Cancel();
+				running.push_back ( *it );
+			}
+			else
+			{
+				delete *it;
+			}
+		}
+	}
+	fileLoads.clear();
+
+	// the threads stop at the next progress report
+	std::vector<OpenFileThread *>::iterator runningIt;
+	for ( runningIt = running.begin(); runningIt != running.end(); ++runningIt )
+		( *runningIt )->PendingDelete();
+
+	fileLoadProgress.reset();
+	fileLoadCount = fileLoadsDone = 0;
+}
+
+void MyFrame::OnOpenFileProgress ( wxCommandEvent& event )
+{
+	OpenFileThread *thread = ( OpenFileThread * ) event.GetClientData();
+	if ( std::find ( fileLoads.begin(), fileLoads.end(), thread ) == fileLoads.end() )
+		return; // cancelled
+
+	thread->setPercent ( event.GetInt() );
+	updateFileLoadProgress();
+}
+
+void MyFrame::OnOpenFileCompleted ( wxCommandEvent& event )
+{
+	OpenFileThread *thread = ( OpenFileThread * ) event.GetClientData();
+	if ( std::find ( fileLoads.begin(), fileLoads.end(), thread ) == fileLoads.end() )
+		return; // cancelled
+
+	thread->Wait();
+	thread->setFinished();
+	startFileLoads();
 }
 
 void MyFrame::OnToggleFold ( wxCommandEvent& WXUNUSED ( event ) )
@@ -3500,7 +3658,7 @@ void MyFrame::OnSpelling ( wxCommandEvent& event )
 		if ( bufferUtf8.empty() )
 			messagePane ( _ ( "Edited document empty" ), CONST_STOP );
 		else
-			doc->SetTextRaw ( bufferUtf8.c_str() );
+			doc->replaceTextRaw ( bufferUtf8 );
 	}
 	
 	// update presets if report has been created (even if followed by cancel)
@@ -3587,9 +3745,10 @@ void MyFrame::reloadTab()
 	if ( ( doc = getActiveDocument() ) == NULL )
 		return;
 	wxString fileName = doc->getFullFileName();
+	bool largeFile = doc->isLargeFile();
 
 	if ( closeActiveDocument() )
-		openFile ( fileName );
+		openFile ( fileName, largeFile );
 }
 
 void MyFrame::OnSaveAs ( wxCommandEvent& event )
@@ -3600,7 +3759,7 @@ void MyFrame::OnSaveAs ( wxCommandEvent& event )
 void MyFrame::saveAs()
 {
 	XmlDoc *doc;
-	if ( ( doc = getActiveDocument() ) == NULL )
+	if ( ( doc = getActiveDocument() ) == NULL || doc->isPlaceholder() )
 		return;
 
 	wxString defaultFile, defaultDir;
@@ -3651,6 +3810,7 @@ void MyFrame::saveAs()
 	doc->setFullFileName ( path );
 	doc->setShortFileName ( name );
 	doc->setDirectory ( directory );
+	requestUpdate ( UPDATE_DOCUMENT );
 
 	history.AddFileToHistory ( path ); // update history
 	updateFileMenu();
@@ -3696,6 +3856,14 @@ void MyFrame::OnUpdateLocationPaneVisible ( wxUpdateUIEvent& event )
 	event.Check ( info.IsShown() );
 }
 
+void MyFrame::OnUpdateOutlinePaneVisible ( wxUpdateUIEvent& event )
+{
+	if ( !viewMenu )
+		return;
+	wxAuiPaneInfo info = manager.GetPane ( outlinePanel );
+	event.Check ( info.IsShown() );
+}
+
 void MyFrame::OnUpdateSavedOnly ( wxUpdateUIEvent& event )
 {
 	XmlDoc *doc;
@@ -3823,12 +3991,10 @@ void MyFrame::OnValidateDTD ( wxCommandEvent& event )
 	WrapTempFileName wtfn ( fname );
 	if ( fname.empty() || doc->GetModify() )
 	{
-		wxString wideBuffer = doc->GetText();
-
-		std::string buffer = ( const char * ) wideBuffer.mb_str ( wxConvUTF8 );
+		XmlTextView text ( doc );
 		if ( !saveRawUtf8 (
 		            wtfn.name(),
-		            buffer ) )
+		            text ) )
 		{
 			messagePane (
 			    _ ( "Cannot save temporary copy for validation; please save or discard changes" ),
@@ -3919,12 +4085,10 @@ void MyFrame::validateRelaxNG (
 	WrapTempFileName wtfn ( fileName );
 	if ( fileName.empty() || doc->GetModify() )
 	{
-		wxString wideBuffer = doc->GetText();
-
-		std::string buffer = ( const char * ) wideBuffer.mb_str ( wxConvUTF8 );
+		XmlTextView text ( doc );
 		if ( !saveRawUtf8 (
 		            wtfn.name(),
-		            buffer ) )
+		            text ) )
 		{
 			messagePane (
 			    _ ( "Cannot save temporary copy for validation; please save or discard changes" ),
@@ -4016,12 +4180,10 @@ void MyFrame::OnValidateSchema ( wxCommandEvent& event )
 	WrapTempFileName wtfn ( fileName );
 	if ( fileName.empty() || doc->GetModify() )
 	{
-		wxString wideBuffer = doc->GetText();
-
-		std::string buffer = ( const char * ) wideBuffer.mb_str ( wxConvUTF8 );
+		XmlTextView text ( doc );
 		if ( !saveRawUtf8 (
 		            wtfn.name(),
-		            buffer ) )
+		            text ) )
 		{
 			messagePane (
 			    _ ( "Cannot save temporary copy for validation; please save or discard changes" ),
@@ -4107,9 +4269,8 @@ void MyFrame::OnXPath ( wxCommandEvent& event )
 	std::string valUtf8 = ( const char * ) xpathExpression.mb_str ( wxConvUTF8 );
 
 	// fetch document contents
-	std::string rawBufferUtf8;
-	getRawText ( doc, rawBufferUtf8 );
-	if ( !XmlEncodingHandler::setUtf8 ( rawBufferUtf8 ) )
+	XmlTextView text ( doc );
+	if ( !text.setUtf8() )
 	{
 		encodingMessage();
 		return;
@@ -4120,7 +4281,7 @@ void MyFrame::OnXPath ( wxCommandEvent& event )
 	ofstream rawBufferStream ( tempFileName.name().c_str() );
 	if ( !rawBufferStream )
 		return;
-	rawBufferStream << rawBufferUtf8;
+	text.write ( rawBufferStream );
 	rawBufferStream.close();
 
 	auto_ptr<WrapLibxml> wl ( new WrapLibxml ( libxmlNetAccess ) );
@@ -4160,9 +4321,8 @@ void MyFrame::OnXslt ( wxCommandEvent& event )
 	XmlDoc *doc;
 	if ( ( doc = getActiveDocument() ) == NULL )
 		return;
-	std::string rawBufferUtf8;
-	getRawText ( doc, rawBufferUtf8 );
-	if ( !XmlEncodingHandler::setUtf8 ( rawBufferUtf8 ) )
+	XmlTextView text ( doc );
+	if ( !text.setUtf8() )
 	{
 		encodingMessage();
 		return;
@@ -4173,7 +4333,7 @@ void MyFrame::OnXslt ( wxCommandEvent& event )
 	ofstream rawBufferStream ( tempFileName.name().c_str() );
 	if ( !rawBufferStream )
 		return;
-	rawBufferStream << rawBufferUtf8;
+	text.write ( rawBufferStream );
 	rawBufferStream.close();
 
 	wxString path;
@@ -4182,7 +4342,7 @@ void MyFrame::OnXslt ( wxCommandEvent& event )
 	if ( id == ID_XSLT )
 	{
 		XslLocator xl;
-		xl.parse ( rawBufferUtf8 );
+		text.parse ( xl );
 		std::string location = xl.getXslLocation();
 
 		path = wxString ( location.c_str(), wxConvUTF8, location.size() );
@@ -4357,7 +4517,7 @@ void MyFrame::OnPrettyPrint ( wxCommandEvent& event )
 		{
 			XmlEncodingHandler::set ( rawBufferUtf8, encoding );
 		}
-		doc->SetTextRaw ( rawBufferUtf8.c_str() );
+		doc->replaceTextRaw ( rawBufferUtf8 );
 		statusProgress ( wxEmptyString );
 	}
 
@@ -4394,13 +4554,13 @@ void MyFrame::OnEncoding ( wxCommandEvent& event )
 		return;
 
 	wxString selection;
-	std::string selectionUtf8, bufferUtf8;
+	std::string selectionUtf8;
 
 	selection = scd.GetStringSelection();
 	selectionUtf8 = selection.mb_str ( wxConvUTF8 );
 
-	getRawText ( doc, bufferUtf8 );
-	XmlEncodingHandler::setUtf8 ( bufferUtf8, true );
+	XmlTextView text ( doc );
+	text.setUtf8 ( true );
 
 	WrapTempFileName tempFileName ( _T ( "" ) );
 
@@ -4408,7 +4568,7 @@ void MyFrame::OnEncoding ( wxCommandEvent& event )
 	int res;
 
 	WrapTempFileName sourceFileName ( doc->getFullFileName() );
-	saveRawUtf8 ( sourceFileName.name(), bufferUtf8 );
+	saveRawUtf8 ( sourceFileName.name(), text );
 
 	res = wl->saveEncodingFromFile ( sourceFileName.name(), tempFileName.name(), selectionUtf8 );
 	if ( res == -1 )
@@ -4420,9 +4580,9 @@ void MyFrame::OnEncoding ( wxCommandEvent& event )
 		return;
 	}
 
-	std::string newBuffer;
-	bool success = ReadFile::run ( tempFileName.name(), newBuffer );
-	if ( !success )
+	// released before tempFileName removes the file
+	std::auto_ptr<BinaryFile> newFile ( ReadFile::view ( tempFileName.name() ) );
+	if ( !newFile.get() )
 	{
 		messagePane ( _ ( "Cannot set encoding (cannot open temporary file)" ),
 		              CONST_STOP );
@@ -4432,15 +4592,15 @@ void MyFrame::OnEncoding ( wxCommandEvent& event )
 	std::auto_ptr<XmlUtf8Reader> xur ( new XmlUtf8Reader (
 	                                       false,
 	                                       expandInternalEntities,
-	                                       newBuffer.size() ) );
-	if ( !xur->parse ( newBuffer ) )
+	                                       newFile->getDataLen() ) );
+	if ( !xur->parse ( newFile->getData(), newFile->getDataLen() ) )
 	{
 		messagePane ( _ ( "Cannot set encoding (cannot parse temporary file)" ),
 		              CONST_STOP );
 		return;
 	}
 
-	doc->SetTextRaw ( xur->getBuffer().c_str() );
+	doc->replaceTextRaw ( xur->getBuffer() );
 	doc->setValidationRequired ( true );
 	doc->SetFocus();
 }
@@ -4501,6 +4661,20 @@ void MyFrame::OnLocationPaneVisible ( wxCommandEvent& event )
 	doc->SetFocus();
 }
 
+void MyFrame::OnOutlinePaneVisible ( wxCommandEvent& event )
+{
+	wxAuiPaneInfo info = manager.GetPane ( outlinePanel );
+	bool visible = ( info.IsShown() ) ? false : true;
+	manager.GetPane ( outlinePanel ).Show ( visible );
+	manager.Update();
+	requestUpdate ( UPDATE_PANES );
+
+	XmlDoc *doc;
+	if ( ( doc = getActiveDocument() ) == NULL )
+		return;
+	doc->SetFocus();
+}
+
 void MyFrame::OnProtectTags ( wxCommandEvent& event )
 {
 	if ( !xmlMenu )
@@ -4510,6 +4684,7 @@ void MyFrame::OnProtectTags ( wxCommandEvent& event )
 		xmlMenu->Check ( ID_PROTECT_TAGS, protectTags );
 	if ( toolBar )
 		toolBar->ToggleTool ( ID_PROTECT_TAGS, protectTags );
+	requestUpdate ( UPDATE_STATUS );
 
 	XmlDoc *doc;
 	if ( ( doc = getActiveDocument() ) == NULL )
@@ -4545,6 +4720,7 @@ void MyFrame::OnVisibilityState ( wxCommandEvent& event )
 	}
 	if ( viewMenu )
 		viewMenu->Check ( id, true );
+	requestUpdate ( UPDATE_STATUS );
 
 	// iterate over all open documents
 	int pageCount = mainBook->GetPageCount();
@@ -4611,7 +4787,21 @@ void MyFrame::findAgain ( wxString s, int flags )
 
 	//doc->SetYCaretPolicy(wxSTC_CARET_SLOP | wxSTC_CARET_STRICT, 10);
 
-	if ( flags & wxFR_DOWN ) // find next
+	// a windowed document is searched as a whole, unless the search
+	// needs Scintilla's regular expressions or word matching
+	if ( doc->isWindowed() &&
+	        ! ( myFlags & ( wxSTC_FIND_REGEXP | wxSTC_FIND_WHOLEWORD ) ) )
+	{
+		int pos = ( ! ( flags & wxFR_DOWN ) || incrementalFind ) ?
+		          doc->GetSelectionStart() : doc->GetSelectionEnd();
+		newLocation = ( doc->findInFile (
+		                    ( const char * ) s.mb_str ( wxConvUTF8 ),
+		                    pos,
+		                    ( flags & wxFR_MATCHCASE ) ? true : false,
+		                    ( flags & wxFR_DOWN ) ? true : false ) ) ?
+		              doc->GetTargetStart() : -1;
+	}
+	else if ( flags & wxFR_DOWN ) // find next
 	{
 		doc->SetTargetStart ( ( incrementalFind ) ?
 		                      doc->GetSelectionStart() : doc->GetSelectionEnd() );
@@ -4668,6 +4858,7 @@ bool MyFrame::closeActiveDocument()
 		return false;
 
 	locationPanel->update ( NULL, wxEmptyString );
+	outlinePanel->update();
 	insertChildPanel->update ( NULL, wxEmptyString );
 	insertSiblingPanel->update ( NULL, wxEmptyString );
 
@@ -4695,6 +4886,15 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 
 	statusProgress ( wxEmptyString );
 
+	// an unloaded placeholder is empty, not the file
+	if ( doc->isPlaceholder() )
+	{
+		wxString message;
+		message.Printf ( _ ( "%s has not been loaded" ), doc->getFullFileName().c_str() );
+		messagePane ( message, CONST_STOP );
+		return false;
+	}
+
 	if ( checkLastModified )
 	{
 		wxFileName fn ( fileName );
@@ -4713,18 +4913,31 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 		}
 	}
 
+	if ( doc->isWindowed() )
+		return saveLargeFile ( doc, fileName );
+
 	int bytes = 0;
-	std::string utf8Buffer, encoding, fileNameLocal;
+	std::string encoding, fileNameLocal, compressedFileNameLocal;
+	std::auto_ptr<WrapTempFileName> plainFileName;
 	bool isXml = true;
+	XmlTextView text ( doc );
 	try
 	{
-		getRawText ( doc, utf8Buffer );
 		XmlEncodingSpy es;
-		es.parse ( utf8Buffer );
+		text.parse ( es );
 		encoding = es.getEncoding();
 
 		fileNameLocal = fileName.mb_str ( wxConvLocal );
 
+		// a compressed file is written to a local temporary file as usual
+		// and then compressed into place
+		if ( doc->getCompressOnSave ( fileName ) )
+		{
+			plainFileName.reset ( new WrapTempFileName ( fileName ) );
+			compressedFileNameLocal = fileNameLocal;
+			fileNameLocal = plainFileName->name();
+		}
+
 		closePane();
 		bool success;
 		success = true;
@@ -4736,9 +4949,9 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 		// raw file conditions
 		if ( doc->getType() == FILE_TYPE_BINARY )
 		{
-			success = saveRawUtf8 ( fileNameLocal, utf8Buffer, true, isXml );
+			success = saveRawUtf8 ( fileNameLocal, text, true, isXml );
 			if ( success )
-				bytes = utf8Buffer.size();
+				bytes = text.size();
 			else
 			{
 				wxString message;
@@ -4750,9 +4963,9 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 		}
 		else if ( !isXml && encoding.empty() )
 		{
-			success = saveRawUtf8 ( fileNameLocal, utf8Buffer, true, isXml );
+			success = saveRawUtf8 ( fileNameLocal, text, true, isXml );
 			if ( success )
-				bytes = utf8Buffer.size();
+				bytes = text.size();
 			else
 			{
 				wxString message;
@@ -4765,15 +4978,15 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 		{
 			auto_ptr<WrapExpat> we ( new WrapExpat() );
 
-			if ( !we->parse ( utf8Buffer ) )
+			if ( !text.parse ( *we ) )
 			{
 				//if ( we->isEncodingError() )
 				//	;
 				messagePane ( we->getLastError(), CONST_WARNING );
 			}
-			success = saveRawUtf8 ( fileNameLocal, utf8Buffer, true, isXml );
+			success = saveRawUtf8 ( fileNameLocal, text, true, isXml );
 			if ( success )
-				bytes = utf8Buffer.size();
+				bytes = text.size();
 			else
 			{
 				wxString message;
@@ -4791,13 +5004,13 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 			        encoding == "UTF-16BE" || encoding == "UTF-32" || encoding == "UTF-32LE" ||
 			        encoding == "UTF-32BE" )
 			{
-				iconv_t cd = iconv_open ( encoding.c_str(), "UTF-8" );
-				if ( cd == ( iconv_t )-1 )
+				WrapIconv transcoder ( encoding.c_str(), "UTF-8" );
+				if ( !transcoder.isOk() )
 				{
-					success = saveRawUtf8 ( fileNameLocal, utf8Buffer, false, isXml );
+					success = saveRawUtf8 ( fileNameLocal, text, false, isXml );
 					if ( success )
 					{
-						bytes = utf8Buffer.size();
+						bytes = text.size();
 						wxString message;
 						message.Printf (
 						    _ ( "%s saved in default encoding UTF-8: unknown encoding %s" ),
@@ -4815,52 +5028,36 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 				}
 				else
 				{
-					size_t utf8BufferLen = utf8Buffer.size();
-
-					size_t iconvBufferLen, iconvBufferLeft, utf8BufferLeft;
-					int iconvLenMultiplier = 4; // worst case scenario
-					if ( encoding == "UTF-16" ||
-					        encoding == "UTF-16BE" ||
-					        encoding == "UTF-16LE" )
-					{
-						iconvLenMultiplier = 2;
-					}
-					else if ( encoding == "UTF-32" ||
-					          encoding == "UTF-32BE" ||
-					          encoding == "UTF-32LE" )
+					std::ofstream ofs ( fileNameLocal.c_str(), std::ios::out | std::ios::binary );
+					if ( !ofs )
 					{
-						iconvLenMultiplier = 4;
+						wxString message;
+						message.Printf ( _ ( "Cannot save %s" ), fileName.c_str() );
+						messagePane ( message, CONST_STOP );
+						return false;
 					}
 
-					iconvBufferLen = iconvBufferLeft =
-					                     utf8BufferLen * iconvLenMultiplier + 4; // worst case scenario
-
-					char *finalBuffer;
-					char *iconvBuffer;
-
-					utf8BufferLeft = utf8BufferLen;
-					iconvBuffer = new char[iconvBufferLen];
-					finalBuffer = iconvBuffer; // iconvBuffer will be incremented by iconv
-					size_t nconv;
-
-					char *utf8BufferPtr = ( char * ) utf8Buffer.c_str();
-
-					nconv = reinterpret_cast < universal_iconv & > ( iconv ) (
-					            cd,
-					            &utf8BufferPtr,
-					            &utf8BufferLeft,
-					            &iconvBuffer,
-					            &iconvBufferLeft );
-
-					iconv_close ( cd );
-
-					if ( nconv == ( size_t )-1 ) // conversion failed
+					// iconv adds boms for UTF-16 & UTF-32 automatically;
+					// the output is written a block at a time
+					IconvStreamSink sink ( ofs );
+					const std::string &head = text.getHead();
+					bool converted = ( head.empty() || transcoder.convert (
+					                       head.data(),
+					                       head.size(),
+					                       sink,
+					                       false ) ) &&
+					                 transcoder.convert (
+					                     text.getBody(),
+					                     text.getBodyLen(),
+					                     sink );
+					ofs.close();
+
+					if ( !converted ) // conversion failed
 					{
-						delete[] finalBuffer;
-						success = saveRawUtf8 ( fileNameLocal, utf8Buffer, false, isXml );
+						success = saveRawUtf8 ( fileNameLocal, text, false, isXml );
 						if ( success )
 						{
-							bytes = utf8Buffer.size();
+							bytes = text.size();
 							wxString message;
 							message.Printf (
 							    _ ( "%s saved in default encoding UTF-8: conversion to %s failed" ),
@@ -4878,42 +5075,25 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 					}
 					else
 					{
-						size_t finalBufferLen = iconvBufferLen - iconvBufferLeft;
-
-						std::ofstream ofs ( fileNameLocal.c_str(), std::ios::out | std::ios::binary );
-						if ( !ofs )
-						{
-							delete[] finalBuffer;
-							wxString message;
-							message.Printf ( _ ( "Cannot save %s" ), fileName.c_str() );
-							messagePane ( message, CONST_STOP );
-							return false;
-						}
-
-						// iconv adds boms for UTF-16 & UTF-32 automatically
-
-						ofs.write ( finalBuffer, finalBufferLen );
-						ofs.close();
-						delete[] finalBuffer;
-						bytes = finalBufferLen;
+						bytes = sink.getBytesWritten();
 					}
 				}
 			}
 			else // all other encodings handled by Libxml
 			{
-				XmlEncodingHandler::setUtf8 ( utf8Buffer );
+				text.setUtf8();
 				auto_ptr<WrapLibxml> wl ( new WrapLibxml ( libxmlNetAccess ) );
 
 				WrapTempFileName sourceFileName ( fileName );
-				saveRawUtf8 ( sourceFileName.name(), utf8Buffer );
+				saveRawUtf8 ( sourceFileName.name(), text );
 				int result = wl->saveEncodingFromFile ( sourceFileName.name(), fileNameLocal, encoding );
 				if ( result == -1 )
 				{
-					success = saveRawUtf8 ( fileNameLocal, utf8Buffer, false, isXml );
+					success = saveRawUtf8 ( fileNameLocal, text, false, isXml );
 					if ( success )
 					{
 						std::string libxmlError = wl->getLastError();
-						bytes = utf8Buffer.size();
+						bytes = text.size();
 						wxString msg, wideEncoding, wideError;
 						wideEncoding =
 						    wxString ( encoding.c_str(), wxConvUTF8, encoding.size() );
@@ -4950,10 +5130,10 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 			if ( answer == wxCANCEL || answer == wxNO )
 				return false;
 
-			bool success = saveRawUtf8 ( fileNameLocal, utf8Buffer, true, isXml );
+			bool success = saveRawUtf8 ( fileNameLocal, text, true, isXml );
 			if ( success )
 			{
-				bytes = utf8Buffer.size();
+				bytes = text.size();
 				wxString message;
 				message.Printf (
 				    _ ( "%s saved in default encoding UTF-8" ),
@@ -4970,6 +5150,21 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 		}
 	}
 
+	if ( plainFileName.get() )
+	{
+		size_t compressedBytes;
+		WrapZlib zlib;
+		if ( !zlib.compressFile ( fileNameLocal, compressedFileNameLocal, compressedBytes ) )
+		{
+			wxString message;
+			message.Printf ( _ ( "Cannot save %s" ), fileName.c_str() );
+			messagePane ( message, CONST_STOP );
+			return false;
+		}
+		bytes = compressedBytes;
+	}
+	doc->setCompressed ( plainFileName.get() != NULL );
+
 	doc->SetFocus();
 	doc->SetSavePoint();
 
@@ -4990,9 +5185,40 @@ bool MyFrame::saveFile ( XmlDoc *doc, wxString& fileName, bool checkLastModified
 	return true;
 }
 
+// A windowed document is written from its mapped file and the edits made
+// to it, without ever holding the whole text
+bool MyFrame::saveLargeFile ( XmlDoc *doc, wxString& fileName )
+{
+	closePane();
+
+	size_t bytes = 0;
+	bool saved;
+	{
+		wxBusyCursor wait;
+		saved = doc->saveLargeFile ( fileName, bytes );
+	}
+	if ( !saved )
+	{
+		wxString message;
+		message.Printf ( _ ( "Cannot save %s" ), fileName.c_str() );
+		messagePane ( message, CONST_STOP );
+		return false;
+	}
+	// no save point is reached if only a large file's blocks had changed
+	requestUpdate ( UPDATE_MODIFIED );
+
+	doc->SetFocus();
+	wxFileName fn ( fileName );
+	if ( fn.IsOk() )
+		doc->setLastModified ( fn.GetModificationTime() );
+	openFileSet.insert ( fileName );
+	displaySavedStatus ( bytes );
+	return true;
+}
+
 bool MyFrame::saveRawUtf8 (
     const std::string& fileNameLocal,
-    std::string& bufferUtf8,
+    XmlTextView& text,
     bool ignoreEncoding,
     bool isXml )
 {
@@ -5001,7 +5227,7 @@ bool MyFrame::saveRawUtf8 (
 		return false;
 
 	if ( !ignoreEncoding && isXml )
-		XmlEncodingHandler::setUtf8 ( bufferUtf8, true );
+		text.setUtf8 ( true );
 
 	if ( saveBom && isXml )
 	{
@@ -5012,12 +5238,12 @@ bool MyFrame::saveRawUtf8 (
 		bom[3] = 0;
 		ofs.write ( bom, 3 );
 	}
-	ofs.write ( bufferUtf8.c_str(), bufferUtf8.size() );
+	text.write ( ofs );
 	ofs.close();
 	return true;
 }
 
-void MyFrame::displaySavedStatus ( int bytes )
+void MyFrame::displaySavedStatus ( size_t bytes )
 {
 	wxString unit;
 	float result = 0;
@@ -5031,13 +5257,11 @@ void MyFrame::displaySavedStatus ( int bytes )
 		result = bytes / 1000;
 		unit = _ ( "kB" );
 	}
-	else if ( bytes >= 0 )
+	else
 	{
 		result = bytes;
 		unit = ngettext ( L"byte", L"bytes", bytes );
 	}
-	else
-		return;
 
 	wxString msg;
 
@@ -5240,6 +5464,11 @@ wxMenuBar *MyFrame::getMenuBar()
 	    _ ( "S&how Current Element Pane" ),
 	    _ ( "Show Current Element Pane" ) );
 	viewMenu->Check ( ID_LOCATION_PANE_VISIBLE, false );
+	viewMenu->AppendCheckItem (
+	    ID_OUTLINE_PANE_VISIBLE,
+	    _ ( "Show Outl&ine Pane" ),
+	    _ ( "Show Outline Pane" ) );
+	viewMenu->Check ( ID_OUTLINE_PANE_VISIBLE, false );
 	viewMenu->AppendCheckItem (
 	    ID_TOOLBAR_VISIBLE, _ ( "Sh&ow Toolbar" ), _ ( "Show Toolbar" ) );
 	viewMenu->Check ( ID_TOOLBAR_VISIBLE, toolbarVisible );
@@ -5787,8 +6016,11 @@ void MyFrame::xmliseWideTextNode ( wxString& s )
 
 int MyFrame::getFileType ( const wxString& fileName )
 {
-	wxString extension;
-	wxFileName::SplitPath ( fileName, NULL/*Path*/, NULL/*Name*/, &extension );
+	wxString name, extension;
+	wxFileName::SplitPath ( fileName, NULL/*Path*/, &name, &extension );
+	// compressed files are typed by the extension before ".gz"
+	if ( extension.Lower() == _T ( "gz" ) )
+		wxFileName::SplitPath ( name, NULL, NULL, &extension );
 	if ( extension.size() != 3 )
 		return FILE_TYPE_XML;
 
@@ -5923,12 +6155,11 @@ void MyFrame::OnAssociate ( wxCommandEvent& event )
 			return;
 	}
 
-	std::string utf8Buffer;
-	getRawText ( doc, utf8Buffer );
-	std::string origEncoding = XmlEncodingHandler::get ( utf8Buffer );
-	XmlEncodingHandler::setUtf8 ( utf8Buffer, true );
+	XmlTextView text ( doc );
+	std::string origEncoding = text.getEncoding();
+	text.setUtf8 ( true );
 	std::auto_ptr<WrapExpat> wellformedparser ( new WrapExpat() );
-	if ( !wellformedparser->parse ( utf8Buffer ) )
+	if ( !text.parse ( *wellformedparser ) )
 	{
 		wxString message;
 		message.Printf (
@@ -6003,7 +6234,7 @@ void MyFrame::OnAssociate ( wxCommandEvent& event )
 	if ( id == ID_ASSOCIATE_W3C_SCHEMA )
 	{
 		std::auto_ptr<XmlAssociateXsd> parser ( new XmlAssociateXsd ( utf8Path ) );
-		if ( !parser->parse ( utf8Buffer ) )
+		if ( !text.parse ( *parser ) )
 			return;
 		modifiedBuffer = parser->getBuffer();
 	}
@@ -6012,7 +6243,7 @@ void MyFrame::OnAssociate ( wxCommandEvent& event )
 		std::auto_ptr<XmlAssociateDtd> parser ( new XmlAssociateDtd (
 		                                            utf8Path,
 		                                            ( auxiliaryBox ) ? ( const char * ) aux.mb_str ( wxConvUTF8 ) : "" ) );
-		if ( !parser->parse ( utf8Buffer ) )
+		if ( !text.parse ( *parser ) )
 			return;
 		modifiedBuffer = parser->getBuffer();
 	}
@@ -6020,32 +6251,164 @@ void MyFrame::OnAssociate ( wxCommandEvent& event )
 	{
 		std::auto_ptr<XmlAssociateXsl> parser ( new XmlAssociateXsl (
 		                                            utf8Path ) );
-		if ( !parser->parse ( utf8Buffer ) )
+		if ( !text.parse ( *parser ) )
 			return;
 		modifiedBuffer = parser->getBuffer();
 	}
 	else
 		return;
 	XmlEncodingHandler::set ( modifiedBuffer, origEncoding );
-	doc->SetTextRaw ( modifiedBuffer.c_str() );
+	doc->replaceTextRaw ( modifiedBuffer );
 	doc->SetFocus();
 }
 
+static bool isUsedLater ( XmlDoc *a, XmlDoc *b )
+{
+	return a->getLastActivated() > b->getLastActivated();
+}
+
+// Restores the last session's tabs as placeholders. Only the tab in use
+// at the end of the session is loaded straight away; the next most
+// recently used ones are loaded in the background and the rest when
+// they are first shown.
 void MyFrame::openRememberedTabs()
 {
+	std::vector<XmlDoc *> tabs;
 	wxStringTokenizer files ( openTabsOnClose, _T ( "|" ) );
+	wxStringTokenizer states ( openTabsState, _T ( "|" ) );
+	restoringTabs = true;
 	while ( files.HasMoreTokens() )
 	{
 		wxString file = files.GetNextToken();
-		if ( file.IsEmpty() || !openFile ( file ) )
-			continue; //break; // Ignore errors
+		wxString state = ( states.HasMoreTokens() ) ?
+		                 states.GetNextToken() : wxString ( wxEmptyString );
+		if ( file.IsEmpty() || !canOpenFile ( file ) )
+			continue; // errors are reported per file
+
+		long caret = 0, large = 0;
+		unsigned long stamp = 0;
+		wxStringTokenizer fields ( state, _T ( "," ) );
+		fields.GetNextToken().ToLong ( &caret );
+		fields.GetNextToken().ToULong ( &stamp );
+		fields.GetNextToken().ToLong ( &large );
+		tabs.push_back ( addPlaceholder ( file, ( int ) caret, stamp, large != 0 ) );
+		if ( stamp > tabActivationCount )
+			tabActivationCount = stamp;
+	}
+
+	if ( tabs.empty() )
+	{
+		restoringTabs = false;
+		return;
 	}
 
+	std::stable_sort ( tabs.begin(), tabs.end(), isUsedLater );
+
+	int selection = mainBook->GetPageIndex ( tabs[0] );
+	if ( selection != mainBook->GetSelection() )
+		mainBook->SetSelection ( selection );
+	restoringTabs = false;
+
+	tabs[0]->setLastActivated ( ++tabActivationCount );
+	loadPlaceholder ( tabs[0] );
+
+	for ( size_t i = 1; i < tabs.size() && i <= MAX_PREFETCH_TABS; ++i )
+	{
+		OpenFileThread *thread = new OpenFileThread (
+		    this,
+		    createFileLoader ( tabs[i]->getFullFileName(), tabs[i]->isLargeFile() ) );
+		thread->setPrefetch();
+		fileLoads.push_back ( thread );
+		++fileLoadCount;
+	}
+	startFileLoads();
+
 	XmlDoc *doc;
 	if ( ( doc = getActiveDocument() ) != NULL )
 		doc->SetFocus();
 }
 
+XmlDoc *MyFrame::addPlaceholder (
+    const wxString& fileName,
+    int caret,
+    unsigned long lastActivated,
+    bool largeFile )
+{
+	wxString directory, name, extension;
+	wxFileName::SplitPath ( fileName, NULL, &directory, &name, &extension );
+	if ( !extension.empty() )
+	{
+		name += _T ( "." );
+		name += extension;
+	}
+
+	XmlDoc *doc = new XmlDoc (
+	    mainBook,
+	    ( largeFile ) ? largeFileProperties : properties,
+	    &protectTags,
+	    visibilityState,
+	    getFileType ( fileName ),
+	    wxID_ANY,
+	    "", // nothing to show until the file is loaded
+	    0,
+	    fileName,
+	    getAuxPath ( fileName ) );
+	doc->setPlaceholder ( caret, largeFile );
+	doc->setLastActivated ( lastActivated );
+	doc->setFullFileName ( fileName );
+	doc->setShortFileName ( name );
+	doc->setDirectory ( directory );
+	wxFileName fn ( fileName );
+	doc->setLastModified ( fn.GetModificationTime() );
+	openFileSet.insert ( fileName );
+
+	mainBook->AddPage ( ( wxWindow * ) doc, name, false );
+	return doc;
+}
+
+XmlDoc *MyFrame::getPlaceholder ( const wxString& fileName )
+{
+	size_t pageCount = mainBook->GetPageCount();
+	for ( size_t i = 0; i < pageCount; ++i )
+	{
+		XmlDoc *doc = ( XmlDoc * ) mainBook->GetPage ( i );
+		if ( doc && doc->isPlaceholder() && doc->getFullFileName() == fileName )
+			return doc;
+	}
+	return NULL;
+}
+
+void MyFrame::loadPlaceholder ( XmlDoc *doc )
+{
+	if ( !doc || !doc->isPlaceholder() )
+		return;
+
+	// a background load that has started will fill the tab shortly
+	std::deque<OpenFileThread *>::iterator it;
+	for ( it = fileLoads.begin(); it != fileLoads.end(); ++it )
+		if ( ( *it )->isStarted() &&
+		        ( *it )->getLoader().getFileName() == doc->getFullFileName() )
+			return;
+
+	// if loading fails or is cancelled, the tab stays an empty read-only
+	// placeholder, and loading is tried again when it is next shown
+	loadFile ( doc->getFullFileName(), doc->isLargeFile() );
+}
+
+void MyFrame::OnPageChanged ( wxAuiNotebookEvent& event )
+{
+	event.Skip();
+	if ( restoringTabs || event.GetSelection() < 0 )
+		return;
+
+	XmlDoc *doc = ( XmlDoc * ) mainBook->GetPage ( event.GetSelection() );
+	if ( !doc )
+		return;
+	requestUpdate ( UPDATE_DOCUMENT );
+	doc->setLastActivated ( ++tabActivationCount );
+	loadPlaceholder ( doc );
+}
+
 void MyFrame::getRawText ( XmlDoc *doc, std::string& buffer )
 {
 	if ( !doc )
@@ -6053,7 +6416,7 @@ void MyFrame::getRawText ( XmlDoc *doc, std::string& buffer )
 		buffer = "";
 		return;
 	}
-	buffer = doc->myGetTextRaw();
+	XmlTextView ( doc ).copy ( buffer );
 }
 
 void MyFrame::OnWordCount ( wxCommandEvent& event )
@@ -6061,14 +6424,11 @@ void MyFrame::OnWordCount ( wxCommandEvent& event )
 	XmlDoc *doc;
 	if ( ( doc = getActiveDocument() ) == NULL )
 		return;
-	wxString wideBuffer;
-	std::string buffer;
-	wideBuffer = doc->GetText();
-	buffer = wideBuffer.mb_str ( wxConvUTF8 );
+	XmlTextView text ( doc );
 
 	auto_ptr<XmlWordCount> xwc ( new XmlWordCount() );
 	wxString msg;
-	if ( !xwc->parse ( buffer.c_str() ) )
+	if ( !text.parse ( *xwc ) )
 	{
 		statusProgress ( wxEmptyString );
 		msg.Printf ( _ ( "Cannot count words: %s" ), xwc->getLastError().c_str() );
@@ -6166,11 +6526,10 @@ void MyFrame::OnDropFiles ( wxDropFilesEvent& event )
 	if ( !no || !iterator )
 		return;
 
+	wxArrayString fileNames;
 	for ( int i = 0; i < no; i++, iterator++ )
-	{
-		if ( !openFile ( *iterator ) )
-			break;
-	}
+		fileNames.Add ( *iterator );
+	openFiles ( fileNames );
 }
 #endif
 
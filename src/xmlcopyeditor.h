@@ -42,12 +42,14 @@
 #include <wx/ipc.h>
 #include <wx/intl.h>
 #include <wx/fileconf.h>
+#include <wx/timer.h>
 #include <utility>
 #include <string>
 #include <set>
 #include <map>
 #include <memory>
 #include <vector>
+#include <deque>
 #include <stdexcept>
 #include "xmldoc.h"
 #include "myhtmlpane.h"
@@ -65,6 +67,7 @@ enum
 	ID_XML_TOOLBAR,
 	ID_NOTEBOOK,
 	ID_LOCATION_PANEL,
+	ID_OUTLINE_PANEL,
 	ID_INSERT_CHILD_PANEL,
 	ID_INSERT_SIBLING_PANEL,
 	ID_INSERT_ENTITY_PANEL,
@@ -73,6 +76,7 @@ enum
 	ID_COMMAND,
 	ID_VALIDATION_PANE,
 	ID_LOCATION_PANE_VISIBLE,
+	ID_OUTLINE_PANE_VISIBLE,
 	ID_PREVIOUS_DOCUMENT,
 	ID_NEXT_DOCUMENT,
 	ID_OPTIONS,
@@ -159,6 +163,7 @@ enum
 	ID_VALIDATE_PRESET9,
 	ID_EXPORT,
 	ID_EXPORT_MSWORD,
+	ID_UPDATE_TIMER,
 	// icon constants
 	CONST_WARNING,
 	CONST_STOP,
@@ -166,6 +171,21 @@ enum
 	CONST_QUESTION
 };
 
+// what MyFrame::OnIdle has to bring up to date
+enum
+{
+	UPDATE_CARET = 1, // moved, or the text changed
+	UPDATE_MODIFIED = 2, // the document's modified state changed
+	UPDATE_DOCUMENT = 4, // another document, or the document renamed
+	UPDATE_PROMPT_MAPS = 8,
+	UPDATE_STATUS = 16, // tags locked or hidden
+	UPDATE_PANES = 32, // a pane refresh put off by the rate limit
+	UPDATE_ALL = 63
+};
+
+// shortest time in milliseconds between two refreshes of the panes
+#define PANE_UPDATE_INTERVAL 100
+
 class MyApp : public wxApp
 {
 	public:
@@ -194,12 +214,17 @@ class MyApp : public wxApp
 class MyNotebook;
 class wxAuiNotebookEvent;
 class LocationPanel;
+class OutlinePanel;
 class InsertPanel;
 class CommandPanel;
 
 #ifdef NEWFINDREPLACE
 class FindReplacePanel;
 #endif
+class FileLoader;
+class XmlTextView;
+class OpenFileThread;
+class wxProgressDialog;
 
 class MyFrame : public wxFrame
 {
@@ -233,6 +258,8 @@ class MyFrame : public wxFrame
 		void OnFeedback ( wxCommandEvent& event );
 		void OnSplitTab ( wxCommandEvent& event );
 		void OnFontSmaller ( wxCommandEvent& event );
+		void OnOpenFileProgress ( wxCommandEvent& event );
+		void OnOpenFileCompleted ( wxCommandEvent& event );
 		void OnFontMedium ( wxCommandEvent& event );
 		void OnFontLarger ( wxCommandEvent& event );
 		void OnImportMSWord ( wxCommandEvent& event );
@@ -268,6 +295,9 @@ class MyFrame : public wxFrame
 		void OnDialogReplaceAll ( wxFindDialogEvent& event );
 		void OnFrameClose ( wxCloseEvent& event );
 		void OnIdle ( wxIdleEvent& event );
+		void OnUpdateTimer ( wxTimerEvent& event );
+		void OnDocumentUpdateUI ( wxStyledTextEvent& event );
+		void OnDocumentSavePoint ( wxStyledTextEvent& event );
 		void OnUpdateClosePane ( wxUpdateUIEvent& event );
 		void OnUpdateCloseAll ( wxUpdateUIEvent& event );
 		void OnUpdateUndo ( wxUpdateUIEvent& event );
@@ -282,6 +312,7 @@ class MyFrame : public wxFrame
 		void OnUpdateReplaceRange ( wxUpdateUIEvent& event );
 		void OnUpdateReload ( wxUpdateUIEvent& event );
 		void OnUpdateLocationPaneVisible ( wxUpdateUIEvent& event );
+		void OnUpdateOutlinePaneVisible ( wxUpdateUIEvent& event );
 		void OnValidateDTD ( wxCommandEvent& event );
 		void OnValidateRelaxNG ( wxCommandEvent& event );
 		void OnValidateSchema ( wxCommandEvent& event );
@@ -294,11 +325,13 @@ class MyFrame : public wxFrame
 		void OnKeyPressed ( wxKeyEvent& event );
 		void OnToolbarVisible ( wxCommandEvent& event );
 		void OnLocationPaneVisible ( wxCommandEvent& event );
+		void OnOutlinePaneVisible ( wxCommandEvent& event );
 		void OnProtectTags ( wxCommandEvent& event );
 		void OnVisibilityState ( wxCommandEvent& event );
 		void OnColorScheme ( wxCommandEvent& event );
 		void OnAssociate ( wxCommandEvent& event );
 		void OnPageClosing ( wxAuiNotebookEvent& event );
+		void OnPageChanged ( wxAuiNotebookEvent& event );
 		void OnToggleFold ( wxCommandEvent& event );
 		void OnFoldAll ( wxCommandEvent& event );
 		void OnUnfoldAll ( wxCommandEvent& event );
@@ -330,6 +363,8 @@ class MyFrame : public wxFrame
 		void newDocument ( const wxString& s, const wxString& path = wxEmptyString, bool canSave = false );
 		void newDocument ( const std::string& s, const wxString& path = wxEmptyString, bool canSave = false );
 		void statusProgress ( const wxString& s );
+		// has OnIdle bring up to date what the UPDATE_* flags name
+		void requestUpdate ( int updates );
 
 		// public to allow InsertPanel access
 		void messagePane ( const wxString& s,
@@ -338,6 +373,7 @@ class MyFrame : public wxFrame
 
 		// public to allow IPC access
 		bool openFile ( wxString& fileName, bool largeFile = false );
+		void openFiles ( const wxArrayString& fileNames, bool largeFile = false );
 		bool isOpen ( const wxString& fileName );
 		bool activateTab ( const wxString& fileName );
 		void reloadTab();
@@ -359,6 +395,7 @@ class MyFrame : public wxFrame
 		wxMenuBar *menuBar;
 		wxToolBar *toolBar;
 		LocationPanel *locationPanel;
+		OutlinePanel *outlinePanel;
 		InsertPanel *insertChildPanel, *insertSiblingPanel, *insertEntityPanel;
 
 #ifdef NEWFINDREPLACE
@@ -381,6 +418,15 @@ class MyFrame : public wxFrame
 		std::set<wxString> openFileSet;
 		std::set<wxString> openLargeFileSet;
 		std::vector<wxString> tempFileVector, fileQueue;
+		std::deque<OpenFileThread *> fileLoads; // in the order requested
+		std::auto_ptr<wxProgressDialog> fileLoadProgress;
+		int fileLoadCount, fileLoadsDone;
+		bool fileLoadProgressBusy;
+		int pendingUpdates, deferredUpdates; // UPDATE_* flags
+		wxTimer updateTimer;
+		wxStopWatch paneUpdateWatch;
+		bool restoringTabs, useIndexCache;
+		unsigned long tabActivationCount;
 		int documentCount,
 		framePosX,
 		framePosY,
@@ -414,10 +460,10 @@ class MyFrame : public wxFrame
 		  lastRelaxNGSchema,
 		  lastDtdPublicAux,
 		  openTabsOnClose,
+		  openTabsState,
 		  layout,
 		  defaultLayout,
 		  lastParent,
-		  lastGrandparent,
 		  commandString,
 		  exportStylesheet,
 		  exportFolder,
@@ -437,6 +483,7 @@ class MyFrame : public wxFrame
 #endif
 		restoreLayout,
 		showLocationPane,
+		showOutlinePane,
 		showInsertChildPane,
 		showInsertSiblingPane,
 		showInsertEntityPane,
@@ -501,7 +548,7 @@ class MyFrame : public wxFrame
 		void encodingMessage();
 		void save();
 		void saveAs();
-		void displaySavedStatus ( int bytes );
+		void displaySavedStatus ( size_t bytes );
 		void addSafeSeparator ( wxToolBar *toolBar );
 		void findAgain ( wxString s, int flags );
 		void updateFileMenu ( bool deleteExisting = true );
@@ -514,12 +561,27 @@ class MyFrame : public wxFrame
 		void modifiedMessage();
 		void loadBitmaps();
 		void openRememberedTabs();
+		XmlDoc *addPlaceholder (
+		    const wxString& fileName,
+		    int caret,
+		    unsigned long lastActivated,
+		    bool largeFile );
+		XmlDoc *getPlaceholder ( const wxString& fileName );
+		void loadPlaceholder ( XmlDoc *doc );
+		bool loadFile ( const wxString& fileName, bool largeFile );
 		void getRawText ( XmlDoc *doc, std::string& buffer );
 		void updateToolbar();
-		std::string getApproximateEncoding ( char *docBuffer, size_t docBufferLen );
+		bool canOpenFile ( wxString& fileName );
+		FileLoader *createFileLoader ( const wxString& fileName, bool largeFile );
+		bool showLoadedFile ( FileLoader& loader );
+		void showLoadedFiles();
+		void startFileLoads();
+		void updateFileLoadProgress();
+		void cancelFileLoads();
+		bool saveLargeFile ( XmlDoc *doc, wxString& fileName );
 		bool saveRawUtf8 (
 		    const std::string& fileNameLocal,
-		    std::string& bufferUtf8,
+		    XmlTextView& text,
 		    bool ignoreEncoding = false,
 		    bool isXml = true );
 		void removeUtf8Bom ( std::string& buffer );
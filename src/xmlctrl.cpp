@@ -19,13 +19,20 @@
 
 #include "xmlctrl.h"
 #include "xmlpromptgenerator.h"
+#include "indexcache.h"
 #include "xmlshallowvalidator.h"
 #include "xmlencodinghandler.h"
 //#include "wrapxerces.h"
 #include "xmlcopyeditor.h" // needed to enable validation-as-you-type alerts
 #include <utility>
 #include <memory>
+#include <cstring>
 #include "validationthread.h"
+#include "promptmapthread.h"
+#include "tagindex.h"
+#include "xmllexer.h"
+#include "xmltextview.h"
+#include "textdiff.h"
 
 
 // adapted from wxSTEdit (c) 2005 John Labenski, Otto Wyss
@@ -36,11 +43,14 @@ BEGIN_EVENT_TABLE ( XmlCtrl, wxStyledTextCtrl )
 	EVT_KEY_DOWN ( XmlCtrl::OnKeyPressed )
 	EVT_IDLE ( XmlCtrl::OnIdle )
 	EVT_STC_MARGINCLICK ( wxID_ANY, XmlCtrl::OnMarginClick )
+	EVT_STC_MODIFIED ( wxID_ANY, XmlCtrl::OnModified )
+	EVT_STC_STYLENEEDED ( wxID_ANY, XmlCtrl::OnStyleNeeded )
 	EVT_LEFT_DOWN ( XmlCtrl::OnMouseLeftDown )
 	EVT_LEFT_UP ( XmlCtrl::OnMouseLeftUp )
 	EVT_RIGHT_UP ( XmlCtrl::OnMouseRightUp )
 	EVT_MIDDLE_DOWN ( XmlCtrl::OnMiddleDown )
 	EVT_COMMAND(wxID_ANY, wxEVT_COMMAND_VALIDATION_COMPLETED, XmlCtrl::OnValidationCompleted)
+	EVT_COMMAND(wxID_ANY, wxEVT_COMMAND_PROMPT_MAPS_COMPLETED, XmlCtrl::OnPromptMapsCompleted)
 END_EVENT_TABLE()
 
 // global protection for validation threads
@@ -69,12 +79,19 @@ XmlCtrl::XmlCtrl (
 	, auxPath ( auxPathParameter )
 {
 	validationThread = NULL;
+	promptMapThread = NULL;
+	promptMapRequest = 0;
+	promptMaps.reset ( new PromptMaps() );
 
 	grammarFound = false;
 	validationRequired = (buffer) ? true : false; // NULL for plain XML template
 
 	currentMaxLine = 1;
 
+	// XML is styled by XmlLexer rather than by Scintilla
+	if ( type == FILE_TYPE_XML )
+		xmlLexer.reset ( new XmlLexer ( this ) );
+
 	applyProperties ( propertiesParameter );
 
 	SetTabWidth ( 2 );
@@ -85,6 +102,13 @@ XmlCtrl::XmlCtrl (
 	SetTabIndents ( false );
 	SetUndoCollection ( false );
 
+	// kept up to date from here on by OnModified
+	if ( type == FILE_TYPE_XML )
+	{
+		tagIndex.reset ( new TagIndex ( this ) );
+		snapshotCache.reset ( new DocumentSnapshotCache ( this ) );
+	}
+
 	// handle NULL buffer
 	if ( !buffer )
 	{
@@ -98,21 +122,7 @@ XmlCtrl::XmlCtrl (
 	SendMsg ( 2001, bufferLen, ( wxIntPtr ) buffer );
 #endif
 
-	SetSelection ( 0, 0 );
-
-	// position cursor
-	if ( type == FILE_TYPE_XML &&
-	        bufferLen > 5 &&
-	        buffer[0] == '<' &&
-	        buffer[1] == '?' &&
-	        buffer[2] == 'x' &&
-	        buffer[3] == 'm' &&
-	        buffer[4] == 'l' &&
-	        GetLineCount() > 1 )
-	{
-		GotoLine ( 1 ); // == line 2 of the document
-	}
-
+	positionCursor();
 
 	SetSavePoint();
 	SetUndoCollection ( true );
@@ -130,16 +140,13 @@ XmlCtrl::XmlCtrl (
 
 XmlCtrl::~XmlCtrl()
 {
-	attributeMap.clear();
-	elementMap.clear();
-	entitySet.clear();
-
 	if ( validationThread != NULL )
 	{
 		validationThread->PendingDelete();
 		//validationThread->Delete();
 		//delete validationThread;
 	}
+	cancelPromptMaps();
 }
 
 
@@ -191,6 +198,20 @@ void XmlCtrl::OnValidationCompleted ( wxCommandEvent &event )
 	validationThread = NULL;
 }
 
+void XmlCtrl::OnPromptMapsCompleted ( wxCommandEvent &event )
+{
+	wxCriticalSectionLocker locker ( xmlcopyeditorCriticalSection );
+
+	// a request that has been replaced may finish before it notices
+	if ( promptMapThread == NULL || event.GetInt() != promptMapThread->getRequest() )
+		return;
+
+	promptMapThread->Wait();
+	takePromptMaps ( *promptMapThread );
+	delete promptMapThread;
+	promptMapThread = NULL;
+}
+
 void XmlCtrl::OnChar ( wxKeyEvent& event )
 {
 	if ( *protectTags )
@@ -476,18 +497,8 @@ void XmlCtrl::handleOpenAngleBracket ( wxKeyEvent& event )
 		return;
 
 	wxString parent = getLastElementName ( parentCloseAngleBracket );
-	if ( elementMap.find ( parent ) == elementMap.end() )
-		return;
-
-	wxString choice;
-	std::set<wxString> &childSet = elementMap[parent];
-	std::set<wxString>::iterator it;
-	for ( it = childSet.begin(); it != childSet.end(); it++ )
-	{
-		if ( !choice.empty() )
-			choice.append ( _T ( "<" ) );
-		choice.append ( *it );
-	}
+	const wxString &choice =
+	    promptMaps->database.getChildList ( promptMaps->database.find ( parent ) );
 	if ( !choice.empty() )
 		UserListShow ( 0, choice );
 }
@@ -510,10 +521,6 @@ void XmlCtrl::handleCloseAngleBracket ( wxKeyEvent& event )
 	pos = GetCurrentPos();
 
 	wxString elementName = getLastElementName ( pos );
-	if ( !elementName.empty() )
-	{
-		attributeMap[elementName]; // Just want to put it there
-	}
 
 	// exit condition 1
 	if ( pos <= 1 )
@@ -575,21 +582,20 @@ void XmlCtrl::handleEquals ( wxKeyEvent& event )
 	elementName = getLastElementName ( pos );
 	attributeName = getLastAttributeName ( pos );
 
-	std::set<wxString> &valueSet = attributeMap[elementName][attributeName];
-	if ( valueSet.empty() )
+	CompletionDatabase::Range values = promptMaps->database.getAttributeValues (
+	                                       promptMaps->database.find ( elementName ),
+	                                       promptMaps->database.find ( attributeName ) );
+	if ( values.empty() )
 		return;
 
-	std::set<wxString>::iterator valueSetIterator;
 	int cutoff = BUFSIZ;
-	for ( valueSetIterator = valueSet.begin();
-	        valueSetIterator != valueSet.end();
-	        valueSetIterator++ )
+	for ( ; values.begin != values.end; ++values.begin )
 	{
 		if ( ! ( cutoff-- ) )
 			break;
 		if ( !choice.empty() )
 			choice.Append ( _T ( "<" ) );
-		choice.Append ( *valueSetIterator );
+		choice.Append ( promptMaps->database.getName ( *values.begin ) );
 	}
 
 	if ( !choice.empty() )
@@ -642,22 +648,24 @@ void XmlCtrl::handleSpace ( wxKeyEvent& event )
 	AddText ( _T ( " " ) );
 
 	wxString elementName = getLastElementName ( pos );
-	if ( attributeMap.find ( elementName ) == attributeMap.end() )
+	CompletionDatabase::Range attributes =
+	    promptMaps->database.getAttributes ( promptMaps->database.find ( elementName ) );
+	if ( attributes.empty() )
 		return;
 
 	wxString choice;
 	wxString tag = GetTextRange ( tagStartPos, pos );
-	std::map<wxString, std::set<wxString> > &curAttMap = attributeMap[elementName];
-	std::map<wxString, std::set<wxString> >::iterator it;
-	for ( it = curAttMap.begin(); it != curAttMap.end(); it++ )
+	for ( ; attributes.begin != attributes.end; ++attributes.begin )
 	{
+		const wxString &attribute = promptMaps->database.getName ( *attributes.begin );
+
 		// avoid duplicate attributes
-		if ( tag.Contains ( it->first + _T ( "=" ) ) )
+		if ( tag.Contains ( attribute + _T ( "=" ) ) )
 			continue;
 
 		if ( !choice.empty() )
 			choice.Append ( _T ( "<" ) );
-		choice.Append ( it->first );
+		choice.Append ( attribute );
 	}
 	if ( !choice.empty() )
 	{
@@ -685,14 +693,14 @@ void XmlCtrl::handleAmpersand ( wxKeyEvent& event )
 	if ( style != wxSTC_H_COMMENT &&
 	        style != wxSTC_H_CDATA &&
 	        style != wxSTC_H_TAGUNKNOWN &&
-	        entitySet.size() >= 4 ) // min. 4 default entities
+	        promptMaps->entitySet.size() >= 4 ) // min. 4 default entities
 	{
 		AddText ( _T ( "&" ) );
 		wxString choice;
-		std::set<wxString>::iterator it = entitySet.begin();
+		std::set<wxString>::const_iterator it = promptMaps->entitySet.begin();
 		choice += *it;
 		choice += _T ( ";" );
-		for ( it++; it != entitySet.end(); it++ )
+		for ( it++; it != promptMaps->entitySet.end(); it++ )
 		{
 			choice += _T ( "<" );
 			choice += *it;
@@ -935,13 +943,12 @@ wxString XmlCtrl::getLastElementName ( int pos )
 	return GetTextRange ( startPos, iteratorPos );
 }
 
-const std::set<wxString> &XmlCtrl::getChildren ( const wxString& parent )
+void XmlCtrl::getChildren ( const wxString& parent, wxArrayString &children )
 {
-	static std::set<wxString> mySet;
-	if ( elementMap.find ( parent ) == elementMap.end() )
-		return mySet;
-
-	return elementMap[parent];
+	CompletionDatabase::Range range =
+	    promptMaps->database.getChildren ( promptMaps->database.find ( parent ) );
+	for ( ; range.begin != range.end; ++range.begin )
+		children.Add ( promptMaps->database.getName ( *range.begin ) );
 }
 
 wxString XmlCtrl::getLastAttributeName ( int pos )
@@ -967,6 +974,9 @@ wxString XmlCtrl::getLastAttributeName ( int pos )
 
 int XmlCtrl::getParentCloseAngleBracket ( int pos, int range )
 {
+	if ( tagIndex.get() )
+		return tagIndex->getParentEnd ( pos );
+
 	int cutoff, iteratorPos, depth;
 	cutoff = ( ( pos - range ) > 2 ) ? pos - range : 2;
 	depth = 1;
@@ -1024,36 +1034,166 @@ void XmlCtrl::adjustNoColumnWidth()
 	currentMaxLine = maxLine;
 }
 
+void XmlCtrl::positionCursor()
+{
+	SetSelection ( 0, 0 );
+
+	if ( type == FILE_TYPE_XML &&
+	        GetLength() > 5 &&
+	        GetCharAt ( 0 ) == '<' &&
+	        GetCharAt ( 1 ) == '?' &&
+	        GetCharAt ( 2 ) == 'x' &&
+	        GetCharAt ( 3 ) == 'm' &&
+	        GetCharAt ( 4 ) == 'l' &&
+	        GetLineCount() > 1 )
+	{
+		GotoLine ( 1 ); // == line 2 of the document
+	}
+}
+
+// Replaces the contents as if the control had been created with the buffer
+void XmlCtrl::loadBuffer ( const char *buffer, size_t bufferLen )
+{
+	SetUndoCollection ( false );
+	ClearAll();
+#if wxCHECK_VERSION(2,9,0)
+	AddTextRaw ( buffer, bufferLen );
+#else
+	SendMsg ( 2001, bufferLen, ( wxIntPtr ) buffer );
+#endif
+	positionCursor();
+	SetSavePoint();
+	SetUndoCollection ( true );
+	EmptyUndoBuffer();
+
+	validationRequired = true;
+	applyVisibilityState ( visibilityState );
+}
+
+// Adds the rest of a document that is handed over in blocks
+void XmlCtrl::appendBuffer ( const char *buffer, size_t bufferLen )
+{
+	SetUndoCollection ( false );
+#if wxCHECK_VERSION(2,9,0)
+	AppendTextRaw ( buffer, bufferLen );
+#else
+	SendMsg ( 2282, bufferLen, ( wxIntPtr ) buffer ); // SCI_APPENDTEXT
+#endif
+	SetSavePoint();
+	SetUndoCollection ( true );
+}
+
+// Replaces the contents with the buffer as one undoable action, rewriting
+// only the ranges that differ so that the undo buffer does not have to
+// hold both copies of the document
+void XmlCtrl::replaceTextRaw ( const char *buffer, size_t bufferLen )
+{
+	std::vector<TextDiff::Hunk> hunks;
+#if wxCHECK_VERSION(2,9,0)
+	TextDiff::compare ( GetCharacterPointer(), GetLength(), buffer, bufferLen, hunks );
+#else
+	wxCharBuffer text = GetTextRaw();
+	TextDiff::compare ( text.data(), GetLength(), buffer, bufferLen, hunks );
+#endif
+	if ( hunks.empty() )
+		return;
+
+	BeginUndoAction();
+	// from the end, so that the old positions still hold
+	std::vector<TextDiff::Hunk>::reverse_iterator it;
+	for ( it = hunks.rbegin(); it != hunks.rend(); ++it )
+	{
+		SetTargetStart ( ( int ) it->oldPos );
+		SetTargetEnd ( ( int ) ( it->oldPos + it->oldLen ) );
+		SendMsg ( 2194, it->newLen, ( wxIntPtr ) ( buffer + it->newPos ) ); // SCI_REPLACETARGET
+	}
+	EndUndoAction();
+}
+
+// Parses a snapshot of the text on a worker thread
 void XmlCtrl::updatePromptMaps()
 {
-	wxString buffer = GetText();
-	std::string bufferUtf8;
-	bufferUtf8 = ( const char * ) buffer.mb_str ( wxConvUTF8 );
-	XmlEncodingHandler::setUtf8 ( bufferUtf8, true );
+	DocumentSnapshotPtr snapshot;
+	if ( snapshotCache.get() )
+	{
+		snapshot = snapshotCache->get();
+	}
+	else
+	{
+		std::string buffer;
+		XmlTextView ( this ).copy ( buffer );
+		snapshot.reset ( new DocumentSnapshot ( buffer.data(), buffer.size() ) );
+	}
 
-	updatePromptMaps ( bufferUtf8.c_str(), bufferUtf8.size() );
+	startPromptMapThread ( new PromptMapThread (
+	                           GetEventHandler(),
+	                           ++promptMapRequest,
+	                           snapshot,
+	                           basePath,
+	                           auxPath ) );
 }
 
-void XmlCtrl::updatePromptMaps ( const char *buffer, size_t bufferLen )
+// Takes over a generator that has already been fed the document, e.g.
+// incrementally while the file was being loaded, and builds the prompt
+// maps from it on a worker thread. Whether a grammar was found is known
+// straight away.
+void XmlCtrl::updatePromptMaps ( XmlPromptGenerator *xpg )
 {
-	attributeMap.clear();
-	elementMap.clear();
-	elementStructureMap.clear();
-	std::auto_ptr<XmlPromptGenerator> xpg ( new XmlPromptGenerator (
-	                                            basePath,
-	                                            auxPath ) );
-	xpg->parse ( buffer, bufferLen );
-	xpg->getAttributeMap ( attributeMap );
-	xpg->getRequiredAttributeMap ( requiredAttributeMap );
-	xpg->getElementMap ( elementMap );
-	xpg->getElementStructureMap ( elementStructureMap );
-	xpg->getEntitySet ( entitySet );
 	grammarFound = xpg->getGrammarFound();
-	entitySet.insert ( _T ( "amp" ) );
-	entitySet.insert ( _T ( "apos" ) );
-	entitySet.insert ( _T ( "quot" ) );
-	entitySet.insert ( _T ( "lt" ) );
-	entitySet.insert ( _T ( "gt" ) );
+	startPromptMapThread ( new PromptMapThread (
+	                           GetEventHandler(),
+	                           ++promptMapRequest,
+	                           xpg ) );
+}
+
+// Takes the prompt maps remembered by IndexCache
+void XmlCtrl::updatePromptMaps ( const DocumentIndex &index )
+{
+	cancelPromptMaps();
+	boost::shared_ptr<PromptMaps> maps ( new PromptMaps() );
+	maps->database.build (
+	    index.attributeMap,
+	    index.requiredAttributeMap,
+	    index.elementMap,
+	    index.elementStructureMap );
+	maps->entitySet = index.entitySet;
+	maps->addPredefinedEntities();
+	promptMaps = maps;
+	grammarFound = index.grammarFound;
+	( ( MyFrame * ) GetGrandParent() )->requestUpdate ( UPDATE_PROMPT_MAPS );
+}
+
+// Replaces any request still running; if no thread can be had, the
+// prompt maps are compiled here instead
+void XmlCtrl::startPromptMapThread ( PromptMapThread *thread )
+{
+	cancelPromptMaps();
+
+	if ( thread->Create() == wxTHREAD_NO_ERROR
+	        && thread->Run() == wxTHREAD_NO_ERROR )
+	{
+		promptMapThread = thread;
+		return;
+	}
+	if ( thread->compile() )
+		takePromptMaps ( *thread );
+	delete thread;
+}
+
+void XmlCtrl::takePromptMaps ( PromptMapThread &thread )
+{
+	promptMaps = thread.getPromptMaps();
+	grammarFound = thread.getGrammarFound();
+	( ( MyFrame * ) GetGrandParent() )->requestUpdate ( UPDATE_PROMPT_MAPS );
+}
+
+void XmlCtrl::cancelPromptMaps()
+{
+	if ( promptMapThread != NULL )
+	{
+		promptMapThread->PendingDelete();
+		promptMapThread = NULL;
+	}
 }
 
 void XmlCtrl::applyProperties (
@@ -1084,7 +1224,13 @@ void XmlCtrl::applyProperties (
 			SetLexer ( wxSTC_LEX_CSS );
 			break;
 		default:
-			SetLexer ( wxSTC_LEX_XML );
+			if ( xmlLexer.get() )
+			{
+				SetLexer ( wxSTC_LEX_CONTAINER );
+				xmlLexer->setFold ( properties.fold );
+			}
+			else
+				SetLexer ( wxSTC_LEX_XML );
 			break;
 	}
 
@@ -1124,7 +1270,8 @@ void XmlCtrl::applyProperties (
 		SetMarginWidth ( 2, 0 );
 	}
 
-	if ( type != FILE_TYPE_BINARY )
+	// XmlLexer styles the text as it comes into view
+	if ( type != FILE_TYPE_BINARY && !xmlLexer.get() )
 	{
 		Colourise ( 0, -1 );
 	}
@@ -1135,6 +1282,36 @@ void XmlCtrl::applyProperties (
 	SetProperty ( _T ( "fold.html" ), value );
 }
 
+void XmlCtrl::OnModified ( wxStyledTextEvent& event )
+{
+	int modificationType = event.GetModificationType();
+	if ( modificationType & wxSTC_MOD_INSERTTEXT )
+	{
+		if ( tagIndex.get() )
+			tagIndex->insert ( event.GetPosition(), event.GetLength() );
+		if ( xmlLexer.get() )
+			xmlLexer->insert ( event.GetPosition(), event.GetLength() );
+		if ( snapshotCache.get() )
+			snapshotCache->insert ( event.GetPosition(), event.GetLength() );
+	}
+	else if ( modificationType & wxSTC_MOD_DELETETEXT )
+	{
+		if ( tagIndex.get() )
+			tagIndex->remove ( event.GetPosition(), event.GetLength() );
+		if ( xmlLexer.get() )
+			xmlLexer->remove ( event.GetPosition(), event.GetLength() );
+		if ( snapshotCache.get() )
+			snapshotCache->remove ( event.GetPosition(), event.GetLength() );
+	}
+	event.Skip();
+}
+
+void XmlCtrl::OnStyleNeeded ( wxStyledTextEvent& event )
+{
+	if ( xmlLexer.get() )
+		xmlLexer->style ( event.GetPosition() );
+}
+
 void XmlCtrl::OnMarginClick ( wxStyledTextEvent& event )
 {
 	const int line = LineFromPosition ( event.GetPosition() );
@@ -1187,6 +1364,11 @@ bool XmlCtrl::isCloseTag ( int pos )
 
 int XmlCtrl::getTagStartPos ( int pos )
 {
+	// the index answers for the '>' of a tag; anywhere else, such as in
+	// a tag still being typed, is found by walking back
+	if ( tagIndex.get() && tagIndex->getTagType ( pos ) != TAG_TYPE_ERROR )
+		return tagIndex->getTagStart ( pos );
+
 	int iteratorPos;
 	for ( iteratorPos = pos; iteratorPos >= 0; --iteratorPos )
 	{
@@ -1245,6 +1427,15 @@ bool XmlCtrl::canInsertAt ( int pos )
 	if ( pos < 0 )
 		return false;
 
+	if ( tagIndex.get() )
+	{
+		if ( tagIndex->isInMarkup ( pos ) )
+			return false;
+		if ( getLexerStyleAt ( pos ) == wxSTC_H_ENTITY )
+			return GetCharAt ( pos ) == '&';
+		return true;
+	}
+
 	int style = getLexerStyleAt ( pos );
 	switch ( style )
 	{
@@ -1288,37 +1479,35 @@ bool XmlCtrl::canMoveLeftAt ( int pos )
 	return false;
 }
 
+// Markup is stepped over in one go where the tag index knows its extent;
+// otherwise, and within entities, a character at a time
 void XmlCtrl::adjustPosRight()
 {
-	int pos, max;
-	bool canInsert = false;
+	int pos, max, end;
 	pos = GetCurrentPos();
 	max = GetLength();
-	for ( ; pos <= max; pos++ )
-		if ( canInsertAt ( pos ) )
-		{
-			canInsert = true;
-			break;
-		}
+	while ( pos <= max && !canInsertAt ( pos ) )
+	{
+		end = ( tagIndex.get() ) ? tagIndex->getMarkupEnd ( pos ) : -1;
+		pos = ( end >= 0 ) ? end + 1 : pos + 1;
+	}
 	SetSelection ( pos, pos );
 }
 
 void XmlCtrl::adjustPosLeft()
 {
-	int pos;
-	bool canInsert = false;
+	int pos, start;
 	pos = GetCurrentPos() - 1;
 	if ( pos < 0 )
 	{
 		SetSelection ( 0, 0 );
 		return;
 	}
-	for ( ; pos > 0; pos-- )
-		if ( canInsertAt ( pos ) )
-		{
-			canInsert = true;
-			break;
-		}
+	while ( pos > 0 && !canInsertAt ( pos ) )
+	{
+		start = ( tagIndex.get() ) ? tagIndex->getMarkupStart ( pos ) : -1;
+		pos = ( start >= 0 ) ? start : pos - 1;
+	}
 	SetSelection ( pos, pos );
 }
 
@@ -1339,6 +1528,24 @@ void XmlCtrl::adjustSelection()
 		return;
 	}
 
+	// the selection is cut short at the next markup or entity
+	if ( tagIndex.get() )
+	{
+		int next = tagIndex->getNextMarkupStart ( start );
+		if ( next >= 0 && next < end )
+			end = next;
+		if ( end > start )
+		{
+			wxCharBuffer buffer = GetTextRangeRaw ( start, end );
+			const char *ampersand =
+			    ( const char * ) memchr ( buffer.data(), '&', end - start );
+			if ( ampersand )
+				end = start + ( ampersand - buffer.data() );
+		}
+		SetSelection ( start, end );
+		return;
+	}
+
 	for ( iterator = start; iterator < end; iterator++ )
 	{
 		if ( !canMoveRightAt ( iterator ) )
@@ -1681,7 +1888,9 @@ void XmlCtrl::applyVisibilityState ( int state )
 	for ( int i = wxSTC_H_SGML_DEFAULT; i <= wxSTC_H_SGML_BLOCK_DEFAULT; i++ )
 		StyleSetVisible ( i, visible );
 
-	Colourise ( 0, -1 );
+	// only the layout changes; the styles XmlLexer has set still hold
+	if ( !xmlLexer.get() )
+		Colourise ( 0, -1 );
 }
 
 int XmlCtrl::getType()
@@ -1689,6 +1898,11 @@ int XmlCtrl::getType()
 	return type;
 }
 
+TagIndex *XmlCtrl::getTagIndex()
+{
+	return tagIndex.get();
+}
+
 void XmlCtrl::foldAll()
 {
 	expandFoldsToLevel ( 1, false );
@@ -1701,49 +1915,87 @@ void XmlCtrl::unfoldAll()
 
 void XmlCtrl::toggleFold()
 {
-	int pos, line, level;
+	int pos, line;
 	pos = GetCurrentPos();
 	if ( pos == -1 )
 		return;
 	line = LineFromPosition ( pos );
-	level = GetFoldLevel ( line );
-
-	for ( int iterator = line; iterator > 0; iterator-- )
-	{
-		if ( iterator != line )
-		{
-			GotoLine ( iterator );
-			level = GetFoldLevel ( iterator );
-		}
 
-		if ( XMLCTRL_HASBIT ( level, wxSTC_FOLDLEVELHEADERFLAG ) )
-		{
-			ToggleFold ( iterator );
-			break;
-		}
-	}
+	// the fold the caret is in, unless the line starts one itself
+	if ( !XMLCTRL_HASBIT ( GetFoldLevel ( line ), wxSTC_FOLDLEVELHEADERFLAG ) )
+		line = GetFoldParent ( line );
+	if ( line < 0 )
+		return;
+	GotoLine ( line );
+	ToggleFold ( line );
 }
 
-// adapted from wxSTEdit (c) 2005 John Labenski, Otto Wyss
+// Sets the expanded state of every fold header in one pass over the fold
+// levels and then shows or hides lines a run at a time, rather than
+// toggling folds one by one, each of which lays out the lines below it
+// again. Headers at depth level or below are expanded, or those at level
+// or above contracted; others are left as they are.
 void XmlCtrl::expandFoldsToLevel ( int level, bool expand )
 {
-	Colourise ( 0, -1 );
+	// fold levels are set as the text is styled
+	if ( xmlLexer.get() )
+		xmlLexer->style ( GetLength() );
+	else
+		Colourise ( 0, -1 );
 
-	const int line_n = GetLineCount();
-	for ( int n = 0; n < line_n; n++ )
+	Freeze();
+
+	const int lineCount = GetLineCount();
+	int hiddenBelow = -1; // fold level of the contracted header hiding lines
+	int runStart = -1; // first of the lines whose visibility is to change
+	bool runVisible = false;
+	for ( int line = 0; line <= lineCount; ++line )
 	{
-		int line_level = GetFoldLevel ( n );
-		if ( XMLCTRL_HASBIT ( line_level, wxSTC_FOLDLEVELHEADERFLAG ) )
+		int lineLevel = 0;
+		bool visible = false;
+		if ( line < lineCount )
 		{
-			line_level -= wxSTC_FOLDLEVELBASE;
-			line_level &= wxSTC_FOLDLEVELNUMBERMASK;
+			lineLevel = GetFoldLevel ( line );
+			int number = lineLevel & wxSTC_FOLDLEVELNUMBERMASK;
+			if ( hiddenBelow >= 0 && !XMLCTRL_HASBIT ( lineLevel, wxSTC_FOLDLEVELWHITEFLAG ) &&
+			        number <= hiddenBelow )
+				hiddenBelow = -1;
+			visible = ( hiddenBelow < 0 );
+		}
 
-			if ( ( ( expand && ( line_level <= level ) ) ||
-			        ( !expand && ( line_level >= level ) ) ) && ( GetFoldExpanded ( n ) != expand ) )
-				ToggleFold ( n );
+		// a run ends where the change it needs differs
+		bool change = ( line < lineCount && GetLineVisible ( line ) != visible );
+		if ( runStart >= 0 && ( !change || visible != runVisible ) )
+		{
+			if ( runVisible )
+				ShowLines ( runStart, line - 1 );
+			else
+				HideLines ( runStart, line - 1 );
+			runStart = -1;
+		}
+		if ( change && runStart < 0 )
+		{
+			runStart = line;
+			runVisible = visible;
 		}
+
+		if ( line == lineCount || !XMLCTRL_HASBIT ( lineLevel, wxSTC_FOLDLEVELHEADERFLAG ) )
+			continue;
+
+		int number = lineLevel & wxSTC_FOLDLEVELNUMBERMASK;
+		int depth = number - wxSTC_FOLDLEVELBASE;
+		bool expanded = GetFoldExpanded ( line );
+		if ( expand && depth <= level )
+			expanded = true;
+		else if ( !expand && depth >= level )
+			expanded = false;
+		if ( expanded != GetFoldExpanded ( line ) )
+			SetFoldExpanded ( line, expanded );
+		if ( !expanded && hiddenBelow < 0 )
+			hiddenBelow = number;
 	}
 
+	Thaw();
 	EnsureCaretVisible(); // seems to keep it in nearly the same place
 }
 
@@ -1777,17 +2029,13 @@ wxString XmlCtrl::getOpenTag ( const wxString& element )
 {
 	wxString openTag;
 	openTag = _T ( "<" ) + element;
-	std::set<wxString> requiredAttributeSet;
-	std::set<wxString>::iterator it;
-	requiredAttributeSet = requiredAttributeMap[element];
-	if ( !requiredAttributeSet.empty() )
+	CompletionDatabase::Range required =
+	    promptMaps->database.getRequiredAttributes ( promptMaps->database.find ( element ) );
+	for ( ; required.begin != required.end; ++required.begin )
 	{
-		for ( it = requiredAttributeSet.begin(); it != requiredAttributeSet.end(); it++ )
-		{
-			openTag += _T ( " " );
-			openTag += *it;
-			openTag += _T ( "=\"\"" );
-		}
+		openTag += _T ( " " );
+		openTag += promptMaps->database.getName ( *required.begin );
+		openTag += _T ( "=\"\"" );
 	}
 	openTag += _T ( ">" );
 	return openTag;
@@ -1925,7 +2173,7 @@ void XmlCtrl::toggleLineBackground()
 
 const std::set<wxString> &XmlCtrl::getEntitySet()
 {
-	return entitySet;
+	return promptMaps->entitySet;
 }
 
 const std::set<std::string> &XmlCtrl::getAttributes ( const wxString& parent )
@@ -1936,32 +2184,24 @@ const std::set<std::string> &XmlCtrl::getAttributes ( const wxString& parent )
 
 wxString XmlCtrl::getElementStructure ( const wxString& element )
 {
-	if ( elementStructureMap.find ( element ) == elementStructureMap.end() )
-	{
-		return wxEmptyString;
-	}
-	return elementStructureMap[element];
+	return promptMaps->database.getStructure ( promptMaps->database.find ( element ) );
 }
 
 bool XmlCtrl::backgroundValidate()
 {
 	if ( !properties.validateAsYouType || type != FILE_TYPE_XML )
 		return true;
+	// no snapshot needed yet
+	if ( !validationRequired || validationThread != NULL )
+		return true;
 
-	std::string bufferUtf8 = myGetTextRaw();
-
-	XmlEncodingHandler::setUtf8( bufferUtf8, true );
-	
-	return backgroundValidate (
-		bufferUtf8.c_str(),
-		basePath,
-		bufferUtf8.size() );
+	// shares the text with the validation thread rather than copying it
+	return backgroundValidate ( snapshotCache->get(), basePath );
 }
 
 bool XmlCtrl::backgroundValidate (
-				const char *buffer,
-				const wxString &system,
-				size_t bufferLen
+				DocumentSnapshotPtr snapshot,
+				const wxString &system
 				)
 {
 	if ( !validationRequired )
@@ -1977,7 +2217,7 @@ bool XmlCtrl::backgroundValidate (
 
 	validationThread = new ValidationThread(
 		GetEventHandler(),
-		buffer,
+		snapshot,
 		system
 	);
 
@@ -1992,11 +2232,6 @@ bool XmlCtrl::backgroundValidate (
 	return true;
 }
 
-std::string XmlCtrl::myGetTextRaw()
-{
-	return ( const char * ) GetTextRaw();
-}
-
 void XmlCtrl::setErrorIndicator ( int line, int column )
 {
 	int startPos, endPos, endStyled;
@@ -2042,6 +2277,9 @@ void XmlCtrl::setValidationRequired ( bool b )
 
 int XmlCtrl::getTagType ( int pos )
 {
+	if ( tagIndex.get() )
+		return tagIndex->getTagType ( pos );
+
 	int iteratorPos;
 
 	// preliminary checks
@@ -2083,6 +2321,10 @@ int XmlCtrl::getTagType ( int pos )
 // fetch style int disregarding indicator
 int XmlCtrl::getLexerStyleAt ( int pos )
 {
+	// XmlLexer only styles what is shown unless asked for more
+	if ( xmlLexer.get() && !xmlLexer->isStyled ( pos ) )
+		xmlLexer->style ( pos + 1 );
+
 	int style = GetStyleAt ( pos );
 	style &= ~wxSTC_INDIC2_MASK;
 	return style;
@@ -27,8 +27,14 @@
 #include <string>
 #include <set>
 #include <map>
+#include <memory>
+#include "documentsnapshot.h"
+#include "promptmaps.h"
 
 class ValidationThread;
+class PromptMapThread;
+class TagIndex;
+class XmlLexer;
 
 struct XmlCtrlProperties
 {
@@ -90,6 +96,9 @@ enum XmlFileTypes
 	FILE_TYPE_BINARY
 };
 
+class XmlPromptGenerator;
+struct DocumentIndex;
+
 class XmlCtrl: public wxStyledTextCtrl
 {
 	public:
@@ -109,13 +118,17 @@ class XmlCtrl: public wxStyledTextCtrl
 		    long style = 0 );
 		~XmlCtrl();
 		int getType();
+		TagIndex *getTagIndex(); // NULL unless type is FILE_TYPE_XML
 		int getParentCloseAngleBracket ( int pos, int range = USHRT_MAX * 4 );
 		void applyProperties (
 		    const XmlCtrlProperties &propertiesParameter,
 		    bool zoomOnly = false );
 		void applyVisibilityState ( int state = SHOW_TAGS );
+		// the prompt maps are compiled on a worker thread; the current
+		// ones stay in use until the new ones are ready
 		void updatePromptMaps();
-		void updatePromptMaps ( const char *buffer, size_t bufferLen );
+		void updatePromptMaps ( XmlPromptGenerator *xpg ); // takes it over
+		void updatePromptMaps ( const DocumentIndex &index );
 		void adjustCursor();
 		void adjustSelection();
 		void foldAll();
@@ -129,7 +142,7 @@ class XmlCtrl: public wxStyledTextCtrl
 		void clearErrorIndicators ( int maxLine = 0 );
 		wxString getParent();
 		wxString getLastElementName ( int pos );
-		const std::set<wxString> &getChildren ( const wxString& parent );
+		void getChildren ( const wxString& parent, wxArrayString &children );
 		const std::set<wxString> &getEntitySet();
 		const std::set<std::string> &getAttributes ( const wxString& parent );
 		wxString getElementStructure ( const wxString& parent );
@@ -137,15 +150,25 @@ class XmlCtrl: public wxStyledTextCtrl
 		int getTagStartPos ( int pos );
 		void toggleLineBackground();
 		bool backgroundValidate (  );
-		bool backgroundValidate (
-			const char *buffer,
-			const wxString &system,
-			size_t bufferLen );
-		std::string myGetTextRaw(); // alternative to faulty stc implementation
+		void loadBuffer ( const char *buffer, size_t bufferLen );
+		void appendBuffer ( const char *buffer, size_t bufferLen );
+		void replaceTextRaw ( const char *buffer, size_t bufferLen );
+		void replaceTextRaw ( const std::string &buffer )
+		{
+			replaceTextRaw ( buffer.c_str(), buffer.size() );
+		}
 		bool getValidationRequired();
 		void setValidationRequired ( bool b );
 	private:
 		ValidationThread *validationThread; // used for background validation
+		PromptMapThread *promptMapThread; // compiles the prompt maps
+		int promptMapRequest; // the last request made of promptMapThread
+		std::auto_ptr<TagIndex> tagIndex; // NULL unless type is FILE_TYPE_XML
+		std::auto_ptr<XmlLexer> xmlLexer; // likewise
+		std::auto_ptr<DocumentSnapshotCache> snapshotCache; // likewise
+		bool backgroundValidate (
+			DocumentSnapshotPtr snapshot,
+			const wxString &system );
 
 		int type;
 		bool *protectTags;
@@ -155,12 +178,7 @@ class XmlCtrl: public wxStyledTextCtrl
 		int currentMaxLine;
 		int lineBackgroundState;
 		wxColour baseBackground, alternateBackground;
-		std::map<wxString, std::map<wxString, std::set<wxString> > >
-		attributeMap;
-		std::map<wxString, std::set<wxString> > requiredAttributeMap;
-		std::map<wxString, std::set<wxString> > elementMap;
-		std::set<wxString> entitySet;
-		std::map<wxString, wxString> elementStructureMap;
+		PromptMapsPtr promptMaps; // shared with documents on the same grammar
 		wxString basePath, auxPath;
 		XmlCtrlProperties properties;
 		wxString getLastAttributeName ( int pos );
@@ -181,9 +199,15 @@ class XmlCtrl: public wxStyledTextCtrl
 		void handleBackspace ( wxKeyEvent& event );
 		void handleDelete ( wxKeyEvent& event );
 		void OnMarginClick ( wxStyledTextEvent& event );
+		void OnModified ( wxStyledTextEvent& event );
+		void OnStyleNeeded ( wxStyledTextEvent& event );
 		void OnChar ( wxKeyEvent& event );
 		void OnIdle ( wxIdleEvent& event );
 		void OnValidationCompleted (wxCommandEvent &event);
+		void OnPromptMapsCompleted ( wxCommandEvent &event );
+		void startPromptMapThread ( PromptMapThread *thread );
+		void takePromptMaps ( PromptMapThread &thread );
+		void cancelPromptMaps();
 		void OnKeyPressed ( wxKeyEvent& event );
 		void OnMouseLeftDown ( wxMouseEvent& event );
 		void OnMouseLeftUp ( wxMouseEvent& event );
@@ -196,6 +220,7 @@ class XmlCtrl: public wxStyledTextCtrl
 		void setColorScheme ( int scheme );
 		void expandFoldsToLevel ( int level, bool expand );
 		void protectHeadLine();
+		void positionCursor();
 
 		DECLARE_NO_COPY_CLASS ( XmlCtrl )
 		DECLARE_EVENT_TABLE()
@@ -18,7 +18,24 @@
  */
 
 #include <wx/filename.h>
+#include <fstream>
+#include <algorithm>
 #include "xmldoc.h"
+#include "largefileindexthread.h"
+#include "wraptempfilename.h"
+#include "wrapzlib.h"
+#include "xmlcopyeditor.h"
+
+// invisible marker on the first line of each block in the window
+#define LARGE_FILE_MARKER 24
+// blocks a window with undoable edits may grow to before it has to move
+#define LARGE_FILE_MAX_WINDOW_BLOCKS 32
+
+BEGIN_EVENT_TABLE ( XmlDoc, XmlCtrl )
+	EVT_IDLE ( XmlDoc::OnIdle )
+	EVT_STC_MODIFIED ( wxID_ANY, XmlDoc::OnModified )
+	EVT_COMMAND ( wxID_ANY, wxEVT_COMMAND_LARGE_FILE_INDEXED, XmlDoc::OnLargeFileIndexed )
+END_EVENT_TABLE()
 
 XmlDoc::XmlDoc (
     wxWindow *parent,
@@ -49,8 +66,22 @@ XmlDoc::XmlDoc (
 		    position,
 		    size,
 		    style )
+		, compressed ( false )
+		, placeholder ( false )
+		, placeholderLargeFile ( false )
+		, placeholderCaret ( 0 )
+		, lastActivated ( 0 )
+		, indexThread ( NULL )
+		, windowBlock ( 0 )
+		, windowChanged ( false )
+		, fileChanged ( false )
 { }
 
+XmlDoc::~XmlDoc()
+{
+	stopIndexing();
+}
+
 wxString& XmlDoc::getDirectory()
 {
 	return directory;
@@ -86,3 +117,464 @@ void XmlDoc::setLastModified ( wxDateTime dt )
 	lastModified = dt;
 }
 
+void XmlDoc::setCompressed ( bool b )
+{
+	compressed = b;
+}
+
+bool XmlDoc::getCompressOnSave ( const wxString &fileName )
+{
+	return ( compressed && fileName == fullFileName ) ||
+	       WrapZlib::isCompressedName ( ( const char * ) fileName.mb_str ( wxConvLocal ) );
+}
+
+
+void XmlDoc::setPlaceholder ( int caret, bool largeFile )
+{
+	placeholder = true;
+	placeholderLargeFile = largeFile;
+	placeholderCaret = caret;
+	SetReadOnly ( true ); // nothing typed can be lost to the load
+}
+
+bool XmlDoc::isPlaceholder()
+{
+	return placeholder;
+}
+
+bool XmlDoc::isLargeFile()
+{
+	return ( placeholder ) ? placeholderLargeFile : isWindowed();
+}
+
+// buffer is NULL for a windowed document, which setLargeFile fills
+void XmlDoc::loadPlaceholder ( const char *buffer, size_t bufferLen )
+{
+	SetReadOnly ( false );
+	if ( buffer )
+		loadBuffer ( buffer, bufferLen );
+}
+
+void XmlDoc::endPlaceholder()
+{
+	placeholder = false;
+	if ( placeholderCaret > 0 && placeholderCaret <= GetLength() )
+		GotoPos ( placeholderCaret );
+}
+
+int XmlDoc::getCaret()
+{
+	return ( placeholder ) ? placeholderCaret : GetCurrentPos();
+}
+
+unsigned long XmlDoc::getLastActivated()
+{
+	return lastActivated;
+}
+
+void XmlDoc::setLastActivated ( unsigned long stamp )
+{
+	lastActivated = stamp;
+}
+
+void XmlDoc::setLargeFile ( BinaryFile *file, const DocumentIndex *index )
+{
+	stopIndexing();
+
+	largeFileIndex.reset();
+	if ( index )
+	{
+		largeFileIndex.reset ( new DocumentIndex ( *index ) );
+	}
+	else if ( IndexCache::get().isEnabled() && !fullFileName.empty() )
+	{
+		largeFileIndex.reset ( new DocumentIndex() );
+		IndexCache::makeKey (
+		    fullFileName,
+		    file->getData(),
+		    file->getDataLen(),
+		    largeFileIndex->key );
+		IndexCache::get().load ( fullFileName, *largeFileIndex );
+	}
+
+	largeFile.reset ( new LargeFile ( file ) );
+	fileChanged = false;
+	if ( largeFileIndex.get() && !largeFileIndex->blockOffsets.empty() )
+		largeFile->restoreIndex (
+		    largeFileIndex->blockOffsets,
+		    largeFileIndex->lastBlockLines );
+	MarkerDefine ( LARGE_FILE_MARKER, wxSTC_MARK_EMPTY );
+
+	windowMarkers.clear();
+	showWindow ( 0 );
+	GotoPos ( 0 );
+	startIndexing();
+}
+
+bool XmlDoc::isWindowed()
+{
+	return largeFile.get() != NULL;
+}
+
+size_t XmlDoc::getWindowLine()
+{
+	return ( largeFile.get() ) ? largeFile->getFirstLine ( windowBlock ) : 0;
+}
+
+bool XmlDoc::isModified()
+{
+	return GetModify() || ( largeFile.get() && largeFile->isModified() );
+}
+
+void XmlDoc::gotoLine ( size_t line )
+{
+	if ( !largeFile.get() )
+	{
+		GotoLine ( ( int ) line );
+		return;
+	}
+
+	commitWindow();
+	showWindow ( largeFile->findBlock ( line ) );
+	GotoLine ( ( int ) ( line - getWindowLine() ) );
+}
+
+bool XmlDoc::findInFile (
+    const std::string &s,
+    int pos,
+    bool matchCase,
+    bool forward )
+{
+	if ( !largeFile.get() || windowMarkers.empty() || !checkFile() )
+		return false;
+
+	commitWindow();
+
+	size_t i = getWindowBlockFromLine ( LineFromPosition ( pos ) );
+	size_t block = windowBlock + i;
+	size_t offset = pos - PositionFromLine ( getWindowBlockLine ( i ) );
+	if ( !largeFile->find ( s, matchCase, forward, block, offset ) )
+		return false;
+
+	showWindow ( block );
+	int start = PositionFromLine ( getWindowBlockLine ( block - windowBlock ) ) +
+	            ( int ) offset;
+	SetTargetStart ( start );
+	SetTargetEnd ( start + ( int ) s.size() );
+	return true;
+}
+
+bool XmlDoc::saveLargeFile ( const wxString &fileName, size_t &bytes )
+{
+	if ( !largeFile.get() || !checkFile() )
+		return false;
+
+	commitWindow();
+
+	wxString tempName = wxFileName::CreateTempFileName ( fileName );
+	if ( tempName.empty() )
+		return false;
+
+	std::string tempNameLocal = ( const char * ) tempName.mb_str ( wxConvLocal );
+
+	// a compressed file is written out plain first and compressed from
+	// the local copy
+	std::auto_ptr<WrapTempFileName> plainName;
+	if ( getCompressOnSave ( fileName ) )
+		plainName.reset ( new WrapTempFileName ( fileName ) );
+
+	std::string writeNameLocal = ( plainName.get() ) ? plainName->name() : tempNameLocal;
+	std::ofstream ofs ( writeNameLocal.c_str(), std::ios::out | std::ios::binary );
+	if ( !ofs || !largeFile->write ( ofs, bytes ) )
+	{
+		ofs.close();
+		wxRemoveFile ( tempName );
+		return false;
+	}
+	ofs.close();
+
+	if ( plainName.get() )
+	{
+		WrapZlib zlib;
+		if ( !zlib.compressFile ( writeNameLocal, tempNameLocal, bytes ) )
+		{
+			wxRemoveFile ( tempName );
+			return false;
+		}
+	}
+
+	size_t line = getWindowLine() + LineFromPosition ( GetCurrentPos() );
+
+	// the old file has to be unmapped before it can be replaced
+	stopIndexing();
+	largeFile.reset();
+	bool renamed = wxRenameFile ( tempName, fileName, true );
+	compressed = ( plainName.get() != NULL );
+
+	// if the file could not be replaced, editing carries on from the copy
+	setLargeFile ( new BinaryFile ( ( renamed ) ? fileName : tempName ) );
+	gotoLine ( line );
+	return renamed;
+}
+
+int XmlDoc::getWindowBlockLine ( size_t i )
+{
+	// a block whose first line has been deleted is empty
+	int line = 0;
+	for ( size_t j = 1; j <= i; ++j )
+	{
+		int next = MarkerLineFromHandle ( windowMarkers[j] );
+		if ( next > line )
+			line = next;
+	}
+	return line;
+}
+
+size_t XmlDoc::getWindowBlockFromLine ( int line )
+{
+	size_t i = windowMarkers.size() - 1;
+	while ( i > 0 && getWindowBlockLine ( i ) > line )
+		--i;
+	return i;
+}
+
+// The mapped file must not be read once someone else has changed it
+bool XmlDoc::checkFile()
+{
+	if ( !largeFile.get() )
+		return true;
+	if ( fileChanged )
+		return false;
+	if ( !largeFile->isFileChanged() )
+		return true;
+
+	fileChanged = true;
+	MyFrame *frame = ( MyFrame * ) GetGrandParent();
+	wxString message;
+	message.Printf (
+	    _ ( "%s has been changed by another application. Reload it to go on editing." ),
+	    fullFileName.c_str() );
+	frame->messagePane ( message, CONST_STOP );
+	return false;
+}
+
+// Shows the block with its neighbours. The undo buffer holds positions in
+// the control, so while the view has edits that can be undone the window
+// grows at its end instead of moving; otherwise (and always when moving
+// back) the edits shown so far go into the overlay and the window is
+// replaced.
+void XmlDoc::showWindow ( size_t block )
+{
+	if ( !checkFile() )
+		return;
+
+	while ( largeFile->getBlockCount() < block + 2 && largeFile->index() )
+		;
+	size_t count = largeFile->getBlockCount();
+	if ( block >= count )
+		block = ( count ) ? count - 1 : 0;
+	size_t first = ( block ) ? block - 1 : 0;
+	size_t last = std::min ( block + 2, count );
+	if ( !windowMarkers.empty() &&
+	        first == windowBlock &&
+	        last - first == windowMarkers.size() )
+		return;
+
+	if ( !windowMarkers.empty() && ( CanUndo() || CanRedo() ) &&
+	        first >= windowBlock &&
+	        last - windowBlock <= LARGE_FILE_MAX_WINDOW_BLOCKS )
+	{
+		appendWindow ( last );
+		return;
+	}
+
+	commitWindow();
+
+	std::string text, blockText;
+	std::vector<int> lines;
+	size_t firstLine = largeFile->getFirstLine ( first );
+	for ( size_t b = first; b < last; ++b )
+	{
+		lines.push_back ( ( int ) ( largeFile->getFirstLine ( b ) - firstLine ) );
+		largeFile->getBlockText ( b, blockText );
+		text += blockText;
+	}
+
+	SetUndoCollection ( false );
+	ClearAll();
+	MarkerDeleteAll ( LARGE_FILE_MARKER );
+#if wxCHECK_VERSION(2,9,0)
+	AddTextRaw ( text.c_str(), text.size() );
+#else
+	SendMsg ( 2001, text.size(), ( wxIntPtr ) text.c_str() );
+#endif
+	SetUndoCollection ( true );
+	EmptyUndoBuffer();
+	SetSavePoint();
+
+	windowBlock = first;
+	windowMarkers.clear();
+	for ( size_t i = 0; i < lines.size(); ++i )
+		windowMarkers.push_back ( MarkerAdd ( lines[i], LARGE_FILE_MARKER ) );
+	windowChanged = false;
+}
+
+// Adds the blocks up to last to the window; appending leaves the positions
+// held in the undo buffer as they were
+void XmlDoc::appendWindow ( size_t last )
+{
+	bool changed = windowChanged;
+	std::string blockText;
+	SetUndoCollection ( false );
+	for ( size_t b = windowBlock + windowMarkers.size(); b < last; ++b )
+	{
+		int line = LineFromPosition ( GetLength() );
+		largeFile->getBlockText ( b, blockText );
+#if wxCHECK_VERSION(2,9,0)
+		AppendTextRaw ( blockText.c_str(), blockText.size() );
+#else
+		SendMsg ( 2282, blockText.size(), ( wxIntPtr ) blockText.c_str() ); // SCI_APPENDTEXT
+#endif
+		windowMarkers.push_back ( MarkerAdd ( line, LARGE_FILE_MARKER ) );
+	}
+	SetUndoCollection ( true );
+	windowChanged = changed;
+}
+
+void XmlDoc::commitWindow()
+{
+	if ( !largeFile.get() || windowMarkers.empty() || !windowChanged || !checkFile() )
+		return;
+
+	size_t count = windowMarkers.size();
+	int start = 0;
+	for ( size_t i = 0; i < count; ++i )
+	{
+		int end = ( i + 1 < count ) ?
+		          PositionFromLine ( getWindowBlockLine ( i + 1 ) ) : GetLength();
+		std::string text;
+		if ( end > start )
+		{
+			wxCharBuffer buffer = GetTextRangeRaw ( start, end );
+			text.assign ( buffer.data(), end - start );
+		}
+		largeFile->setBlockText ( windowBlock + i, text );
+		start = end;
+	}
+	// the save point is left alone, so that undo stays available
+	windowChanged = false;
+}
+
+// Moves the window on once the view reaches its first or last block
+void XmlDoc::updateWindow()
+{
+	if ( !largeFile.get() || windowMarkers.empty() )
+		return;
+
+	int top = DocLineFromVisible ( GetFirstVisibleLine() );
+	int bottom = DocLineFromVisible ( GetFirstVisibleLine() + LinesOnScreen() );
+	size_t last = windowMarkers.size() - 1;
+	size_t block;
+	if ( windowBlock && getWindowBlockFromLine ( top ) == 0 )
+		block = windowBlock;
+	else if ( getWindowBlockFromLine ( bottom ) == last &&
+	          windowBlock + last + 1 < largeFile->getBlockCount() )
+		block = windowBlock + last;
+	else
+		return;
+
+	size_t oldWindowBlock = windowBlock;
+	size_t windowLine = getWindowLine();
+	size_t topLine = windowLine + top;
+	int caret = GetCurrentPos();
+	int caretLine = LineFromPosition ( caret );
+	int column = caret - PositionFromLine ( caretLine );
+	size_t caretFileLine = windowLine + caretLine;
+
+	showWindow ( block );
+	if ( windowBlock == oldWindowBlock )
+		return; // grown at the end only
+
+	// keep the view and the caret where they were in the file
+	windowLine = getWindowLine();
+	if ( caretFileLine >= windowLine &&
+	        caretFileLine < windowLine + GetLineCount() )
+	{
+		int line = ( int ) ( caretFileLine - windowLine );
+		GotoPos ( std::min (
+		              PositionFromLine ( line ) + column,
+		              GetLineEndPosition ( line ) ) );
+	}
+	else
+	{
+		GotoPos ( PositionFromLine ( ( int ) ( topLine - windowLine ) ) );
+	}
+	int visible = VisibleFromDocLine (
+	                  ( topLine > windowLine ) ? ( int ) ( topLine - windowLine ) : 0 );
+	LineScroll ( 0, visible - GetFirstVisibleLine() );
+}
+
+void XmlDoc::startIndexing()
+{
+	if ( indexThread != NULL || largeFile->isIndexed() )
+		return;
+
+	// without the thread, blocks are indexed as they are needed
+	indexThread = new LargeFileIndexThread ( this, largeFile.get() );
+	if ( indexThread->Create() != wxTHREAD_NO_ERROR
+	    || indexThread->Run() != wxTHREAD_NO_ERROR )
+	{
+		delete indexThread;
+		indexThread = NULL;
+	}
+}
+
+void XmlDoc::stopIndexing()
+{
+	if ( indexThread == NULL )
+		return;
+
+	indexThread->Cancel();
+	indexThread->Wait();
+	delete indexThread;
+	indexThread = NULL;
+}
+
+void XmlDoc::OnIdle ( wxIdleEvent& event )
+{
+	event.Skip(); // XmlCtrl::OnIdle
+	updateWindow();
+}
+
+void XmlDoc::OnModified ( wxStyledTextEvent& event )
+{
+	event.Skip(); // XmlCtrl::OnModified
+	if ( event.GetModificationType() &
+	        ( wxSTC_MOD_INSERTTEXT | wxSTC_MOD_DELETETEXT ) )
+		windowChanged = true;
+}
+
+void XmlDoc::OnLargeFileIndexed ( wxCommandEvent& event )
+{
+	int percent = event.GetInt();
+	if ( percent == 100 && largeFile.get() && largeFile->isIndexed() )
+	{
+		stopIndexing();
+
+		// remembered so that the next session can skip indexing
+		if ( largeFileIndex.get()
+		        && largeFile->getIndex (
+		            largeFileIndex->blockOffsets,
+		            largeFileIndex->lastBlockLines ) )
+			IndexCache::get().save ( fullFileName, *largeFileIndex );
+	}
+
+	MyFrame *frame = ( MyFrame * ) GetGrandParent();
+	if ( frame->getActiveDocument() != this )
+		return;
+
+	wxString message;
+	if ( percent < 100 )
+		message.Printf ( _ ( "Indexing %s: %i%%" ), shortFileName.c_str(), percent );
+	frame->statusProgress ( message );
+}
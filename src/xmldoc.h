@@ -23,7 +23,14 @@
 #include <wx/wx.h>
 #include <wx/datetime.h>
 #include <wx/print.h>
+#include <string>
+#include <vector>
+#include <memory>
 #include "xmlctrl.h"
+#include "largefile.h"
+#include "indexcache.h"
+
+class LargeFileIndexThread;
 
 class XmlDoc : public XmlCtrl
 {
@@ -43,6 +50,7 @@ class XmlDoc : public XmlCtrl
 		    const wxPoint& position = wxDefaultPosition,
 		    const wxSize& size = wxDefaultSize,
 		    long style = 0 );
+		~XmlDoc();
 		wxString& getDirectory();
 		wxString& getFullFileName();
 		wxString& getShortFileName();
@@ -51,9 +59,72 @@ class XmlDoc : public XmlCtrl
 		void setFullFileName ( const wxString& s );
 		void setShortFileName ( const wxString& s );
 		void setLastModified ( wxDateTime dt );
+
+		// Windowed editing of a memory-mapped document: the control only
+		// holds the blocks around the view, and edits to other blocks are
+		// kept by the LargeFile. The index may hold the block offsets
+		// from an earlier session.
+		void setLargeFile (
+		    BinaryFile *file, // takes ownership
+		    const DocumentIndex *index = NULL );
+		bool isWindowed();
+		// zero-based line number in the file of the control's first line
+		size_t getWindowLine();
+		bool isModified();
+		void gotoLine ( size_t line );
+		// searches the whole file, starting at pos in the control
+		bool findInFile (
+		    const std::string &s,
+		    int pos,
+		    bool matchCase,
+		    bool forward );
+		bool saveLargeFile ( const wxString &fileName, size_t &bytes );
+
+		// A document read from a gzip-compressed file is written back
+		// compressed, whatever its name; so is any file named *.gz
+		void setCompressed ( bool b );
+		bool getCompressOnSave ( const wxString &fileName );
+
+		// A tab restored from the last session starts out as an empty,
+		// read-only placeholder that only remembers the caret position
+		// and whether the document was windowed
+		void setPlaceholder ( int caret, bool largeFile );
+		bool isPlaceholder();
+		bool isLargeFile(); // windowed, or to be once loaded
+		void loadPlaceholder ( const char *buffer, size_t bufferLen );
+		void endPlaceholder(); // once all of the text is in
+		int getCaret(); // remembered while a placeholder
+		unsigned long getLastActivated();
+		void setLastActivated ( unsigned long stamp );
 	private:
 		wxString directory, fullFileName, shortFileName;
 		wxDateTime lastModified;
+		bool compressed;
+		bool placeholder, placeholderLargeFile;
+		int placeholderCaret;
+		unsigned long lastActivated;
+
+		std::auto_ptr<LargeFile> largeFile;
+		std::auto_ptr<DocumentIndex> largeFileIndex; // NULL if not cached
+		LargeFileIndexThread *indexThread;
+		size_t windowBlock;
+		std::vector<int> windowMarkers; // first line of each block shown
+		int getWindowBlockLine ( size_t i );
+		size_t getWindowBlockFromLine ( int line );
+		bool windowChanged; // since the last commitWindow()
+		bool fileChanged; // by someone else, so the mapping is unusable
+		bool checkFile();
+		void showWindow ( size_t block );
+		void appendWindow ( size_t last );
+		void commitWindow();
+		void updateWindow();
+		void startIndexing();
+		void stopIndexing();
+		void OnIdle ( wxIdleEvent& event );
+		void OnModified ( wxStyledTextEvent& event );
+		void OnLargeFileIndexed ( wxCommandEvent& event );
+
+		DECLARE_EVENT_TABLE()
 };
 
 #endif
@@ -36,20 +36,19 @@ bool XmlEncodingHandler::hasDeclaration ( const std::string& utf8 )
 std::string XmlEncodingHandler::get (
     const std::string& utf8 )
 {
-	if ( !hasDeclaration ( utf8 ) )
-		return "UTF-8";
+	return get ( utf8.data(), utf8.size() );
+}
 
-	size_t len = utf8.size();
-	std::string s;
-	for ( size_t i = 0; i < len; ++i )
-	{
-		s += utf8[i];
-		if ( utf8[i] == '>' )
-			break;
-	}
+std::string XmlEncodingHandler::get ( const char *buffer, size_t len )
+{
+	if ( len < 6 || strncmp ( buffer, "<?xml", 5 ) )
+		return "UTF-8";
 
-	if ( s.find ( ">" ) == std::string::npos )
+	// only the declaration is needed
+	const char *end = ( const char * ) memchr ( buffer, '>', len );
+	if ( !end )
 		return "";
+	std::string s ( buffer, end + 1 );
 
 	s = CaseHandler::lowerCase ( s );
 
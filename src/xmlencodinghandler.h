@@ -29,6 +29,7 @@ class XmlEncodingHandler
 	public:
 		static std::string get (
 		    const std::string& utf8 );
+		static std::string get ( const char *buffer, size_t len );
 		static bool setUtf8 ( std::string& utf8, bool ignoreCurrentEncoding = false );
 		static bool set ( std::string& buffer, std::string& encoding );
 		static bool hasDeclaration ( const std::string& utf8 );
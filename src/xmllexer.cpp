@@ -0,0 +1,530 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cstring>
+#include <climits>
+#include "xmllexer.h"
+
+// the styles are kept in the bits below the error indicator
+static const int STYLE_MASK = 0x1f;
+
+// lines are read from the control in blocks that start small, since the
+// lexer mostly stops a line or two after an edit, and grow
+static const int LEX_FIRST_BLOCK_SIZE = 1024;
+static const int LEX_BLOCK_SIZE = 64 * 1024;
+
+// A line state holds one of these, flags for the markup it belongs to and
+// the depth of element nesting, which gives the fold level
+enum
+{
+	LEX_TEXT,
+	LEX_TAG, // among the attributes of a start tag or processing instruction
+	LEX_VALUE, // after an attribute's '='
+	LEX_DOUBLE,
+	LEX_SINGLE,
+	LEX_CLOSE_TAG,
+	LEX_COMMENT,
+	LEX_CDATA,
+	LEX_DECLARATION,
+	LEX_DECLARATION_DOUBLE,
+	LEX_DECLARATION_SINGLE,
+	LEX_SUBSET, // between the declarations of an internal subset
+	LEX_SUBSET_COMMENT,
+	LEX_SUBSET_PI
+};
+
+static const int LEX_STATE_MASK = 0x1f;
+static const int LEX_IN_PI = 0x20; // LEX_TAG and values end at "?>"
+static const int LEX_IN_SUBSET = 0x40; // LEX_DECLARATION returns to LEX_SUBSET
+static const int LEX_FLAG_MASK = LEX_IN_PI | LEX_IN_SUBSET;
+static const int LEX_DEPTH_SHIFT = 8;
+
+static inline bool isNameChar ( char c )
+{
+	return ( c >= 'a' && c <= 'z' ) ||
+	       ( c >= 'A' && c <= 'Z' ) ||
+	       ( c >= '0' && c <= '9' ) ||
+	       c == '_' || c == ':' || c == '-' || c == '.' ||
+	       ( unsigned char ) c >= 0x80;
+}
+
+static inline bool isSpace ( char c )
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool matchAt ( const char *text, int len, int i, const char *s )
+{
+	int n = strlen ( s );
+	return i + n <= len && !memcmp ( text + i, s, n );
+}
+
+// end of the run of name characters starting at i
+static inline int skipName ( const char *text, int len, int i )
+{
+	while ( i < len && isNameChar ( text[i] ) )
+		++i;
+	return i;
+}
+
+// end of a reference such as "&amp;" or "%pe;" starting at i, or i + 1
+// if there is none
+static inline int skipReference ( const char *text, int len, int i )
+{
+	int j = i + 1;
+	if ( j < len && text[j] == '#' )
+		++j;
+	j = skipName ( text, len, j );
+	return ( j > i + 1 && j < len && text[j] == ';' ) ? j + 1 : i + 1;
+}
+
+XmlLexer::XmlLexer ( wxStyledTextCtrl *ctrlParameter )
+	: ctrl ( ctrlParameter )
+	, fold ( false )
+	, validEnd ( 0 )
+	, changedEnd ( -1 )
+{
+}
+
+void XmlLexer::setFold ( bool foldParameter )
+{
+	if ( fold == foldParameter )
+		return;
+	fold = foldParameter;
+	restyle();
+}
+
+void XmlLexer::restyle()
+{
+	validEnd = 0;
+	changedEnd = -1;
+	ctrl->StartStyling ( 0, STYLE_MASK ); // leaves nothing styled
+}
+
+void XmlLexer::insert ( int pos, int len )
+{
+	if ( pos < validEnd )
+		validEnd += len;
+	if ( changedEnd > pos )
+		changedEnd += len;
+	if ( changedEnd < pos + len )
+		changedEnd = pos + len;
+}
+
+void XmlLexer::remove ( int pos, int len )
+{
+	if ( validEnd > pos )
+		validEnd = ( validEnd > pos + len ) ? validEnd - len : pos;
+	if ( changedEnd > pos )
+		changedEnd = ( changedEnd > pos + len ) ? changedEnd - len : pos;
+	if ( changedEnd < pos )
+		changedEnd = pos;
+}
+
+int XmlLexer::getLineEnd ( int line )
+{
+	return ( line + 1 < ctrl->GetLineCount() ) ?
+	       ctrl->PositionFromLine ( line + 1 ) : ctrl->GetLength();
+}
+
+void XmlLexer::style ( int pos )
+{
+	int line = ctrl->LineFromPosition ( ctrl->GetEndStyled() );
+	int lastLine = ctrl->LineFromPosition ( pos );
+	int state = ( line > 0 ) ? ctrl->GetLineState ( line - 1 ) : LEX_TEXT;
+	bool stateChanged = false;
+	int end = 0, blockSize = LEX_FIRST_BLOCK_SIZE;
+
+	while ( line <= lastLine )
+	{
+		int start = ctrl->PositionFromLine ( line );
+		int blockLastLine = ctrl->LineFromPosition ( start + blockSize );
+		if ( blockLastLine > lastLine )
+			blockLastLine = lastLine;
+		int blockEnd = getLineEnd ( blockLastLine );
+
+		wxCharBuffer text;
+		if ( blockEnd > start )
+			text = ctrl->GetTextRangeRaw ( start, blockEnd );
+		styles.resize ( blockEnd - start );
+		if ( blockSize < LEX_BLOCK_SIZE )
+			blockSize *= 2;
+
+		end = start;
+		int resume = -1;
+		while ( line <= blockLastLine )
+		{
+			int lineEnd = getLineEnd ( line );
+			bool blank;
+			int newState = lexLine (
+			                   text.data() + end - start,
+			                   lineEnd - end,
+			                   state,
+			                   ( lineEnd > end ) ? &styles[end - start] : NULL,
+			                   blank );
+			if ( fold )
+				setFoldLevel ( line, state, newState, blank );
+
+			// a line past the edit that ends as it did before means the
+			// rest of the styled text is unchanged; the line holding the
+			// end of the edit has lost its old state
+			int oldState = ctrl->GetLineState ( line );
+			stateChanged = oldState != newState ||
+			               ( changedEnd >= 0 && end <= changedEnd );
+			if ( oldState != newState )
+				ctrl->SetLineState ( line, newState );
+			bool converged = !stateChanged && lineEnd < validEnd;
+
+			state = newState;
+			end = lineEnd;
+			++line;
+
+			if ( converged )
+			{
+				resume = ctrl->LineFromPosition ( validEnd );
+				break;
+			}
+		}
+
+		if ( end > start )
+		{
+			ctrl->StartStyling ( start, STYLE_MASK );
+			ctrl->SetStyleBytes ( end - start, &styles[0] );
+		}
+		if ( end > validEnd )
+			validEnd = end;
+		if ( changedEnd >= 0 &&
+		        ( end > changedEnd || end == ctrl->GetLength() ) )
+			changedEnd = -1;
+
+		if ( resume > line )
+		{
+			line = resume;
+			state = ctrl->GetLineState ( line - 1 );
+			ctrl->StartStyling ( ctrl->PositionFromLine ( line ), STYLE_MASK );
+			stateChanged = false;
+			blockSize = LEX_FIRST_BLOCK_SIZE;
+		}
+	}
+
+	// the styles after a line whose state has changed were set from its
+	// old state, so they cannot be skipped to
+	if ( stateChanged && end < validEnd && changedEnd < end )
+		changedEnd = end;
+}
+
+bool XmlLexer::isStyled ( int pos )
+{
+	int end = ctrl->GetEndStyled();
+	if ( changedEnd < 0 )
+		return pos < end;
+
+	// the style of a character can depend on those after it, so the
+	// styles on the line of an edit are not to be trusted
+	return pos < ctrl->PositionFromLine ( ctrl->LineFromPosition ( end ) );
+}
+
+void XmlLexer::setFoldLevel ( int line, int state, int newState, bool blank )
+{
+	int depth = state >> LEX_DEPTH_SHIFT;
+	int newDepth = newState >> LEX_DEPTH_SHIFT;
+
+	int level = wxSTC_FOLDLEVELBASE + depth;
+	if ( level > wxSTC_FOLDLEVELNUMBERMASK )
+		level = wxSTC_FOLDLEVELNUMBERMASK;
+	if ( blank )
+		level |= wxSTC_FOLDLEVELWHITEFLAG;
+	else if ( newDepth > depth )
+		level |= wxSTC_FOLDLEVELHEADERFLAG;
+
+	if ( ctrl->GetFoldLevel ( line ) != level )
+		ctrl->SetFoldLevel ( line, level );
+}
+
+// Styles one line, which takes in the given state, and returns the state
+// it ends in
+int XmlLexer::lexLine (
+    const char *text,
+    int len,
+    int state,
+    char *lineStyles,
+    bool &blank )
+{
+	int depth = state >> LEX_DEPTH_SHIFT;
+	int flags = state & LEX_FLAG_MASK;
+	state &= LEX_STATE_MASK;
+	blank = true;
+
+	int i = 0, next, style;
+	while ( i < len )
+	{
+		char c = text[i];
+		if ( !isSpace ( c ) )
+			blank = false;
+		next = i + 1;
+
+		switch ( state )
+		{
+			case LEX_TEXT:
+				style = wxSTC_H_DEFAULT;
+				if ( c == '<' )
+				{
+					if ( matchAt ( text, len, i, "<!--" ) )
+					{
+						style = wxSTC_H_COMMENT;
+						next = i + 4;
+						state = LEX_COMMENT;
+					}
+					else if ( matchAt ( text, len, i, "<![CDATA[" ) )
+					{
+						style = wxSTC_H_CDATA;
+						next = i + 9;
+						state = LEX_CDATA;
+					}
+					else if ( matchAt ( text, len, i, "<!" ) )
+					{
+						memset ( lineStyles + i, wxSTC_H_SGML_DEFAULT, 2 );
+						i += 2;
+						style = wxSTC_H_SGML_COMMAND;
+						next = skipName ( text, len, i );
+						state = LEX_DECLARATION;
+					}
+					else if ( matchAt ( text, len, i, "<?" ) )
+					{
+						style = wxSTC_H_XMLSTART;
+						next = skipName ( text, len, i + 2 );
+						state = LEX_TAG;
+						flags = LEX_IN_PI;
+					}
+					else if ( matchAt ( text, len, i, "</" ) )
+					{
+						style = wxSTC_H_TAG;
+						next = skipName ( text, len, i + 2 );
+						state = LEX_CLOSE_TAG;
+					}
+					else
+					{
+						style = wxSTC_H_TAG;
+						next = skipName ( text, len, i + 1 );
+						state = LEX_TAG;
+					}
+				}
+				else if ( c == '&' )
+				{
+					next = skipReference ( text, len, i );
+					if ( next > i + 1 )
+						style = wxSTC_H_ENTITY;
+				}
+				break;
+			case LEX_TAG:
+				style = wxSTC_H_OTHER;
+				if ( flags & LEX_IN_PI )
+				{
+					if ( matchAt ( text, len, i, "?>" ) )
+					{
+						style = wxSTC_H_XMLEND;
+						next = i + 2;
+						state = LEX_TEXT;
+						flags = 0;
+					}
+				}
+				else if ( c == '>' )
+				{
+					style = wxSTC_H_TAG;
+					state = LEX_TEXT;
+					++depth;
+				}
+				else if ( matchAt ( text, len, i, "/>" ) )
+				{
+					style = wxSTC_H_TAGEND;
+					next = i + 2;
+					state = LEX_TEXT;
+				}
+				if ( state != LEX_TAG )
+					break;
+				if ( c == '=' )
+					state = LEX_VALUE;
+				else if ( isNameChar ( c ) )
+				{
+					style = wxSTC_H_ATTRIBUTE;
+					next = skipName ( text, len, i );
+				}
+				break;
+			case LEX_VALUE:
+				style = wxSTC_H_OTHER;
+				if ( c == '"' )
+				{
+					style = wxSTC_H_DOUBLESTRING;
+					state = LEX_DOUBLE;
+				}
+				else if ( c == '\'' )
+				{
+					style = wxSTC_H_SINGLESTRING;
+					state = LEX_SINGLE;
+				}
+				else if ( !isSpace ( c ) )
+				{
+					// not a value after all
+					state = LEX_TAG;
+					continue;
+				}
+				break;
+			case LEX_DOUBLE:
+			case LEX_SINGLE:
+				if ( ( flags & LEX_IN_PI ) && matchAt ( text, len, i, "?>" ) )
+				{
+					style = wxSTC_H_XMLEND;
+					next = i + 2;
+					state = LEX_TEXT;
+					flags = 0;
+					break;
+				}
+				style = ( state == LEX_DOUBLE ) ?
+				        wxSTC_H_DOUBLESTRING : wxSTC_H_SINGLESTRING;
+				if ( c == ( ( state == LEX_DOUBLE ) ? '"' : '\'' ) )
+					state = LEX_TAG;
+				break;
+			case LEX_CLOSE_TAG:
+				style = wxSTC_H_TAG;
+				if ( c == '>' )
+				{
+					state = LEX_TEXT;
+					if ( depth > 0 )
+						--depth;
+				}
+				break;
+			case LEX_COMMENT:
+				style = wxSTC_H_COMMENT;
+				if ( matchAt ( text, len, i, "-->" ) )
+				{
+					next = i + 3;
+					state = LEX_TEXT;
+				}
+				break;
+			case LEX_CDATA:
+				style = wxSTC_H_CDATA;
+				if ( matchAt ( text, len, i, "]]>" ) )
+				{
+					next = i + 3;
+					state = LEX_TEXT;
+				}
+				break;
+			case LEX_DECLARATION:
+				style = wxSTC_H_SGML_DEFAULT;
+				if ( c == '"' )
+				{
+					style = wxSTC_H_SGML_DOUBLESTRING;
+					state = LEX_DECLARATION_DOUBLE;
+				}
+				else if ( c == '\'' )
+				{
+					style = wxSTC_H_SGML_SIMPLESTRING;
+					state = LEX_DECLARATION_SINGLE;
+				}
+				else if ( c == '[' && ! ( flags & LEX_IN_SUBSET ) )
+				{
+					style = wxSTC_H_SGML_BLOCK_DEFAULT;
+					state = LEX_SUBSET;
+				}
+				else if ( c == '>' )
+				{
+					state = ( flags & LEX_IN_SUBSET ) ? LEX_SUBSET : LEX_TEXT;
+					flags = 0;
+				}
+				else if ( c == '%' && ( next = skipReference ( text, len, i ) ) > i + 1 )
+					style = wxSTC_H_SGML_ENTITY;
+				else if ( c == '#' )
+				{
+					style = wxSTC_H_SGML_SPECIAL;
+					next = skipName ( text, len, i + 1 );
+				}
+				break;
+			case LEX_DECLARATION_DOUBLE:
+				style = wxSTC_H_SGML_DOUBLESTRING;
+				if ( c == '"' )
+					state = LEX_DECLARATION;
+				break;
+			case LEX_DECLARATION_SINGLE:
+				style = wxSTC_H_SGML_SIMPLESTRING;
+				if ( c == '\'' )
+					state = LEX_DECLARATION;
+				break;
+			case LEX_SUBSET:
+				style = wxSTC_H_SGML_BLOCK_DEFAULT;
+				if ( matchAt ( text, len, i, "<!--" ) )
+				{
+					style = wxSTC_H_SGML_COMMENT;
+					next = i + 4;
+					state = LEX_SUBSET_COMMENT;
+				}
+				else if ( matchAt ( text, len, i, "<?" ) )
+				{
+					style = wxSTC_H_QUESTION;
+					next = i + 2;
+					state = LEX_SUBSET_PI;
+				}
+				else if ( matchAt ( text, len, i, "<!" ) )
+				{
+					memset ( lineStyles + i, wxSTC_H_SGML_DEFAULT, 2 );
+					i += 2;
+					style = wxSTC_H_SGML_COMMAND;
+					next = skipName ( text, len, i );
+					state = LEX_DECLARATION;
+					flags = LEX_IN_SUBSET;
+				}
+				else if ( c == ']' )
+					state = LEX_DECLARATION;
+				else if ( c == '%' && ( next = skipReference ( text, len, i ) ) > i + 1 )
+					style = wxSTC_H_SGML_ENTITY;
+				break;
+			case LEX_SUBSET_COMMENT:
+				style = wxSTC_H_SGML_COMMENT;
+				if ( matchAt ( text, len, i, "-->" ) )
+				{
+					next = i + 3;
+					state = LEX_SUBSET;
+				}
+				break;
+			case LEX_SUBSET_PI:
+				style = wxSTC_H_QUESTION;
+				if ( matchAt ( text, len, i, "?>" ) )
+				{
+					next = i + 2;
+					state = LEX_SUBSET;
+				}
+				break;
+			default: // not a state of this lexer
+				style = wxSTC_H_DEFAULT;
+				state = LEX_TEXT;
+				flags = 0;
+				break;
+		}
+
+		if ( next > len )
+			next = len;
+		if ( next > i )
+			memset ( lineStyles + i, style, next - i );
+		i = next;
+	}
+
+	if ( depth > ( INT_MAX >> LEX_DEPTH_SHIFT ) )
+		depth = INT_MAX >> LEX_DEPTH_SHIFT;
+	return state | flags | ( depth << LEX_DEPTH_SHIFT );
+}
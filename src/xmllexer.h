@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef XML_LEXER_H
+#define XML_LEXER_H
+
+#include <wx/wx.h>
+#include <wx/stc/stc.h>
+#include <vector>
+
+// Styles XML in a control set to wxSTC_LEX_CONTAINER. The styles are the
+// wxSTC_H_* styles of Scintilla's HTML lexer, so the colour schemes and
+// the XmlCtrl code that reads styles work as before.
+//
+// The lexer is a state machine whose state at the end of every line is
+// kept with SetLineState, so it can start again at any line. After an
+// edit it restyles from the edited line only until a line beyond the edit
+// ends in the same state as it did before; the styles after that line are
+// still good and are passed over.
+class XmlLexer
+{
+	public:
+		XmlLexer ( wxStyledTextCtrl *ctrl );
+		void setFold ( bool fold );
+		// styles whole lines from the end of the styled text up to pos, in
+		// answer to EVT_STC_STYLENEEDED
+		void style ( int pos );
+		// true if the style at pos is up to date
+		bool isStyled ( int pos );
+		// drops all styling, which is redone as the text is shown
+		void restyle();
+
+		// to be called after text has been inserted or deleted
+		void insert ( int pos, int len );
+		void remove ( int pos, int len );
+	private:
+		wxStyledTextCtrl *ctrl;
+		bool fold;
+		int validEnd; // styles and line states before this are up to date
+		int changedEnd; // end of the text edited since it was styled, or -1
+		std::vector<char> styles;
+
+		int getLineEnd ( int line );
+		void setFoldLevel ( int line, int state, int newState, bool blank );
+		static int lexLine (
+		    const char *text,
+		    int len,
+		    int state,
+		    char *lineStyles,
+		    bool &blank );
+};
+
+#endif
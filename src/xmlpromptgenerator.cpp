@@ -25,24 +25,12 @@
 #include "readfile.h"
 #include "replace.h"
 #include "pathresolver.h"
+#include "schemacache.h"
+#include "indexcache.h"
 
 #undef XMLCALL
 #include "catalogresolver.h"
 
-// Xerces-C req'd for Schema parsing
-#include "wrapxerces.h" // Declaration of toString() and XERCES_TMPLSINC definition
-
-#include <xercesc/util/NameIdPool.hpp>
-#include <xercesc/util/PlatformUtils.hpp>
-#include <xercesc/framework/XMLValidator.hpp>
-#include <xercesc/parsers/SAXParser.hpp>
-#include <xercesc/parsers/XercesDOMParser.hpp>
-#include <xercesc/validators/schema/SchemaValidator.hpp>
-#include <xercesc/validators/common/ContentSpecNode.hpp>
-#include <xercesc/validators/schema/SchemaSymbols.hpp>
-
-using namespace xercesc;
-
 XmlPromptGenerator::XmlPromptGenerator (
     const wxString& basePath,
     const wxString& auxPath ) : d ( new PromptGeneratorData() )
@@ -53,6 +41,9 @@ XmlPromptGenerator::XmlPromptGenerator (
 	d->auxPath = auxPath;
 	d->isRootElement = true;
 	d->grammarFound = false;
+	d->isListener = false;
+	d->hasInternalSubset = false;
+	d->dtdDepth = 0;
 	d->attributeValueCutoff = 12; // this prevents enums being stored in their thousands
 	XML_SetParamEntityParsing ( p, XML_PARAM_ENTITY_PARSING_UNLESS_STANDALONE );
 	XML_SetElementHandler ( p, starthandler, endhandler );
@@ -71,6 +62,112 @@ XmlPromptGenerator::XmlPromptGenerator (
 XmlPromptGenerator::~XmlPromptGenerator()
 {}
 
+// Shares the parser of an XmlSaxDispatcher instead of using its own
+void XmlPromptGenerator::attach ( XML_Parser parser )
+{
+	d->p = parser;
+	d->isListener = true;
+	XML_SetParamEntityParsing ( parser, XML_PARAM_ENTITY_PARSING_UNLESS_STANDALONE );
+	XML_SetBase ( parser, d->basePath.utf8_str() );
+
+	if ( !d->auxPath.empty() )
+		XML_UseForeignDTD ( parser, true );
+}
+
+bool XmlPromptGenerator::isDone()
+{
+	return d->grammarFound;
+}
+
+void XmlPromptGenerator::startElement (
+    const XML_Char *el,
+    const XML_Char **attr )
+{
+	starthandler ( d.get(), el, attr );
+}
+
+void XmlPromptGenerator::endElement ( const XML_Char *el )
+{
+	endhandler ( d.get(), el );
+}
+
+void XmlPromptGenerator::startDoctypeDecl (
+    const XML_Char *doctypeName,
+    const XML_Char *sysid,
+    const XML_Char *pubid,
+    int has_internal_subset )
+{
+	doctypedeclstarthandler ( d.get(), doctypeName, sysid, pubid, has_internal_subset );
+}
+
+void XmlPromptGenerator::endDoctypeDecl()
+{
+	doctypedeclendhandler ( d.get() );
+}
+
+void XmlPromptGenerator::elementDecl (
+    const XML_Char *name,
+    XML_Content *model )
+{
+	wxString myElement ( name, wxConvUTF8 );
+
+	getContent ( *model, d->elementStructureMap[myElement], d->elementMap[myElement] );
+}
+
+void XmlPromptGenerator::attlistDecl (
+    const XML_Char *elname,
+    const XML_Char *attname,
+    const XML_Char *att_type,
+    const XML_Char *dflt,
+    int isrequired )
+{
+	attlistdeclhandler ( d.get(), elname, attname, att_type, dflt, isrequired );
+}
+
+void XmlPromptGenerator::entityDecl (
+    const XML_Char *entityName,
+    int is_parameter_entity,
+    const XML_Char *value,
+    int value_length,
+    const XML_Char *base,
+    const XML_Char *systemId,
+    const XML_Char *publicId,
+    const XML_Char *notationName )
+{
+	entitydeclhandler (
+	    d.get(),
+	    entityName,
+	    is_parameter_entity,
+	    value,
+	    value_length,
+	    base,
+	    systemId,
+	    publicId,
+	    notationName );
+}
+
+bool XmlPromptGenerator::externalEntityRef (
+    const XML_Char *context,
+    const XML_Char *base,
+    const XML_Char *systemId,
+    const XML_Char *publicId )
+{
+	return externalentityrefhandler (
+	           ( XML_Parser ) d.get(),
+	           context,
+	           base,
+	           systemId,
+	           publicId ) == XML_STATUS_OK;
+}
+
+// Stops collecting once a grammar has supplied the prompts; a listener
+// leaves the shared parser running for the others
+void XmlPromptGenerator::stop ( PromptGeneratorData *d )
+{
+	if ( !d->isListener )
+		XML_StopParser ( d->p, false );
+}
+
 void XMLCALL XmlPromptGenerator::starthandler (
     void *data,
     const XML_Char *el,
@@ -87,14 +184,14 @@ void XMLCALL XmlPromptGenerator::starthandler (
 		if ( ! (d->elementMap.empty() )  )//if ( d->elementMap.size() == 1) // must be 1 for success
 		{
 			d->grammarFound = true;
-			XML_StopParser ( d->p, false );
+			stop ( d );
 			return;
 		}
 	}
 
 	d->push ( el );
 
-	wxString parent ( d->getParent().c_str(), wxConvUTF8 );
+	wxString parent ( d->getParent(), wxConvUTF8 );
 	wxString element ( el, wxConvUTF8 );
 
 	// update elementMap
@@ -125,6 +222,12 @@ bool XmlPromptGenerator::getGrammarFound()
 	return d->grammarFound;
 }
 
+void XmlPromptGenerator::getGrammarFiles (
+    std::vector<std::pair<wxString, long long> > &grammarFiles )
+{
+	grammarFiles = d->grammarFiles;
+}
+
 void XmlPromptGenerator::getAttributeMap (
     std::map<wxString, std::map<wxString, std::set<wxString> > >
     &attributeMap )
@@ -156,6 +259,34 @@ void XmlPromptGenerator::getElementStructureMap (
 	elementStructureMap = d->elementStructureMap;
 }
 
+// Builds the prompt maps straight from the generator's own, unless a
+// document using the same grammar holds them already. The entity set is
+// moved rather than copied, so this is to be called once, when the
+// generator has been fed the whole document.
+PromptMapsPtr XmlPromptGenerator::getPromptMaps()
+{
+	bool shared = d->grammarFound && !d->grammarKey.empty();
+	if ( shared )
+	{
+		PromptMapsPtr maps = PromptMapsCache::get().find ( d->grammarKey );
+		if ( maps )
+			return maps;
+	}
+
+	boost::shared_ptr<PromptMaps> maps ( new PromptMaps() );
+	maps->database.build (
+	    d->attributeMap,
+	    d->requiredAttributeMap,
+	    d->elementMap,
+	    d->elementStructureMap );
+	maps->entitySet.swap ( d->entitySet );
+	maps->addPredefinedEntities();
+
+	if ( shared )
+		return PromptMapsCache::get().add ( d->grammarKey, maps );
+	return maps;
+}
+
 // handlers for DOCTYPE handling
 
 void XMLCALL XmlPromptGenerator::doctypedeclstarthandler (
@@ -167,6 +298,7 @@ void XMLCALL XmlPromptGenerator::doctypedeclstarthandler (
 {
 	PromptGeneratorData *d;
 	d = ( PromptGeneratorData * ) data;
+	d->hasInternalSubset = has_internal_subset != 0;
 }
 
 void XMLCALL XmlPromptGenerator::doctypedeclendhandler ( void *data )
@@ -176,7 +308,7 @@ void XMLCALL XmlPromptGenerator::doctypedeclendhandler ( void *data )
 	if ( !d->elementMap.empty() )
 	{
 		d->grammarFound = true;
-		XML_StopParser ( d->p, false ); // experimental
+		stop ( d ); // experimental
 	}
 }
 
@@ -287,6 +419,20 @@ void XMLCALL XmlPromptGenerator::attlistdeclhandler (
 	}
 }
 
+// Names an external DTD and the version of every file read for it
+static wxString getDtdKey (
+    const wxString &publicId,
+    const wxString &systemId,
+    const std::vector<std::pair<wxString, long long> > &files )
+{
+	wxString key = _T ( "dtd\n" ) + publicId + _T ( "\n" ) + systemId;
+	std::vector<std::pair<wxString, long long> >::const_iterator it;
+	for ( it = files.begin(); it != files.end(); ++it )
+		key += _T ( "\n" ) + it->first + wxString::Format (
+		           _T ( "\t%" ) wxLongLongFmtSpec _T ( "d" ), it->second );
+	return key;
+}
+
 int XMLCALL XmlPromptGenerator::externalentityrefhandler (
     XML_Parser p,
     const XML_Char *context,
@@ -298,62 +444,132 @@ int XMLCALL XmlPromptGenerator::externalentityrefhandler (
 	d = ( PromptGeneratorData * ) p; // arg is set to user data in c'tor
 
 	int ret;
-	std::string buffer;
+	std::auto_ptr<BinaryFile> file;
 
 	// auxPath req'd?
-	if ( !systemId && !publicId )
+	bool foreign = !systemId && !publicId;
+	wxString widePublicId, wideSystemId;
+	if ( foreign )
+	{
+		wideSystemId = d->auxPath;
+	}
+	else
 	{
-		ReadFile::run ( ( const char * ) d->auxPath.mb_str(), buffer );
-		if ( buffer.empty() )
+		widePublicId = wxString ( publicId, wxConvUTF8 );
+		wideSystemId = wxString ( systemId, wxConvUTF8 );
+		CatalogResolver cr;
+		wideSystemId = cr.catalogResolve ( widePublicId, wideSystemId );
+
+		if ( wideSystemId.empty() )
 		{
-			return XML_STATUS_ERROR;
+			if ( systemId )
+				wideSystemId = wxString ( systemId, wxConvUTF8 );
+			if ( base )
+			{
+				wxString test = PathResolver::run ( wideSystemId,
+						wxString ( base, wxConvUTF8 ) );
+				if ( !test.empty() )
+				{
+					wideSystemId = test;
+				}
+			}
 		}
+	}
 
-		d->encoding = XmlEncodingHandler::get ( buffer );
-		XML_Parser dtdParser = XML_ExternalEntityParserCreate ( d->p, context, d->encoding.c_str() );
-		if ( !dtdParser )
-			return XML_STATUS_ERROR;
-		XML_SetBase ( dtdParser, d->auxPath.utf8_str() );
-		ret = XML_Parse ( dtdParser, buffer.c_str(), buffer.size(), true );
-		XML_ParserFree ( dtdParser );
-		return ret;
+	// what the outermost DTD yields only depends on its own files if
+	// nothing has been declared before it
+	bool cacheable = d->dtdDepth == 0 &&
+	                 !d->hasInternalSubset &&
+	                 !wideSystemId.empty() &&
+	                 d->elementMap.empty() &&
+	                 d->attributeMap.empty() &&
+	                 d->entitySet.empty();
+	if ( cacheable )
+	{
+		GrammarIndex index;
+		if ( IndexCache::get().loadGrammar ( widePublicId, wideSystemId, index ) )
+		{
+			d->attributeMap.swap ( index.attributeMap );
+			d->requiredAttributeMap.swap ( index.requiredAttributeMap );
+			d->elementMap.swap ( index.elementMap );
+			d->elementStructureMap.swap ( index.elementStructureMap );
+			d->entitySet.swap ( index.entitySet );
+			d->grammarKey = getDtdKey ( widePublicId, wideSystemId, index.files );
+			d->grammarFiles.insert ( d->grammarFiles.end(),
+			                         index.files.begin(), index.files.end() );
+			return XML_STATUS_OK;
+		}
 	}
+	if ( d->dtdDepth == 0 )
+		d->dtdFiles.clear();
 
-	wxString widePublicId ( publicId, wxConvUTF8 );
-	wxString wideSystemId ( systemId, wxConvUTF8 );
-	CatalogResolver cr;
-	wideSystemId = cr.catalogResolve ( widePublicId, wideSystemId );
+	if ( foreign )
+	{
+		file.reset ( ReadFile::view ( ( const char * ) d->auxPath.mb_str() ) );
+		if ( !file.get() || !file->getDataLen() )
+		{
+			return XML_STATUS_ERROR;
+		}
 
-	if ( wideSystemId.empty() )
+		d->encoding = XmlEncodingHandler::get ( file->getData(), file->getDataLen() );
+		ret = parseExternalEntity ( d, context, d->auxPath, d->encoding,
+		        file->getData(), file->getDataLen() );
+	}
+	else
 	{
-		if ( systemId )
-			wideSystemId = wxString ( systemId, wxConvUTF8 );
-		if ( base )
+		std::string localName;
+		localName = wideSystemId.mb_str ( wxConvLocal );
+		if ( !localName.empty() )
 		{
-			wxString test = PathResolver::run ( wideSystemId,
-					wxString ( base, wxConvUTF8 ) );
-			if ( !test.empty() )
-			{
-				wideSystemId = test;
-			}
+			file.reset ( ReadFile::view ( localName ) );
 		}
+		const char *buffer = ( file.get() ) ? file->getData() : "";
+		size_t bufferLen = ( file.get() ) ? file->getDataLen() : 0;
+
+		std::string encoding = XmlEncodingHandler::get ( buffer, bufferLen );
+		ret = parseExternalEntity ( d, context, wideSystemId, encoding,
+		        buffer, bufferLen );
 	}
 
-	std::string localName;
-	localName = wideSystemId.mb_str ( wxConvLocal );
-	if ( !localName.empty() )
+	if ( cacheable && ret == XML_STATUS_OK && !d->elementMap.empty() )
 	{
-		ReadFile::run ( localName, buffer );
+		d->grammarKey = getDtdKey ( widePublicId, wideSystemId, d->dtdFiles );
+
+		GrammarIndex index;
+		index.files = d->dtdFiles;
+		index.attributeMap = d->attributeMap;
+		index.requiredAttributeMap = d->requiredAttributeMap;
+		index.elementMap = d->elementMap;
+		index.elementStructureMap = d->elementStructureMap;
+		index.entitySet = d->entitySet;
+		IndexCache::get().saveGrammar ( widePublicId, wideSystemId, index );
 	}
+	return ret;
+}
+
+// Parses an external entity with a child of the document's parser,
+// noting the file for the DTD cache
+int XmlPromptGenerator::parseExternalEntity (
+    PromptGeneratorData *d,
+    const XML_Char *context,
+    const wxString &fileName,
+    const std::string &encoding,
+    const char *buffer,
+    size_t bufferLen )
+{
+	std::pair<wxString, long long> entry ( fileName,
+	                                      IndexCache::getModificationTime ( fileName ) );
+	d->dtdFiles.push_back ( entry );
+	d->grammarFiles.push_back ( entry );
 
-	std::string encoding = XmlEncodingHandler::get ( buffer );
 	XML_Parser dtdParser = XML_ExternalEntityParserCreate ( d->p, context, encoding.c_str() );
 	if ( !dtdParser )
 		return XML_STATUS_ERROR;
+	XML_SetBase ( dtdParser, fileName.utf8_str() );
 
-	XML_SetBase ( dtdParser, wideSystemId.utf8_str() );
-
-	ret = XML_Parse ( dtdParser, buffer.c_str(), buffer.size(), true );
+	++d->dtdDepth;
+	int ret = XML_Parse ( dtdParser, buffer, bufferLen, true );
+	--d->dtdDepth;
 	XML_ParserFree ( dtdParser );
 	return ret;
 }
@@ -423,146 +639,24 @@ void XmlPromptGenerator::handleSchema (
 
 	wxString schemaPath = PathResolver::run ( path, ( d->auxPath.empty() ) ? d->basePath : d->auxPath);
 
-	std::auto_ptr<XercesDOMParser> parser ( new XercesDOMParser() );
-	parser->setDoNamespaces ( true );
-	parser->setDoSchema ( true );
-	parser->setValidationSchemaFullChecking ( true );
+	// noted even if it cannot be read, so that the document's cached
+	// prompt maps are dropped once it can
+	long long modified = IndexCache::getModificationTime ( schemaPath );
+	d->grammarFiles.push_back ( std::make_pair ( schemaPath, modified ) );
 
-	Grammar *rootGrammar = parser->loadGrammar
-			( ( const XMLCh * ) WrapXerces::toString ( schemaPath ).GetData()
-			, Grammar::SchemaGrammarType
-			);
-	if ( !rootGrammar )
-	{
+	SchemaTablesPtr tables = SchemaCache::get().find ( schemaPath );
+	if ( !tables )
 		return;
-	}
-
-	SchemaGrammar* grammar = ( SchemaGrammar* ) rootGrammar;
-	RefHash3KeysIdPoolEnumerator<SchemaElementDecl> elemEnum = grammar->getElemEnumerator();
-
-	if ( !elemEnum.hasMoreElements() )
-	{
-		return;
-	}
-
-	SubstitutionMap substitutions;
-	buildSubstitutionMap ( substitutions, *grammar );
-
-	while ( elemEnum.hasMoreElements() )
-	{
-		const SchemaElementDecl& curElem = elemEnum.nextElement();
-
-		wxString element;
-
-		const QName *qnm = curElem.getElementName();
-		if ( qnm == NULL )
-			continue;
-		element = WrapXerces::toString ( qnm->getRawName() ); // this includes any prefix:localname combinations
-		if ( element.empty() )
-			continue;
-
-		const XMLCh* fmtCntModel = curElem.getFormattedContentModel();
-		if ( fmtCntModel != NULL ) // tbd: this does not yet pick up prefix:localname combinations
-		{
-			wxString structure = WrapXerces::toString ( fmtCntModel );
-			d->elementStructureMap[element] = structure;
-		}
-		const ContentSpecNode *spec = curElem.getContentSpec();
-		if ( spec != NULL )
-		{
-			getContent ( d->elementMap[element], spec, substitutions );
-		}
-
-		// fetch attributes
-		if ( !curElem.hasAttDefs() )
-			continue;
-
-		XMLAttDefList& attIter = curElem.getAttDefList();
-		for ( unsigned int i = 0; i < attIter.getAttDefCount(); i++ )
-		{
-			wxString attribute, attributeValue;
-
-			XMLAttDef& attr = attIter.getAttDef ( i );
-			XMLAttDef::DefAttTypes ty = attr.getDefaultType();
-			if ( ty == XMLAttDef::Prohibited )
-				continue;
-			SchemaAttDef *pAttr = ( SchemaAttDef * ) &attr;
-
-			const QName *qnm = pAttr->getAttName();
-			if ( qnm == NULL )
-				continue;
-			attribute = WrapXerces::toString ( qnm->getRawName() );
-			if ( attribute.empty() )
-				continue;
-
-			// Value
-			attributeValue = WrapXerces::toString ( pAttr->getValue() );
-			d->attributeMap[element][attribute].insert( attributeValue );
-
-			if ( ty == XMLAttDef::Required || ty == XMLAttDef::Required_And_Fixed)
-				d->requiredAttributeMap[element].insert ( attribute );
-		}
-	}
-}
-
-void XmlPromptGenerator::buildSubstitutionMap (
-    SubstitutionMap &substitutions,
-    const SchemaGrammar &grammar )
-{
-	substitutions.clear();
-
-	RefHash2KeysTableOfEnumerator<ElemVector> list ( grammar.getValidSubstitutionGroups() );
-	if ( !list.hasMoreElements() )
-		return;
-
-	while ( list.hasMoreElements() )
-	{
-		const ElemVector &elmts = list.nextElement();
-
-		const QName *qnm;
-		const SchemaElementDecl *cur, *substitution;
-		substitution = elmts.elementAt ( 0 )->getSubstitutionGroupElem();
-
-		size_t index = elmts.size();
-		while ( index-- > 0 )
-		{
-			cur = elmts.elementAt ( index );
-			qnm = cur->getElementName();
-			wxString element = WrapXerces::toString ( qnm->getRawName() );
-
-			substitutions[substitution].insert ( element );
-		}
-	}
-}
-
-void XmlPromptGenerator::getContent (
-    std::set<wxString> &list,
-    const ContentSpecNode *spec,
-    SubstitutionMap &substitutions )
-{
-	//if ( spec == NULL) return;
-
-	const QName *qnm = spec->getElement();
-	if ( qnm )
-	{
-		const SchemaElementDecl *elem = (const SchemaElementDecl *)spec->getElementDecl();
-		SubstitutionMap::const_iterator itr = substitutions.find ( elem );
-		if ( itr == substitutions.end() && elem != NULL )
-			itr = substitutions.find ( elem->getSubstitutionGroupElem() );
-		if ( itr != substitutions.end() )
-		{
-			list.insert ( itr->second.begin(), itr->second.end() );
-		}
-		else
-		{
-			wxString element = WrapXerces::toString ( qnm->getRawName() );
-			if ( !element.IsEmpty() )
-				list.insert( element );
-		}
-	}
 
-	if ( spec->getFirst() != NULL)
-		getContent( list, spec->getFirst(), substitutions );
-	if ( spec->getSecond() != NULL)
-		getContent( list, spec->getSecond(), substitutions );
+	// the entities come from the DTD, if any, so the maps can only be
+	// shared by schema if there are none
+	if ( !d->hasInternalSubset && d->entitySet.empty() )
+		d->grammarKey = _T ( "xsd\n" ) + schemaPath + wxString::Format (
+		                    _T ( "\n%" ) wxLongLongFmtSpec _T ( "d" ), modified );
+	else
+		d->grammarKey.clear();
+	d->elementMap = tables->elementMap;
+	d->attributeMap = tables->attributeMap;
+	d->requiredAttributeMap = tables->requiredAttributeMap;
+	d->elementStructureMap = tables->elementStructureMap;
 }
@@ -25,10 +25,12 @@
 #include <map>
 #include <set>
 #include <memory>
+#include <vector>
+#include <utility>
 #include "wrapexpat.h"
 #include "parserdata.h"
-#include <xercesc/validators/common/ContentSpecNode.hpp>
-#include <xercesc/validators/schema/SchemaGrammar.hpp>
+#include "xmlsaxdispatcher.h"
+#include "promptmaps.h"
 
 struct PromptGeneratorData : public ParserData
 {
@@ -40,21 +42,65 @@ struct PromptGeneratorData : public ParserData
 	std::set<wxString> entitySet;
 	wxString basePath, auxPath;
 	std::string encoding, rootElement;
-	bool isRootElement, grammarFound;
+	bool isRootElement, grammarFound, isListener, hasInternalSubset;
 	unsigned attributeValueCutoff;
 	XML_Parser p;
+	// how deep in external DTD entities the parser is, and the files read
+	// for the outermost one
+	int dtdDepth;
+	std::vector<std::pair<wxString, long long> > dtdFiles;
+	// every DTD and schema file the prompt maps were built from
+	std::vector<std::pair<wxString, long long> > grammarFiles;
+	// names the grammar and the version of its files if the prompt maps
+	// come from nothing else
+	wxString grammarKey;
 };
 
-typedef std::map<const xercesc::SchemaElementDecl *, std::set<wxString> >
-        SubstitutionMap;
-
-class XmlPromptGenerator : public WrapExpat
+class XmlPromptGenerator : public WrapExpat, public SaxListener
 {
 	public:
 		XmlPromptGenerator (
 		    const wxString& basePath = wxEmptyString,
 		    const wxString& auxPath = wxEmptyString );
 		virtual ~XmlPromptGenerator();
+
+		// SaxListener
+		virtual void attach ( XML_Parser parser );
+		virtual bool isDone();
+		virtual void startElement (
+		    const XML_Char *el,
+		    const XML_Char **attr );
+		virtual void endElement ( const XML_Char *el );
+		virtual void startDoctypeDecl (
+		    const XML_Char *doctypeName,
+		    const XML_Char *sysid,
+		    const XML_Char *pubid,
+		    int has_internal_subset );
+		virtual void endDoctypeDecl();
+		virtual void elementDecl (
+		    const XML_Char *name,
+		    XML_Content *model );
+		virtual void attlistDecl (
+		    const XML_Char *elname,
+		    const XML_Char *attname,
+		    const XML_Char *att_type,
+		    const XML_Char *dflt,
+		    int isrequired );
+		virtual void entityDecl (
+		    const XML_Char *entityName,
+		    int is_parameter_entity,
+		    const XML_Char *value,
+		    int value_length,
+		    const XML_Char *base,
+		    const XML_Char *systemId,
+		    const XML_Char *publicId,
+		    const XML_Char *notationName );
+		virtual bool externalEntityRef (
+		    const XML_Char *context,
+		    const XML_Char *base,
+		    const XML_Char *systemId,
+		    const XML_Char *publicId );
+
 		void getAttributeMap (
 		    std::map<wxString, std::map<wxString, std::set<wxString> > >
 		    &attributeMap );
@@ -65,8 +111,13 @@ class XmlPromptGenerator : public WrapExpat
 		void getEntitySet (
 		    std::set<wxString> &entitySet );
 		bool getGrammarFound();
+		// paths and modification times (-1 if missing) of the grammar
+		void getGrammarFiles (
+		    std::vector<std::pair<wxString, long long> > &grammarFiles );
 		void getElementStructureMap (
 		    std::map<wxString, wxString> &elementStructureMap );
+		// hands the prompt maps over; see the definition
+		PromptMapsPtr getPromptMaps();
 	private:
 		std::auto_ptr<PromptGeneratorData> d;
 		static void XMLCALL starthandler (
@@ -104,6 +155,13 @@ class XmlPromptGenerator : public WrapExpat
 		    const XML_Char *base,
 		    const XML_Char *systemId,
 		    const XML_Char *publicId );
+		static int parseExternalEntity (
+		    PromptGeneratorData *d,
+		    const XML_Char *context,
+		    const wxString &fileName,
+		    const std::string &encoding,
+		    const char *buffer,
+		    size_t bufferLen );
 		static void XMLCALL entitydeclhandler (
 		    void *userData,
 		    const XML_Char *entityName,
@@ -114,17 +172,11 @@ class XmlPromptGenerator : public WrapExpat
 		    const XML_Char *systemId,
 		    const XML_Char *publicId,
 		    const XML_Char *notationName );
+		static void stop ( PromptGeneratorData *d );
 		static void handleSchema (
 		    PromptGeneratorData *d,
 		    const XML_Char *el,
 		    const XML_Char **attr );
-		static void buildSubstitutionMap (
-		    SubstitutionMap &substitutions,
-		    const xercesc::SchemaGrammar &grammar );
-		static void getContent (
-		    std::set<wxString> &list,
-		    const xercesc::ContentSpecNode *spec,
-		    SubstitutionMap &substitutions );
 };
 
 #endif
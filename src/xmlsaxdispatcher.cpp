@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "xmlsaxdispatcher.h"
+
+typedef std::vector<SaxListener *>::iterator ListenerIterator;
+
+XmlSaxDispatcher::XmlSaxDispatcher()
+{
+	XML_SetUserData ( p, this );
+	XML_SetElementHandler ( p, starthandler, endhandler );
+	XML_SetCharacterDataHandler ( p, characterdatahandler );
+	XML_SetProcessingInstructionHandler ( p, processinginstructionhandler );
+	XML_SetDoctypeDeclHandler ( p, doctypedeclstarthandler, doctypedeclendhandler );
+	XML_SetElementDeclHandler ( p, elementdeclhandler );
+	XML_SetAttlistDeclHandler ( p, attlistdeclhandler );
+	XML_SetEntityDeclHandler ( p, entitydeclhandler );
+	XML_SetExternalEntityRefHandlerArg ( p, this );
+	XML_SetExternalEntityRefHandler ( p, externalentityrefhandler );
+}
+
+XmlSaxDispatcher::~XmlSaxDispatcher()
+{}
+
+void XmlSaxDispatcher::addListener ( SaxListener *listener )
+{
+	listeners.push_back ( listener );
+	listener->attach ( p );
+}
+
+void XMLCALL XmlSaxDispatcher::starthandler (
+    void *data,
+    const XML_Char *el,
+    const XML_Char **attr )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->startElement ( el, attr );
+}
+
+void XMLCALL XmlSaxDispatcher::endhandler (
+    void *data,
+    const XML_Char *el )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->endElement ( el );
+}
+
+void XMLCALL XmlSaxDispatcher::characterdatahandler (
+    void *data,
+    const XML_Char *s,
+    int len )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->characterData ( s, len );
+}
+
+void XMLCALL XmlSaxDispatcher::processinginstructionhandler (
+    void *data,
+    const XML_Char *target,
+    const XML_Char *pidata )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->processingInstruction ( target, pidata );
+}
+
+void XMLCALL XmlSaxDispatcher::doctypedeclstarthandler (
+    void *data,
+    const XML_Char *doctypeName,
+    const XML_Char *sysid,
+    const XML_Char *pubid,
+    int has_internal_subset )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->startDoctypeDecl ( doctypeName, sysid, pubid, has_internal_subset );
+}
+
+void XMLCALL XmlSaxDispatcher::doctypedeclendhandler ( void *data )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->endDoctypeDecl();
+}
+
+void XMLCALL XmlSaxDispatcher::elementdeclhandler (
+    void *data,
+    const XML_Char *name,
+    XML_Content *model )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->elementDecl ( name, model );
+
+	XML_FreeContentModel ( dispatcher->p, model );
+}
+
+void XMLCALL XmlSaxDispatcher::attlistdeclhandler (
+    void *data,
+    const XML_Char *elname,
+    const XML_Char *attname,
+    const XML_Char *att_type,
+    const XML_Char *dflt,
+    int isrequired )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->attlistDecl ( elname, attname, att_type, dflt, isrequired );
+}
+
+void XMLCALL XmlSaxDispatcher::entitydeclhandler (
+    void *data,
+    const XML_Char *entityName,
+    int is_parameter_entity,
+    const XML_Char *value,
+    int value_length,
+    const XML_Char *base,
+    const XML_Char *systemId,
+    const XML_Char *publicId,
+    const XML_Char *notationName )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) data;
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() )
+			( *it )->entityDecl (
+			    entityName,
+			    is_parameter_entity,
+			    value,
+			    value_length,
+			    base,
+			    systemId,
+			    publicId,
+			    notationName );
+}
+
+int XMLCALL XmlSaxDispatcher::externalentityrefhandler (
+    XML_Parser p,
+    const XML_Char *context,
+    const XML_Char *base,
+    const XML_Char *systemId,
+    const XML_Char *publicId )
+{
+	XmlSaxDispatcher *dispatcher = ( XmlSaxDispatcher * ) p; // arg is set to this in c'tor
+	ListenerIterator it;
+	for ( it = dispatcher->listeners.begin(); it != dispatcher->listeners.end(); ++it )
+		if ( ! ( *it )->isDone() &&
+		        ( *it )->externalEntityRef ( context, base, systemId, publicId ) )
+			break;
+
+	// an unreadable entity must not affect the well-formedness check
+	return XML_STATUS_OK;
+}
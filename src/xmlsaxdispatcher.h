@@ -0,0 +1,149 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XML_SAX_DISPATCHER_H
+#define XML_SAX_DISPATCHER_H
+
+#include <expat.h>
+#include <vector>
+#include "wrapexpat.h"
+
+// A consumer of the events reported by XmlSaxDispatcher
+class SaxListener
+{
+	public:
+		virtual ~SaxListener() {}
+		// called when the listener is added, before parsing starts
+		virtual void attach ( XML_Parser parser ) {}
+		// true once the listener wants no further events
+		virtual bool isDone()
+		{
+			return false;
+		}
+		virtual void startElement (
+		    const XML_Char *el,
+		    const XML_Char **attr ) {}
+		virtual void endElement ( const XML_Char *el ) {}
+		virtual void characterData ( const XML_Char *s, int len ) {}
+		virtual void processingInstruction (
+		    const XML_Char *target,
+		    const XML_Char *data ) {}
+		virtual void startDoctypeDecl (
+		    const XML_Char *doctypeName,
+		    const XML_Char *sysid,
+		    const XML_Char *pubid,
+		    int has_internal_subset ) {}
+		virtual void endDoctypeDecl() {}
+		// the content model is freed by the dispatcher
+		virtual void elementDecl (
+		    const XML_Char *name,
+		    XML_Content *model ) {}
+		virtual void attlistDecl (
+		    const XML_Char *elname,
+		    const XML_Char *attname,
+		    const XML_Char *att_type,
+		    const XML_Char *dflt,
+		    int isrequired ) {}
+		virtual void entityDecl (
+		    const XML_Char *entityName,
+		    int is_parameter_entity,
+		    const XML_Char *value,
+		    int value_length,
+		    const XML_Char *base,
+		    const XML_Char *systemId,
+		    const XML_Char *publicId,
+		    const XML_Char *notationName ) {}
+		// return true if the entity has been read; it is then not
+		// offered to the remaining listeners
+		virtual bool externalEntityRef (
+		    const XML_Char *context,
+		    const XML_Char *base,
+		    const XML_Char *systemId,
+		    const XML_Char *publicId )
+		{
+			return false;
+		}
+};
+
+// Parses a document once and passes every event on to each listener in
+// the order the listeners were added. The result of parse() reflects the
+// well-formedness of the document only: listeners cannot stop the parser,
+// and external entities that cannot be read are skipped.
+class XmlSaxDispatcher : public WrapExpat
+{
+	public:
+		XmlSaxDispatcher();
+		virtual ~XmlSaxDispatcher();
+		void addListener ( SaxListener *listener );
+	private:
+		std::vector<SaxListener *> listeners;
+		static void XMLCALL starthandler (
+		    void *data,
+		    const XML_Char *el,
+		    const XML_Char **attr );
+		static void XMLCALL endhandler (
+		    void *data,
+		    const XML_Char *el );
+		static void XMLCALL characterdatahandler (
+		    void *data,
+		    const XML_Char *s,
+		    int len );
+		static void XMLCALL processinginstructionhandler (
+		    void *data,
+		    const XML_Char *target,
+		    const XML_Char *pidata );
+		static void XMLCALL doctypedeclstarthandler (
+		    void *data,
+		    const XML_Char *doctypeName,
+		    const XML_Char *sysid,
+		    const XML_Char *pubid,
+		    int has_internal_subset );
+		static void XMLCALL doctypedeclendhandler ( void *data );
+		static void XMLCALL elementdeclhandler (
+		    void *data,
+		    const XML_Char *name,
+		    XML_Content *model );
+		static void XMLCALL attlistdeclhandler (
+		    void *data,
+		    const XML_Char *elname,
+		    const XML_Char *attname,
+		    const XML_Char *att_type,
+		    const XML_Char *dflt,
+		    int isrequired );
+		static void XMLCALL entitydeclhandler (
+		    void *data,
+		    const XML_Char *entityName,
+		    int is_parameter_entity,
+		    const XML_Char *value,
+		    int value_length,
+		    const XML_Char *base,
+		    const XML_Char *systemId,
+		    const XML_Char *publicId,
+		    const XML_Char *notationName );
+		static int XMLCALL externalentityrefhandler (
+		    XML_Parser p,
+		    const XML_Char *context,
+		    const XML_Char *base,
+		    const XML_Char *systemId,
+		    const XML_Char *publicId );
+
+		DECLARE_NO_COPY_CLASS ( XmlSaxDispatcher )
+};
+
+#endif
@@ -72,14 +72,14 @@ void XMLCALL XmlShallowValidator::start ( void *data,
 	++ ( vd->depth );
 
 	//check element ok
-	wxString parent ( vd->getParent().c_str(), wxConvUTF8 );
+	wxString parent ( vd->getParent(), wxConvUTF8 );
 	if ( parent.empty() )
 		return;
 
 	if ( vd->elementMap.empty() )
 		return;
 
-	wxString element ( vd->getElement().c_str(), wxConvUTF8 );
+	wxString element ( vd->getElement(), wxConvUTF8 );
 	if ( !vd->elementMap[parent].count ( element ) )
 	{
 		vd->isValid = false;
@@ -89,14 +89,14 @@ void XMLCALL XmlShallowValidator::start ( void *data,
 
 	element = wxString ( el, wxConvUTF8 );
 
-	std::map<wxString, std::set<wxString> > attributeMap;
+	// looked up once rather than copied for every attribute
+	const std::map<wxString, std::set<wxString> > &attributeMap =
+	    vd->attributeMap[element];
 	size_t requiredAttributeCount = vd->requiredAttributeMap[element].size();
 	wxString currentAttribute;
 
 	while ( *attr )
 	{
-		attributeMap = vd->attributeMap[element];
-
 		// check for existence
 		currentAttribute = wxString ( *attr, wxConvUTF8 );
 		if ( !attributeMap.count ( currentAttribute ) )
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include "xmltextview.h"
+#include "xmlencodinghandler.h"
+
+XmlTextView::XmlTextView ( wxStyledTextCtrl *ctrl )
+{
+#if wxCHECK_VERSION(2,9,0)
+	body = ctrl->GetCharacterPointer();
+#else
+	text = ctrl->GetTextRaw();
+	body = text.data();
+#endif
+	bodyLen = ctrl->GetLength();
+
+	if ( bodyLen < 5 || strncmp ( body, "<?xml", 5 ) )
+		return;
+	const char *end = ( const char * ) memchr ( body, '>', bodyLen );
+	if ( !end )
+		return;
+	++end;
+	head.assign ( body, end );
+	bodyLen -= end - body;
+	body = end;
+}
+
+std::string XmlTextView::getEncoding()
+{
+	if ( head.empty() )
+		return XmlEncodingHandler::get ( body, bodyLen );
+	return XmlEncodingHandler::get ( head );
+}
+
+bool XmlTextView::setUtf8 ( bool ignoreCurrentEncoding )
+{
+	// without a declaration there is nothing to rewrite
+	if ( head.empty() )
+		return ignoreCurrentEncoding || !getEncoding().empty();
+	return XmlEncodingHandler::setUtf8 ( head, ignoreCurrentEncoding );
+}
+
+bool XmlTextView::parse ( WrapExpat &parser )
+{
+	if ( !head.empty() && !parser.parse ( head.data(), head.size(), false ) )
+		return false;
+	return parser.parse ( body, bodyLen, true );
+}
+
+bool XmlTextView::write ( std::ostream &stream )
+{
+	stream.write ( head.data(), head.size() );
+	stream.write ( body, bodyLen );
+	return stream.good();
+}
+
+void XmlTextView::copy ( std::string &buffer )
+{
+	buffer.reserve ( size() );
+	buffer.assign ( head );
+	buffer.append ( body, bodyLen );
+}
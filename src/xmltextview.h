@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 Xml Copy Editor developers.
+ *
+ * This file is part of Xml Copy Editor.
+ *
+ * Xml Copy Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * Xml Copy Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xml Copy Editor; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XML_TEXT_VIEW_H
+#define XML_TEXT_VIEW_H
+
+#include <wx/wx.h>
+#include <wx/stc/stc.h>
+#include <string>
+#include <ostream>
+#include "wrapexpat.h"
+
+// Reads the text of a control in place as a UTF-8 document. Where
+// wxWidgets hands out Scintilla's own buffer nothing the size of the
+// document is copied: only the XML declaration is held apart, so that
+// setUtf8 can rewrite it as XmlEncodingHandler::setUtf8 would.
+//
+// A view is only good until the text of the control next changes, so it
+// must not outlive the call that made it nor be passed to another thread.
+class XmlTextView
+{
+	public:
+		XmlTextView ( wxStyledTextCtrl *ctrl );
+		// the encoding named by the declaration (see XmlEncodingHandler::get)
+		std::string getEncoding();
+		// see XmlEncodingHandler::setUtf8
+		bool setUtf8 ( bool ignoreCurrentEncoding = false );
+		size_t size()
+		{
+			return head.size() + bodyLen;
+		}
+		bool empty()
+		{
+			return !size();
+		}
+		// the XML declaration, if any
+		const std::string &getHead()
+		{
+			return head;
+		}
+		// everything after the declaration
+		const char *getBody()
+		{
+			return body;
+		}
+		size_t getBodyLen()
+		{
+			return bodyLen;
+		}
+		bool parse ( WrapExpat &parser );
+		bool write ( std::ostream &stream );
+		void copy ( std::string &buffer );
+	private:
+		std::string head;
+		const char *body;
+		size_t bodyLen;
+#if !wxCHECK_VERSION(2,9,0)
+		wxCharBuffer text; // older controls only give out a copy
+#endif
+
+		DECLARE_NO_COPY_CLASS ( XmlTextView )
+};
+
+#endif